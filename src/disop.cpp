@@ -7,10 +7,13 @@
 #include <functional>
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <numeric>
 #include <string>
 #include <cstring>
+#include <cmath>
+#include <stdexcept>
 
 //
 // IMS Stuff
@@ -18,6 +21,7 @@
 #include <ims/alphabet.h>
 #include <ims/weights.h>
 #include <ims/isotopedistribution.h>
+#include <ims/isotopedistributioncache.h>
 #include <ims/distributionprobabilityscorer.h>
 #include <ims/composedelement.h>
 #include <ims/nitrogenrulefilter.h>
@@ -26,6 +30,11 @@
 #include <ims/decomp/realmassdecomposer.h>
 #include <ims/decomp/integermassdecomposer.h>
 #include <ims/decomp/decomputils.h>
+#include <ims/decomp/linearconstraint.h>
+#include <ims/decomp/residuetableformat.h>
+#include <ims/decomp/precisionselector.h>
+#include <ims/decomp/decompositioncounter.h>
+#include <ims/utils/workstealingpool.h>
 
 //
 // R Stuff
@@ -43,15 +52,21 @@ using namespace std;
 typedef Alphabet alphabet_t;
 typedef IsotopeDistribution distribution_t;
 typedef IntegerMassDecomposer<>::decompositions_type decompositions_t;
+typedef RealMassDecomposer::decomposition_type decomposition_t;
 
 void initializeCHNOPS(alphabet_t&, 
-		      const int maxisotopes);
+		      const int maxisotopes,
+		      distribution_t::context_type&);
 void initializeAlphabet(const SEXP l_alphabet, 
 			alphabet_t &alphabet, 
-			const int maxisotopes);
+			const int maxisotopes,
+			distribution_t::context_type&);
+void initializeConstraints(const SEXP l_filter,
+			   const alphabet_t &alphabet,
+			   vector<LinearConstraint> &constraints);
 
 template <typename score_type>
-SEXP  rlistScores(multimap<score_type, ComposedElement, greater<score_type> > scores, int z);
+SEXP  rlistScores(const multimap<score_type, ComposedElement, greater<score_type> >& scores, int z);
 
 // }}}
 
@@ -116,52 +131,531 @@ bool isValidMyNitrogenRule(const ComposedElement& molecule, int z) {
 }
 // }}}
 
-bool isWithinElementRange(const ComposedElement& molecule, const ComposedElement& minElements, const ComposedElement& maxElements) {
+/**
+ * Converts the minimum/maximum element count "molecules" into bounds on 
+ * the amounts of the alphabet elements, which are pushed into the 
+ * decomposition. Elements missing in maxElements are unbounded, while
+ * an element given with count zero (as N in "C2N0") is excluded.
+ */
+void getElementBounds(const alphabet_t& alphabet, 
+		      const ComposedElement& minElements, const ComposedElement& maxElements,
+		      decomposition_t& lower_bounds, decomposition_t& upper_bounds) {
 // {{{
 
-  for (ComposedElement::container::const_iterator it = molecule.getElements().begin(); 
-       it != molecule.getElements().end(); ++it) {
-    
-    int mincount = static_cast<int>(minElements.getElementAbundance((it->first).getName()));
-    int maxcount = static_cast<int>(maxElements.getElementAbundance((it->first).getName()));
+  lower_bounds.assign(alphabet.size(), 0);
+  upper_bounds.assign(alphabet.size(), RealMassDecomposer::getUnboundedAmount());
 
-    int count = static_cast<int>(molecule.getElementAbundance((it->first).getName()));
-      
-      if (count < mincount) {
-	return false;
-      }
+  for (alphabet_t::size_type i = 0; i < alphabet.size(); ++i) {
+    const string& name = alphabet.getName(i);
+    lower_bounds[i] = minElements.getElementAbundance(name);
 
-      // TODO: Fails e.g. for "C2N0" 
-      if (maxcount>0 && count > maxcount) {
-	return false;
+    for (ComposedElement::container::const_iterator it = maxElements.getElements().begin(); 
+	 it != maxElements.getElements().end(); ++it) {
+      if ((it->first).getName() == name) {
+	upper_bounds[i] = it->second;
       }
+    }
+  }
+}
+// }}}
+
+//
+// Persistent Decomposer
+//
+
+/**
+ * Holds everything the identification pipeline needs that depends only on the
+ * alphabet: elements, their order, integer weights and the real mass
+ * decomposer with its extended residue table. Created once by
+ * createDecomposer() and kept alive by an R external pointer, so the residue
+ * table is not rebuilt for every decomposeIsotopes call.
+ *
+ * With a table directory, the residue table is memory-mapped from a file
+ * there (written on first use), so R workers share one copy.
+ *
+ * A precision of 0 selects the precision automatically, tuned for 
+ * decomposing @c queries masses like @c masses with @c errors 
+ * (see PrecisionSelector).
+ */
+class DecomposerHandle {
+  // {{{ 
+
+ public:
+  DecomposerHandle(SEXP l_alphabet, SEXP v_element_order, int maxisotopes,
+		   double precision, const vector<double>& masses, 
+		   const vector<double>& errors, double queries,
+		   const string& table_directory = string());
+
+  const alphabet_t& getAlphabet() const { return alphabet; }
+
+  /**
+   * Gets the isotope distribution settings the alphabet was created with.
+   */
+  const distribution_t::context_type& getContext() const { return context; }
+
+  const vector<string>& getElementsOrder() const { return elements_order; }
+  const RealMassDecomposer& getDecomposer() const { return *decomposer; }
+
+ private:
+  alphabet_t alphabet;
+  vector<string> elements_order;
+  distribution_t::context_type context;
+  double precision;
+  unique_ptr<RealMassDecomposer> decomposer;
+
+  // not copyable
+  DecomposerHandle(const DecomposerHandle&);
+  DecomposerHandle& operator =(const DecomposerHandle&);
+
+  // }}}
+};
+
+DecomposerHandle::DecomposerHandle(SEXP l_alphabet, SEXP v_element_order,
+				   int maxisotopes, double precision,
+				   const vector<double>& masses, 
+				   const vector<double>& errors, double queries,
+				   const string& table_directory) :
+  precision(precision) {
+  // {{{ 
+
+  if (l_alphabet == NULL || Rf_length(l_alphabet) < 1  ) {
+    initializeCHNOPS(alphabet, maxisotopes, context); 
+    // initializes order of atoms in which one would
+    // like them to appear in the molecules sequence
+    elements_order.push_back("C");
+    elements_order.push_back("H");
+    elements_order.push_back("N");
+    elements_order.push_back("O");
+    elements_order.push_back("P");
+    elements_order.push_back("S");
+  } else {
+    initializeAlphabet(l_alphabet, alphabet, maxisotopes, context);
+
+    int element_length = Rf_length(v_element_order);
+    for (int i=0; i<element_length; i++) {
+      elements_order.push_back(string(CHAR(STRING_ELT(v_element_order,i))));
+    }
+  }
+  // chooses the precision minimizing the expected running time
+  if (precision <= 0.0) {
+    PrecisionSelector selector(alphabet.getMasses());
+    if (!masses.empty()) {
+      selector.setMasses(masses, errors);
+    }
+    selector.setNumberOfQueries(queries);
+    this->precision = selector.select();
+  }
+
+  // initializes weights
+  Weights weights(alphabet.getMasses(), this->precision);
+
+  // checks if weights could become smaller, by dividing on gcd.
+  weights.divideByGCD();
+
+  // initializes decomposer, this fills the extended residue table
+  // or maps it from the table directory
+  if (table_directory.empty()) {
+    decomposer.reset(new RealMassDecomposer(weights));
+  } else {
+    unique_ptr<RealMassDecomposer::integer_decomposer_type> integer_decomposer(
+      ResidueTableFormat::createDecomposer<RealMassDecomposer::integer_decomposer_type>(
+	weights, table_directory));
+    decomposer.reset(new RealMassDecomposer(weights, integer_decomposer.get()));
+    integer_decomposer.release();
+  }
+
+  // }}}
+}
+
+static SEXP decomposerTag() {
+  return Rf_install("Rdisop_decomposer");
+}
+
+static void finalizeDecomposer(SEXP x_decomposer) {
+  // {{{ 
+
+  DecomposerHandle* handle = 
+    static_cast<DecomposerHandle*>(R_ExternalPtrAddr(x_decomposer));
+  if (handle != NULL) {
+    delete handle;
+    R_ClearExternalPtr(x_decomposer);
+  }
+
+  // }}}
+}
+
+/**
+ * Returns the handle behind an external pointer created by createDecomposer,
+ * or NULL if @c x_decomposer is R's NULL. Throws invalid_argument for 
+ * anything else or a handle already released.
+ */
+DecomposerHandle* getDecomposerHandle(SEXP x_decomposer) {
+  // {{{ 
+
+  if (x_decomposer == NULL || Rf_isNull(x_decomposer)) {
+    return NULL;
+  }
+  if (TYPEOF(x_decomposer) != EXTPTRSXP 
+      || R_ExternalPtrTag(x_decomposer) != decomposerTag()) {
+    throw invalid_argument("decomposer is not an object created by initializeDecomposer()");
+  }
+  DecomposerHandle* handle = 
+    static_cast<DecomposerHandle*>(R_ExternalPtrAddr(x_decomposer));
+  if (handle == NULL) {
+    throw invalid_argument("decomposer is no longer valid (e.g. restored from a saved session), "
+			   "please create a new one with initializeDecomposer()");
+  }
+  return handle;
+
+  // }}}
+}
+
+/**
+ * Returns the precision given from R, 0 (automatic) for NA. Throws
+ * invalid_argument for a negative precision.
+ */
+double getPrecisionArgument(SEXP d_precision) {
+  // {{{ 
+
+  double precision = Rf_asReal(d_precision);
+  if (ISNAN(precision)) {
+    return 0.0;
   }
+  if (precision < 0.0) {
+    throw invalid_argument("precision must be positive or \"auto\"");
+  }
+  return precision;
+
+  // }}}
+}
+
+/**
+ * Number of queries a persistent decomposer is tuned for by the automatic
+ * precision, since its residue table is built only once.
+ */
+static const double PERSISTENT_DECOMPOSER_QUERIES = 1000.0;
+
+RcppExport SEXP createDecomposer(SEXP l_alphabet, SEXP v_element_order, 
+				 SEXP i_maxisotopes, SEXP s_table_directory,
+				 SEXP d_precision, SEXP v_masses, SEXP v_error) {
+// {{{ 
+
+    // Reset error state
+    exceptionMesg = NULL;
+
+    SEXP  rl=R_NilValue;
+    try {
+      string table_directory;
+      if (!Rf_isNull(s_table_directory)) {
+	table_directory = CHAR(STRING_ELT(s_table_directory, 0));
+      }
+      // expected masses and absolute errors for the automatic precision
+      vector<double> masses(REAL(v_masses), REAL(v_masses) + Rf_length(v_masses));
+      vector<double> errors(REAL(v_error), REAL(v_error) + Rf_length(v_error));
+      DecomposerHandle* handle = new DecomposerHandle(l_alphabet, v_element_order, 
+						      Rf_asInteger(i_maxisotopes),
+						      getPrecisionArgument(d_precision),
+						      masses, errors,
+						      PERSISTENT_DECOMPOSER_QUERIES,
+						      table_directory);
+      rl = PROTECT(R_MakeExternalPtr(handle, decomposerTag(), R_NilValue));
+      R_RegisterCFinalizerEx(rl, finalizeDecomposer, TRUE);
+      UNPROTECT(1);
+    } catch(std::exception& ex) {
+      exceptionMesg = copyMessageToR(ex.what());
+      error_return(exceptionMesg); 
+    } catch(...) {
+      exceptionMesg = copyMessageToR("unknown reason");
+      error_return(exceptionMesg); 
+    }
 
-  return true;
+    return rl;
 }
+
 // }}}
 
 //
 // Decomposition of Mass / Isotope Pattern
 //
 
+typedef DistributionProbabilityScorer scorer_t;
+typedef multimap<scorer_t::score_type, ComposedElement, 
+		 greater<scorer_t::score_type> > scores_t;
+
+/**
+ * Visitor for RealMassDecomposer::visitDecompositions, which
+ * - calculates the isotopic pattern and
+ * - matches it against the input spectrum
+ * for every decomposition as it is found, so that decompositions
+ * are never stored. Collects candidates with their non-normalized scores.
+ * If @c max_results is not 0, only the @c max_results best scoring 
+ * candidates are kept, in a heap with the worst of them on top, while 
+ * the scores of all candidates are accumulated.
+ *
+ * Candidates are kept as element counts in alphabet order with the
+ * isotope distribution they were scored on, which getMolecule() reports.
+ * The distribution is folded from powers of the alphabet's elements, which
+ * are cached for all candidates, see IsotopeDistributionCache. Candidates
+ * coming from a decomposition cursor in the order of enumeration also 
+ * share the distributions of their heavier elements, which are only 
+ * folded again where the cursor changed them. Only candidates that are 
+ * reported are turned into a ComposedElement with its sequence, see 
+ * getMolecule().
+ */
+class CandidateScorer {
+  // {{{ 
+
+ public:
+  typedef scorer_t scorer_type;
+  typedef scorer_type::score_type score_type;
+  typedef scorer_type::masses_container masses_container;
+  typedef scorer_type::abundances_container abundances_container;
+  typedef distribution_t::abundance_type abundance_type;
+
+  /**
+   * A kept candidate with the isotope distribution it was scored on.
+   */
+  struct Candidate {
+    Candidate(const decomposition_t& decomposition, 
+	      const distribution_t& distribution, score_type score) :
+      decomposition(decomposition), distribution(distribution), score(score) {}
+
+    decomposition_t decomposition;
+    distribution_t distribution;
+    score_type score;
+  };
+  typedef vector<Candidate> nonnormalized_scores_container;
+
+  CandidateScorer(const alphabet_t& alphabet,
+		  const vector<string>& elements_order,
+		  const distribution_t::context_type& context,
+		  const scorer_type& scorer,
+		  const abundances_container& peaklist_abundances,
+		  size_t max_results) :
+    alphabet(alphabet), elements_order(elements_order), scorer(scorer),
+    peaklist_abundances(peaklist_abundances), max_results(max_results), 
+    distributions(alphabet, context), accumulated_score(0.0) {}
+
+  void operator()(const RealMassDecomposer::decomposition_type& decomposition) {
+    // calculates the theoretical isotope distribution of the candidate
+    distribution_t distribution(distributions.getContext());
+    distributions.getDistribution(decomposition, distribution);
+    addCandidate(decomposition, distribution);
+  }
+
+  /**
+   * Scores the current decomposition of @c cursor, whose amounts above 
+   * cursor.getChangedLevel() are the same as of the previous one scored 
+   * this way.
+   */
+  void operator()(const RealMassDecomposer::DecompositionCursor& cursor) {
+    addCandidate(cursor.current(), 
+		 distributions.getNextDistribution(cursor.current(), cursor.getChangedLevel()));
+  }
+
+  /**
+   * Creates the molecule of a kept candidate with the isotope distribution
+   * it was scored on and its sequence in the requested order of elements.
+   */
+  ComposedElement getMolecule(const Candidate& candidate) const {
+    ComposedElement molecule(candidate.decomposition, alphabet);
+    molecule.setIsotopeDistribution(candidate.distribution);
+    molecule.updateSequence(&elements_order);
+    return molecule;
+  }
+
+  const nonnormalized_scores_container& getScores() const { return nonnormalized_scores; }
+  score_type getAccumulatedScore() const { return accumulated_score; }
+  const IsotopeDistributionCache& getDistributionCache() const { return distributions; }
+
+ private:
+  void addCandidate(const decomposition_t& decomposition, const distribution_t& distribution) {
+
+    // minimum/maximum element counts and chemical filters are 
+    // already ensured by the decomposer
+
+    // extracts masses and abundances from isotope distribution of the candidate molecule
+    masses_container candidate_masses = distribution.getMasses();
+    abundances_container candidate_abundances = distribution.getAbundances();
+
+    // normalizes candidate abundances if the size of the measured peaklist is less than 
+    // the size of theoretical isotope distribution. This is always the case since our
+    // theoretical distributions are limited to by default 10 peaks and measured peaklists contain
+    // less than 10 peaks
+
+    distribution_t::size_type size = min(peaklist_abundances.size(), candidate_abundances.size());
+
+    if (size < candidate_abundances.size()) {
+      // normalizes the isotope distribution abundances with respect to the number of elements in peaklist
+      abundance_type sum = accumulate(candidate_abundances.begin(), 
+				    candidate_abundances.begin() + size, 
+				    0.0);
+      if (fabs(sum - 1) > distributions.getContext().getAbundancesSumError()) {
+	abundance_type scale = 1/sum;
+	transform(candidate_abundances.begin(),			// begin of source range
+		  candidate_abundances.begin() + size,		// end of source range
+		  candidate_abundances.begin(), 			// destination
+		  bind2nd(multiplies<abundance_type>(), scale));	// operation (*scale)
+      }
+    }
+
+    // calculates a score
+    score_type score = scorer.score(candidate_masses, candidate_abundances);
+
+    // accumulates scores
+    accumulated_score += score;
+
+    // stores the counts with non-normalized score, replacing the
+    // worst one kept if there are max_results already
+    if (max_results == 0 || nonnormalized_scores.size() < max_results) {
+      nonnormalized_scores.push_back(Candidate(decomposition, distribution, score));
+      if (max_results > 0) {
+	push_heap(nonnormalized_scores.begin(), nonnormalized_scores.end(), 
+		  HigherScore());
+      }
+    } else if (score > nonnormalized_scores.front().score) {
+      pop_heap(nonnormalized_scores.begin(), nonnormalized_scores.end(), HigherScore());
+      nonnormalized_scores.back().decomposition = decomposition;
+      nonnormalized_scores.back().distribution = distribution;
+      nonnormalized_scores.back().score = score;
+      push_heap(nonnormalized_scores.begin(), nonnormalized_scores.end(), HigherScore());
+    }
+
+  }
+
+  // orders the heap of kept candidates, the lowest score on top
+  struct HigherScore {
+    bool operator()(const Candidate& a, const Candidate& b) const {
+      return a.score > b.score;
+    }
+  };
+
+  const alphabet_t& alphabet;
+  const vector<string>& elements_order;
+  const scorer_type& scorer;
+  const abundances_container& peaklist_abundances;
+  size_t max_results;
+
+  // powers of the elements' distributions, shared by all candidates
+  IsotopeDistributionCache distributions;
+
+  // storage to store element counts, distributions and their non-normalized scores
+  nonnormalized_scores_container nonnormalized_scores;
+  score_type accumulated_score;
+
+  // }}}
+};
+
+/**
+ * Runs the identification pipeline for one measured isotope pattern:
+ * decomposes its monoisotopic mass within the element bounds and 
+ * linear constraints (chemical filter), calculates their isotope distributions and scores
+ * them against the pattern. Normalized scores are stored in @c scores.
+ * If @c top is not 0, only the @c top decompositions closest to the 
+ * monoisotopic mass are scored (and normalized among themselves), which
+ * bounds the time spent on masses with very many decompositions.
+ * If @c max_results is not 0, only the @c max_results best scoring 
+ * candidates are stored, still normalized by the scores of all.
+ * 
+ * If @c cache_hits and @c cache_misses are given, they are set to the
+ * number of element distribution powers found in and added to the cache.
+ * 
+ * Touches no R API, so it can be called for many patterns in a row
+ * while sharing one decomposer.
+ */
+void identifyIsotopes(const RealMassDecomposer& decomposer, 
+		      const alphabet_t& alphabet,
+		      const vector<string>& elements_order,
+		      const distribution_t::context_type& context,
+		      const scorer_t::masses_container& peaklist_masses,
+		      scorer_t::abundances_container peaklist_abundances,
+		      double error,
+		      const decomposition_t& lower_bounds, 
+		      const decomposition_t& upper_bounds,
+		      const vector<LinearConstraint>& constraints,
+		      size_t top,
+		      size_t max_results,
+		      scores_t& scores,
+		      IsotopeDistributionCache::statistics_type* cache_hits = NULL,
+		      IsotopeDistributionCache::statistics_type* cache_misses = NULL) {
+// {{{ 
+
+    typedef CandidateScorer::score_type score_type;
+    typedef CandidateScorer::abundances_container abundances_container;
+    typedef CandidateScorer::abundance_type abundance_type;
+    typedef CandidateScorer::nonnormalized_scores_container nonnormalized_scores_container;
+
+	// normalizes abundances
+	abundance_type abundances_sum = 0.0;
+	for (abundances_container::size_type i = 0; i < peaklist_abundances.size(); ++i) {
+		abundances_sum += peaklist_abundances[i];
+	}
+	for (abundances_container::size_type i = 0; i < peaklist_abundances.size(); ++i) {
+		peaklist_abundances[i] /= abundances_sum;
+	}
+
+	// initializes distribution probability scorer
+	scorer_t scorer(peaklist_masses, peaklist_abundances);
+	
+	///////////////////////////////////////////////////////////////////////////////////////
+	//////////////////////////  Start identification pipeline /////////////////////////////
+	///////////////////////////////////////////////////////////////////////////////////////
+
+	// filters and scores all possible decompositions for the monoisotopic 
+	// mass with error allowed
+	CandidateScorer candidates(alphabet, elements_order, context, scorer, 
+				   peaklist_abundances, max_results);
+	RealMassDecomposer::DecompositionCursor cursor(decomposer);
+	cursor.setBounds(lower_bounds, upper_bounds);
+	for (vector<LinearConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it) {
+		cursor.addConstraint(*it);
+	}
+	if (top > 0) {
+		// searches the closest decompositions without enumerating the whole window
+		RealMassDecomposer::decompositions_type closest;
+		cursor.getClosest(peaklist_masses[0], error, top, closest);
+		for (RealMassDecomposer::decompositions_type::const_iterator it = closest.begin(); 
+		     it != closest.end(); ++it) {
+			candidates(*it);
+		}
+	} else {
+		for (cursor.reset(peaklist_masses[0], error); cursor.next(); ) {
+			candidates(cursor);
+		}
+	}
+
+	score_type accumulated_score = candidates.getAccumulatedScore();
+	const nonnormalized_scores_container& nonnormalized_scores = candidates.getScores();
+
+	for (nonnormalized_scores_container::const_iterator it = nonnormalized_scores.begin(); it != nonnormalized_scores.end(); ++it) {
+		score_type normalized_score = it->score;
+		if (accumulated_score > 0.0) {
+			normalized_score /= accumulated_score;
+		}
+		// stores the molecule with the score
+		scores.insert(make_pair(normalized_score, candidates.getMolecule(*it)));
+	}
+
+	if (cache_hits != NULL) {
+		*cache_hits = candidates.getDistributionCache().getHits();
+	}
+	if (cache_misses != NULL) {
+		*cache_misses = candidates.getDistributionCache().getMisses();
+	}
+
+    // }}}
+}
+
 RcppExport SEXP decomposeIsotopes(SEXP v_masses, SEXP v_abundances, SEXP s_error, 
 				  SEXP l_alphabet, SEXP v_element_order, 
 				  SEXP z, SEXP i_maxisotopes,
-				  SEXP s_minElements, SEXP s_maxElements) {
+				  SEXP s_minElements, SEXP s_maxElements,
+				  SEXP l_filter, SEXP x_decomposer,
+				  SEXP d_precision, SEXP i_top, SEXP i_max_results) {
 // {{{ 
 
-    typedef DistributionProbabilityScorer scorer_type;
-    typedef scorer_type::score_type score_type;
-    typedef scorer_type::masses_container masses_container;
-    typedef scorer_type::abundances_container abundances_container;
-    typedef distribution_t::peaks_container peaks_container;
-    typedef distribution_t::mass_type mass_type;
-    typedef distribution_t::abundance_type abundance_type;
-    typedef distribution_t::nominal_mass_type nominal_mass_type;
-    typedef multimap<score_type, ComposedElement, greater<score_type> > scores_container;
-    typedef vector<pair<ComposedElement, score_type> > nonnormalized_scores_container;
-    typedef decompositions_t::value_type decomposition_type;
+    typedef scorer_t::masses_container masses_container;
+    typedef scorer_t::abundances_container abundances_container;
 
     // Reset error state
     exceptionMesg = NULL;
@@ -176,52 +670,25 @@ RcppExport SEXP decomposeIsotopes(SEXP v_masses, SEXP v_abundances, SEXP s_error
 	// converts relative (ppm) in absolute error 
 	error *= masses(0) * 1.0e-06;
 
-	// initializes precision
-	double precision = 1.0e-05;
-	int number_molecules_shown = 100;
-	
-	// initializes alphabet
-	int maxisotopes = Rf_asInteger(i_maxisotopes);
-	alphabet_t alphabet;
-	vector<string> elements_order;
-
-	if (l_alphabet == NULL || Rf_length(l_alphabet) < 1  ) {
-	  initializeCHNOPS(alphabet, maxisotopes); 
-	  // initializes order of atoms in which one would
-	  // like them to appear in the molecules sequence
-	  elements_order.push_back("C");
-	  elements_order.push_back("H");
-	  elements_order.push_back("N");
-	  elements_order.push_back("O");
-	  elements_order.push_back("P");
-	  elements_order.push_back("S");
-	} else {
-	  initializeAlphabet(l_alphabet, alphabet, maxisotopes);
-	  
-	  int element_length = Rf_length(v_element_order);
-	  for (int i=0; i<element_length; i++) {
-	    elements_order.push_back(string(CHAR(STRING_ELT(v_element_order,i))));
-	  }
-	}
-	
-	// initializes weights
-	Weights weights(alphabet.getMasses(), precision);
-	
-	// checks if weights could become smaller, by dividing on gcd.
-	weights.divideByGCD();
-	
-	// initializes decomposer
-	RealMassDecomposer decomposer(weights);
-	
-	// normalizes abundances
-	abundance_type abundances_sum = 0.0;
-	for (peaks_container::size_type i = 0; i < abundances.size(); ++i) {
-		abundances_sum += abundances(i);
+	// a mass of NA has no decompositions
+	if (!std::isfinite(masses(0)) || !std::isfinite(error)) {
+	  return rl;
 	}
-	for (peaks_container::size_type i = 0; i < abundances.size(); ++i) {
-		abundances(i) /= abundances_sum;
+
+	// uses the persistent decomposer if one is given, otherwise
+	// initializes alphabet, weights and decomposer just for this call
+	DecomposerHandle* handle = getDecomposerHandle(x_decomposer);
+	unique_ptr<DecomposerHandle> temporary_handle;
+	if (handle == NULL) {
+	  temporary_handle.reset(
+	    new DecomposerHandle(l_alphabet, v_element_order, Rf_asInteger(i_maxisotopes),
+				 getPrecisionArgument(d_precision), 
+				 vector<double>(1, masses(0)), vector<double>(1, error), 1.0));
+	  handle = temporary_handle.get();
 	}
 
+	const alphabet_t& alphabet = handle->getAlphabet();
+
 	// fills peaklist masses and abundances, 
 	// since we cannot use masses and abundances - instances of RcppVector object - directly
 	masses_container peaklist_masses;
@@ -231,124 +698,332 @@ RcppExport SEXP decomposeIsotopes(SEXP v_masses, SEXP v_abundances, SEXP s_error
 		peaklist_abundances.push_back(abundances(mi));
 	}
 
-	// initializes distribution probability scorer
-	scorer_type scorer(peaklist_masses, peaklist_abundances);
-	
-	// initializes storage to store sum formulas and their non-normalized scores
-	nonnormalized_scores_container nonnormalized_scores;
+	// Initialize minimum/maximum element count "molecules"
+	ComposedElement minElements(CHAR(Rf_asChar(s_minElements)), alphabet);
+	ComposedElement maxElements(CHAR(Rf_asChar(s_maxElements)), alphabet);
+	decomposition_t lower_bounds, upper_bounds;
+	getElementBounds(alphabet, minElements, maxElements, lower_bounds, upper_bounds);
+
+	// initializes chemical filter
+	vector<LinearConstraint> constraints;
+	initializeConstraints(l_filter, alphabet, constraints);
 
 	// initializes storage for results: sum formulas and their scores
-	scores_container scores;
+	scores_t scores;
+	IsotopeDistributionCache::statistics_type cache_hits = 0, cache_misses = 0;
 
-	///////////////////////////////////////////////////////////////////////////////////////
-	//////////////////////////  Start identification pipeline /////////////////////////////
-	///////////////////////////////////////////////////////////////////////////////////////
+	identifyIsotopes(handle->getDecomposer(), alphabet, handle->getElementsOrder(),
+			 handle->getContext(), peaklist_masses, peaklist_abundances, error,
+			 lower_bounds, upper_bounds, constraints, 
+			 static_cast<size_t>(Rf_asInteger(i_top)), 
+			 static_cast<size_t>(Rf_asInteger(i_max_results)), scores,
+			 &cache_hits, &cache_misses);
+
+	// Now output to R ...
+	if (scores.size() >0 ) {
+	  rl = PROTECT(rlistScores(scores, Rf_asInteger(z)));
+
+	  // hits and misses of the element distribution powers, as attribute "cache"
+	  SEXP cache = PROTECT(Rf_allocVector(REALSXP, 2));
+	  SEXP cache_names = PROTECT(Rf_allocVector(STRSXP, 2));
+	  REAL(cache)[0] = static_cast<double>(cache_hits);
+	  REAL(cache)[1] = static_cast<double>(cache_misses);
+	  SET_STRING_ELT(cache_names, 0, Rf_mkChar("hits"));
+	  SET_STRING_ELT(cache_names, 1, Rf_mkChar("misses"));
+	  Rf_setAttrib(cache, R_NamesSymbol, cache_names);
+	  Rf_setAttrib(rl, Rf_install("cache"), cache);
+	  UNPROTECT(3);
+	}
+    } catch(std::exception& ex) {
+      exceptionMesg = copyMessageToR(ex.what());
+      error_return(exceptionMesg); 
+    } catch(...) {
+      exceptionMesg = copyMessageToR("unknown reason");
+      error_return(exceptionMesg); 
+    }
+        
+    return rl;
 
-	// gets all possible decompositions for the monoisotopic mass with error allowed
-	decompositions_t decompositions = 
-		decomposer.getDecompositions(masses(0), error);
+}
 
-	score_type accumulated_score = 0.0;	
-	// for every decomposition:
-	// - chemical filter is applied
-	// - isotopic pattern is calculated
-	// - isotopic pattern is matched against input spectrum
+// }}}
+
+/**
+ * Identifies one isotope pattern of a batch, called by the worker threads
+ * of decomposeMasses. All inputs are shared read-only, every call writes
+ * only its own entry of @c scores.
+ */
+class IdentifyIsotopesTask {
+  // {{{ 
+
+ public:
+  typedef scorer_t::masses_container masses_container;
+  typedef scorer_t::abundances_container abundances_container;
+
+  IdentifyIsotopesTask(DecomposerHandle& handle,
+		       const vector<masses_container>& masses,
+		       const vector<abundances_container>& abundances,
+		       const vector<double>& errors,
+		       const decomposition_t& lower_bounds, 
+		       const decomposition_t& upper_bounds,
+		       const vector<LinearConstraint>& constraints,
+		       size_t top,
+		       size_t max_results,
+		       vector<scores_t>& scores) :
+    handle(handle), masses(masses), abundances(abundances), errors(errors),
+    lower_bounds(lower_bounds), upper_bounds(upper_bounds), 
+    constraints(constraints), top(top), max_results(max_results), scores(scores) {}
+
+  void operator()(size_t i) {
+    if (masses[i].empty()) {
+      return;
+    }
+    identifyIsotopes(handle.getDecomposer(), handle.getAlphabet(), 
+		     handle.getElementsOrder(), handle.getContext(),
+		     masses[i], abundances[i], errors[i],
+		     lower_bounds, upper_bounds, constraints, top, max_results, scores[i]);
+  }
+
+ private:
+  DecomposerHandle& handle;
+  const vector<masses_container>& masses;
+  const vector<abundances_container>& abundances;
+  const vector<double>& errors;
+  const decomposition_t& lower_bounds;
+  const decomposition_t& upper_bounds;
+  const vector<LinearConstraint>& constraints;
+  size_t top;
+  size_t max_results;
+  vector<scores_t>& scores;
+
+  // }}}
+};
+
+RcppExport SEXP decomposeMasses(SEXP l_masses, SEXP l_abundances, SEXP v_error, 
+				SEXP l_alphabet, SEXP v_element_order, 
+				SEXP z, SEXP i_maxisotopes,
+				SEXP s_minElements, SEXP s_maxElements,
+				SEXP l_filter, SEXP x_decomposer, SEXP i_threads,
+				SEXP d_precision, SEXP i_top, SEXP i_max_results) {
+// {{{ 
+
+    typedef IdentifyIsotopesTask::masses_container masses_container;
+    typedef IdentifyIsotopesTask::abundances_container abundances_container;
+
+    // Reset error state
+    exceptionMesg = NULL;
+
+    if (!Rf_isNewList(l_masses) || !Rf_isNewList(l_abundances)
+	|| Rf_length(l_masses) != Rf_length(l_abundances)
+	|| Rf_length(v_error) != Rf_length(l_masses)) {
+      Rf_error("masses, intensities and errors must be given for every pattern");
+    }
+
+    int number_patterns = Rf_length(l_masses);
+    int threads = Rf_asInteger(i_threads);
+    if (threads == NA_INTEGER || threads < 1) {
+      threads = 1;
+    }
+
+    SEXP  rl = PROTECT(Rf_allocVector(VECSXP, number_patterns));
+    try {
+
+	// copies all patterns out of R objects before any thread is started,
+	// worker threads must not touch the R API
+	vector<masses_container> masses(number_patterns);
+	vector<abundances_container> abundances(number_patterns);
+	vector<double> errors(number_patterns);
+	for (int pi = 0; pi < number_patterns; ++pi) {
+		SEXP v_masses = VECTOR_ELT(l_masses, pi);
+		SEXP v_abundances = VECTOR_ELT(l_abundances, pi);
+		int size = min(Rf_length(v_masses), Rf_length(v_abundances));
+		if (size < 1) {
+			continue;
+		}
+
+		// converts relative (ppm) in absolute error 
+		double error = REAL(v_error)[pi] * REAL(v_masses)[0] * 1.0e-06;
+
+		// patterns without a monoisotopic mass (NA) are skipped like empty ones
+		if (!std::isfinite(REAL(v_masses)[0]) || !std::isfinite(error)) {
+			continue;
+		}
+
+		masses[pi].assign(REAL(v_masses), REAL(v_masses) + size);
+		abundances[pi].assign(REAL(v_abundances), REAL(v_abundances) + size);
+		errors[pi] = error;
+	}
+
+	// uses the persistent decomposer if one is given, otherwise
+	// initializes alphabet, weights and decomposer once for all patterns
+	DecomposerHandle* handle = getDecomposerHandle(x_decomposer);
+	unique_ptr<DecomposerHandle> temporary_handle;
+	if (handle == NULL) {
+	  vector<double> monoisotopic_masses, monoisotopic_errors;
+	  for (int pi = 0; pi < number_patterns; ++pi) {
+	    if (!masses[pi].empty()) {
+	      monoisotopic_masses.push_back(masses[pi][0]);
+	      monoisotopic_errors.push_back(errors[pi]);
+	    }
+	  }
+	  temporary_handle.reset(
+	    new DecomposerHandle(l_alphabet, v_element_order, Rf_asInteger(i_maxisotopes),
+				 getPrecisionArgument(d_precision),
+				 monoisotopic_masses, monoisotopic_errors, 
+				 number_patterns));
+	  handle = temporary_handle.get();
+	}
+
+	const alphabet_t& alphabet = handle->getAlphabet();
+	int charge = Rf_asInteger(z);
 
 	// Initialize minimum/maximum element count "molecules"
 	ComposedElement minElements(CHAR(Rf_asChar(s_minElements)), alphabet);
 	ComposedElement maxElements(CHAR(Rf_asChar(s_maxElements)), alphabet);
+	decomposition_t lower_bounds, upper_bounds;
+	getElementBounds(alphabet, minElements, maxElements, lower_bounds, upper_bounds);
+
+	// initializes chemical filter
+	vector<LinearConstraint> constraints;
+	initializeConstraints(l_filter, alphabet, constraints);
+
+	// decomposes and scores all patterns, sharing the decomposer and 
+	// its residue table between threads
+	vector<scores_t> scores(number_patterns);
+	IdentifyIsotopesTask task(*handle, masses, abundances, errors,
+				  lower_bounds, upper_bounds, constraints, 
+				  static_cast<size_t>(Rf_asInteger(i_top)), 
+				  static_cast<size_t>(Rf_asInteger(i_max_results)), scores);
+	WorkStealingPool pool(threads);
+	pool.run(number_patterns, task);
 
-	for (decompositions_t::iterator decomps_it = decompositions.begin(); 
-		decomps_it != decompositions.end(); ++decomps_it) {
+	// Now output to R ...
+	for (int pi = 0; pi < number_patterns; ++pi) {
+		if (scores[pi].size() >0 ) {
+			SET_VECTOR_ELT(rl, pi, rlistScores(scores[pi], charge));
+		}
+	}
+    } catch(std::exception& ex) {
+      exceptionMesg = copyMessageToR(ex.what());
+      UNPROTECT(1);
+      error_return(exceptionMesg); 
+    } catch(...) {
+      exceptionMesg = copyMessageToR("unknown reason");
+      UNPROTECT(1);
+      error_return(exceptionMesg); 
+    }
 
-		// creates a candidate molecule out of elemental composition and a set of elements
-		ComposedElement candidate_molecule(*decomps_it, alphabet);
+    UNPROTECT(1);
+    return rl;
 
-		// Check minimum/maximum element counts
-		if (!isWithinElementRange(candidate_molecule, minElements, maxElements)) {
-			continue;
-		} 
+}
 
+// }}}
 
-		// checks on chemical filter
-// 		if (!isValidMyNitrogenRule(candidate_molecule, z)) {
-// 			continue;
-// 		} 
+/**
+ * Counts the decompositions of one mass of a batch, called by the worker
+ * threads of countDecompositions. Writes only its own entry of @c counts.
+ */
+class CountDecompositionsTask {
+  // {{{ 
 
+ public:
+  CountDecompositionsTask(const DecompositionCounter& counter,
+			  const double* masses, const double* errors,
+			  double* counts) :
+    counter(counter), masses(masses), errors(errors), counts(counts) {}
 
-		// updates molecules isotope distribution (since its not calculated upon creation: 
-		// it would be time consuming before applying chemical filter)
-		candidate_molecule.updateIsotopeDistribution();
-		// updates molecules sequence in a order of elements(atoms) one would like it
-		// to appear
-		candidate_molecule.updateSequence(&elements_order);
+  void operator()(size_t i) {
+    // masses of NA keep their count of NA
+    if (!std::isfinite(masses[i]) || !std::isfinite(errors[i])) {
+      return;
+    }
+    counts[i] = static_cast<double>(
+      counter.getNumberOfDecompositions(masses[i], errors[i]));
+  }
 
-		// gets a theoretical isotope distribution of the candidate molecule
-		IsotopeDistribution candidate_molecule_distribution = 
-				candidate_molecule.getIsotopeDistribution();
-		
-		// gets a sequence of the candidate molecule
-		string candidate_molecule_sequence = 
-				candidate_molecule.getSequence();
+ private:
+  const DecompositionCounter& counter;
+  const double* masses;
+  const double* errors;
+  double* counts;
 
-		// extracts masses and abundances from isotope distribution of the candidate molecule
-		masses_container candidate_masses = candidate_molecule_distribution.getMasses();
-		abundances_container candidate_abundances = candidate_molecule_distribution.getAbundances();
+  // }}}
+};
 
-		// normalizes candidate abundances if the size of the measured peaklist is less than 
-		// the size of theoretical isotope distribution. This is always the case since our
-		// theoretical distributions are limited to by default 10 peaks and measured peaklists contain
-		// less than 10 peaks
+RcppExport SEXP countDecompositions(SEXP v_masses, SEXP v_error, 
+				    SEXP l_alphabet, SEXP v_element_order, 
+				    SEXP i_maxisotopes,
+				    SEXP x_decomposer, SEXP i_threads) {
+// {{{ 
 
-		distribution_t::size_type size = min(peaklist_abundances.size(), candidate_abundances.size());
-		
-		if (size < candidate_abundances.size()) {
-			// normalizes the isotope distribution abundances with respect to the number of elements in peaklist
-			abundance_type sum = accumulate(candidate_abundances.begin(), 
-							candidate_abundances.begin() + size, 
-							0.0);
-			if (fabs(sum - 1) > IsotopeDistribution::ABUNDANCES_SUM_ERROR) {
-				abundance_type scale = 1/sum;
-				transform(candidate_abundances.begin(),			// begin of source range
-					candidate_abundances.begin() + size,		// end of source range
-					candidate_abundances.begin(), 			// destination
-					bind2nd(multiplies<abundance_type>(), scale));	// operation (*scale)
-			}
-				
-		}
+    // Reset error state
+    exceptionMesg = NULL;
 
-		// calculates a score
-		score_type score = scorer.score(candidate_masses, candidate_abundances);
+    if (!Rf_isReal(v_masses) || !Rf_isReal(v_error)
+	|| Rf_length(v_error) != Rf_length(v_masses)) {
+      Rf_error("masses and errors must be numeric vectors of the same length");
+    }
 
-		// stores the sequence with non-normalized score
-		nonnormalized_scores.push_back(make_pair(candidate_molecule, score));
+    int number_masses = Rf_length(v_masses);
+    int threads = Rf_asInteger(i_threads);
+    if (threads == NA_INTEGER || threads < 1) {
+      threads = 1;
+    }
 
-		// accumulates scores
-		accumulated_score += score;
+    SEXP  rl = PROTECT(Rf_allocVector(REALSXP, number_masses));
+    try {
 
+	// converts relative (ppm) in absolute errors
+	vector<double> errors(number_masses);
+	for (int i = 0; i < number_masses; ++i) {
+	  errors[i] = REAL(v_error)[i] * REAL(v_masses)[i] * 1.0e-06;
 	}
 
-	for (nonnormalized_scores_container::const_iterator it = nonnormalized_scores.begin(); it != nonnormalized_scores.end(); ++it) {
-		score_type normalized_score = it->second;
-		if (accumulated_score > 0.0) {
-			normalized_score /= accumulated_score;
-		}
-		// stores the sequence with the score
-		scores.insert(make_pair(normalized_score, it->first));
+	// counting needs the alphabet only, no residue table and 
+	// no precision
+	alphabet_t alphabet;
+	DecomposerHandle* handle = getDecomposerHandle(x_decomposer);
+	if (handle != NULL) {
+	  alphabet = handle->getAlphabet();
+	} else if (l_alphabet == NULL || Rf_length(l_alphabet) < 1) {
+	  distribution_t::context_type context;
+	  initializeCHNOPS(alphabet, Rf_asInteger(i_maxisotopes), context);
+	} else {
+	  distribution_t::context_type context;
+	  initializeAlphabet(l_alphabet, alphabet, Rf_asInteger(i_maxisotopes), context);
 	}
 
-	// Now output to R ...
-	if (scores.size() >0 ) {
-	  rl = rlistScores(scores, Rf_asInteger(z));
+	// counts without enumerating, one table of the lightest elements
+	// up to the largest mass for the whole batch, see 
+	// DecompositionCounter
+	if (number_masses > 0) {
+	  double max_mass = 1.0;
+	  for (int i = 0; i < number_masses; ++i) {
+	    if (std::isfinite(REAL(v_masses)[i]) && std::isfinite(errors[i])) {
+	      max_mass = std::max(max_mass, REAL(v_masses)[i] + errors[i]);
+	    } else {
+	      REAL(rl)[i] = NA_REAL;
+	    }
+	  }
+	  DecompositionCounter counter(alphabet.getMasses(), max_mass);
+	  CountDecompositionsTask task(counter, REAL(v_masses),
+				       &errors[0], REAL(rl));
+	  WorkStealingPool pool(threads);
+	  pool.run(number_masses, task);
 	}
+
     } catch(std::exception& ex) {
       exceptionMesg = copyMessageToR(ex.what());
+      UNPROTECT(1);
       error_return(exceptionMesg); 
     } catch(...) {
       exceptionMesg = copyMessageToR("unknown reason");
+      UNPROTECT(1);
       error_return(exceptionMesg); 
     }
-        
+
+    UNPROTECT(1);
     return rl;
 
 }
@@ -439,9 +1114,10 @@ RcppExport SEXP getMolecule(SEXP s_formula, SEXP l_alphabet,
   int maxisotopes = Rf_asInteger(i_maxisotopes);
   alphabet_t alphabet;
   vector<string> elements_order;
+  distribution_t::context_type context;
 
   if (l_alphabet == NULL || Rf_length(l_alphabet) < 1  ) {
-    initializeCHNOPS(alphabet, maxisotopes); 
+    initializeCHNOPS(alphabet, maxisotopes, context); 
     // initializes order of atoms in which one would
     // like them to appear in the molecules sequence
     elements_order.push_back("C");
@@ -451,7 +1127,7 @@ RcppExport SEXP getMolecule(SEXP s_formula, SEXP l_alphabet,
     elements_order.push_back("P");
     elements_order.push_back("S");
   } else {
-    initializeAlphabet(l_alphabet, alphabet, maxisotopes);
+    initializeAlphabet(l_alphabet, alphabet, maxisotopes, context);
 
     int element_length = Rf_length(v_element_order);
     for (int i=0; i<element_length; i++) {
@@ -472,7 +1148,7 @@ RcppExport SEXP getMolecule(SEXP s_formula, SEXP l_alphabet,
     ComposedElement molecule( CHAR(Rf_asChar(s_formula)), alphabet);
     
     molecule.updateSequence(&elements_order);
-    molecule.updateIsotopeDistribution();
+    molecule.updateIsotopeDistribution(context);
     
     scores.insert(make_pair(1.0, molecule));
     rl = rlistScores(scores, Rf_asInteger(z));
@@ -509,9 +1185,10 @@ RcppExport SEXP addMolecules(SEXP s_formula1, SEXP s_formula2, SEXP l_alphabet,
   int maxisotopes = Rf_asInteger(i_maxisotopes);
   alphabet_t alphabet;
   vector<string> elements_order;
+  distribution_t::context_type context;
 
   if (l_alphabet == NULL || Rf_length(l_alphabet) < 1  ) {
-    initializeCHNOPS(alphabet, maxisotopes);
+    initializeCHNOPS(alphabet, maxisotopes, context);
     // initializes order of atoms in which one would
     // like them to appear in the molecules sequence
     elements_order.push_back("C");
@@ -521,7 +1198,7 @@ RcppExport SEXP addMolecules(SEXP s_formula1, SEXP s_formula2, SEXP l_alphabet,
     elements_order.push_back("P");
     elements_order.push_back("S");
   } else {
-    initializeAlphabet(l_alphabet, alphabet, maxisotopes);    
+    initializeAlphabet(l_alphabet, alphabet, maxisotopes, context);    
 
     int element_length = Rf_length(v_element_order);
     for (int i=0; i<element_length; i++) {
@@ -544,7 +1221,7 @@ RcppExport SEXP addMolecules(SEXP s_formula1, SEXP s_formula2, SEXP l_alphabet,
   molecule += molecule2;
 
   molecule.updateSequence(&elements_order);
-  molecule.updateIsotopeDistribution();
+  molecule.updateIsotopeDistribution(context);
 
   scores.insert(make_pair(1.0, molecule));
   rl = rlistScores(scores, 0);
@@ -572,9 +1249,10 @@ RcppExport SEXP subMolecules(SEXP s_formula1, SEXP s_formula2, SEXP l_alphabet,
   int maxisotopes = Rf_asInteger(i_maxisotopes);
   alphabet_t alphabet;
   vector<string> elements_order;
+  distribution_t::context_type context;
 
   if (l_alphabet == NULL || Rf_length(l_alphabet) < 1  ) { 
-   initializeCHNOPS(alphabet, maxisotopes);
+   initializeCHNOPS(alphabet, maxisotopes, context);
     // initializes order of atoms in which one would
     // like them to appear in the molecules sequence
     elements_order.push_back("C");
@@ -584,7 +1262,7 @@ RcppExport SEXP subMolecules(SEXP s_formula1, SEXP s_formula2, SEXP l_alphabet,
     elements_order.push_back("P");
     elements_order.push_back("S");
   } else {
-    initializeAlphabet(l_alphabet, alphabet, maxisotopes);
+    initializeAlphabet(l_alphabet, alphabet, maxisotopes, context);
 
     int element_length = Rf_length(v_element_order);
     for (int i=0; i<element_length; i++) {
@@ -607,7 +1285,7 @@ RcppExport SEXP subMolecules(SEXP s_formula1, SEXP s_formula2, SEXP l_alphabet,
   molecule -= molecule2;
 
   molecule.updateSequence(&elements_order);
-  molecule.updateIsotopeDistribution();
+  molecule.updateIsotopeDistribution(context);
 
   scores.insert(make_pair(1.0, molecule));
   rl = rlistScores(scores, 0);
@@ -617,7 +1295,7 @@ RcppExport SEXP subMolecules(SEXP s_formula1, SEXP s_formula2, SEXP l_alphabet,
 // }}}
 
 template <typename score_type>
-SEXP  rlistScores(multimap<score_type, ComposedElement, greater<score_type> > scores, int z) {
+SEXP  rlistScores(const multimap<score_type, ComposedElement, greater<score_type> >& scores, int z) {
   // {{{ 
 
     typedef DistributionProbabilityScorer scorer_type;
@@ -703,7 +1381,8 @@ SEXP  rlistScores(multimap<score_type, ComposedElement, greater<score_type> > sc
 //
 // Initialisation of Standard Element Alphabet 
 //
-void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes) {
+void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes, 
+		      distribution_t::context_type& context) {
   // {{{ 
 
 	typedef distribution_t::peaks_container peaks_container;
@@ -711,8 +1390,7 @@ void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes) {
 	typedef alphabet_t::element_type element_type;
 	typedef alphabet_t::container elements_type;
 
-	distribution_t::SIZE = maxisotopes;
-	distribution_t::ABUNDANCES_SUM_ERROR = 0.00001;
+	context = distribution_t::context_type(maxisotopes, 0.00001);
 
 // Hydrogen
 	nominal_mass_type massH = 1;
@@ -720,7 +1398,7 @@ void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes) {
 	peaksH.push_back(peaks_container::value_type(0.007825, 0.99985));
 	peaksH.push_back(peaks_container::value_type(0.014102, 0.00015));
 
-	distribution_t distributionH(peaksH, massH);
+	distribution_t distributionH(peaksH, massH, context);
 
 // Oxygen
 	nominal_mass_type massO = 16;
@@ -729,7 +1407,7 @@ void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes) {
 	peaksO.push_back(peaks_container::value_type(-0.000868, 0.00038));
 	peaksO.push_back(peaks_container::value_type(-0.000839, 0.002));
 
-	distribution_t distributionO(peaksO, massO);
+	distribution_t distributionO(peaksO, massO, context);
 
 // Carbonate
 	nominal_mass_type massC = 12;
@@ -737,7 +1415,7 @@ void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes) {
 	peaksC.push_back(peaks_container::value_type(0.0, 0.9889));
 	peaksC.push_back(peaks_container::value_type(0.003355, 0.0111));
 
-	distribution_t distributionC(peaksC, massC);
+	distribution_t distributionC(peaksC, massC, context);
 
 // Nitrogen
 	nominal_mass_type massN = 14;
@@ -745,7 +1423,7 @@ void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes) {
 	peaksN.push_back(peaks_container::value_type(0.003074, 0.99634));
 	peaksN.push_back(peaks_container::value_type(0.000109, 0.00366));
 
-	distribution_t distributionN(peaksN, massN);
+	distribution_t distributionN(peaksN, massN, context);
 
 // Sulfur
 	nominal_mass_type massS = 32;
@@ -756,14 +1434,14 @@ void initializeCHNOPS(alphabet_t& chnops, const int maxisotopes) {
 	peaksS.push_back(peaks_container::value_type());
 	peaksS.push_back(peaks_container::value_type(-0.032919, 0.0002));
 
-	distribution_t distributionS(peaksS, massS);
+	distribution_t distributionS(peaksS, massS, context);
 
 // Phosphor
 	nominal_mass_type massP = 31;
 	peaks_container peaksP;
 	peaksP.push_back(peaks_container::value_type(-0.026238, 1.0));
 
-	distribution_t distributionP(peaksP, massP);
+	distribution_t distributionP(peaksP, massP, context);
 
 	element_type H("H", distributionH);
 	element_type C("C", distributionC);
@@ -808,7 +1486,8 @@ SEXP getListElement(SEXP list, char *str)
 
 void initializeAlphabet(const SEXP l_alphabet, 
 			alphabet_t &alphabet,
-			const int maxisotopes) {
+			const int maxisotopes,
+			distribution_t::context_type& context) {
   // {{{ 
 
   typedef distribution_t::peaks_container peaks_container;
@@ -816,8 +1495,7 @@ void initializeAlphabet(const SEXP l_alphabet,
   typedef alphabet_t::element_type element_type;
   typedef alphabet_t::container elements_type;
 
-  distribution_t::SIZE = maxisotopes;
-  distribution_t::ABUNDANCES_SUM_ERROR = 0.0001;
+  context = distribution_t::context_type(maxisotopes, 0.0001);
        
   for (int i=0; i < Rf_length(l_alphabet); i++) {
     SEXP l = VECTOR_ELT(l_alphabet,i);
@@ -836,7 +1514,7 @@ void initializeAlphabet(const SEXP l_alphabet,
     for (int j=0; j<numisotopes; j++) {
       peaks->push_back(peaks_container::value_type(mass[j], abundance[j]));
     }
-    distribution_t *distribution = new distribution_t(*peaks, nominalmass);
+    distribution_t *distribution = new distribution_t(*peaks, nominalmass, context);
 
     element_type element(symbol, *distribution);	
     alphabet.push_back(element);
@@ -846,6 +1524,48 @@ void initializeAlphabet(const SEXP l_alphabet,
 
 }
 
+/**
+ * Converts the chemical filter, a list of linear constraints given as
+ * list(coefficients=c(C=1, H=-0.5, ...), min=, max=), into constraints
+ * over the alphabet. Elements without coefficient get zero, coefficients
+ * of elements missing in the alphabet are dropped.
+ */
+void initializeConstraints(const SEXP l_filter,
+			   const alphabet_t &alphabet,
+			   vector<LinearConstraint> &constraints) {
+  // {{{ 
+
+  if (!Rf_isNewList(l_filter)) {
+    return;
+  }
+
+  for (int i=0; i < Rf_length(l_filter); i++) {
+    SEXP l = VECTOR_ELT(l_filter, i);
+    SEXP v_coefficients = getListElement(l, "coefficients");
+    SEXP names = Rf_getAttrib(v_coefficients, R_NamesSymbol);
+    if (!Rf_isReal(v_coefficients) || Rf_isNull(names)) {
+      throw invalid_argument("filter coefficients must be a numeric vector named by elements");
+    }
+
+    LinearConstraint::coefficients_type coefficients(alphabet.size(), 0.0);
+    for (int j=0; j < Rf_length(v_coefficients); j++) {
+      string name(CHAR(STRING_ELT(names, j)));
+      for (alphabet_t::size_type k = 0; k < alphabet.size(); ++k) {
+	if (alphabet.getName(k) == name) {
+	  coefficients[k] += REAL(v_coefficients)[j];
+	}
+      }
+    }
+
+    constraints.push_back(LinearConstraint(coefficients, 
+					   Rf_asReal(getListElement(l, "min")), 
+					   Rf_asReal(getListElement(l, "max"))));
+  }
+
+  // }}}
+
+}
+
 extern "C" {
 
   void R_init_disop(DllInfo *info)
@@ -857,7 +1577,10 @@ extern "C" {
       {"getMolecule", (void* (*)())&getMolecule, 4},
       {"addMolecules", (void* (*)())&addMolecules, 4},
       {"subMolecules", (void* (*)())&subMolecules, 4},
-      {"decomposeIsotopes", (void* (*)())&decomposeIsotopes, 9},
+      {"decomposeIsotopes", (void* (*)())&decomposeIsotopes, 14},
+      {"decomposeMasses", (void* (*)())&decomposeMasses, 15},
+      {"countDecompositions", (void* (*)())&countDecompositions, 7},
+      {"createDecomposer", (void* (*)())&createDecomposer, 7},
       {"calculateScore", (void* (*)())&calculateScore, 7},
       {NULL, NULL, 0}
     };
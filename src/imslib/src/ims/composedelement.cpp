@@ -196,13 +196,20 @@ void ComposedElement::updateSequence(const std::vector<name_type>* elements_orde
 
 
 void ComposedElement::updateIsotopeDistribution(){
+	this->updateIsotopeDistribution(this->getIsotopeDistribution().getContext());
+}
+
+
+void ComposedElement::updateIsotopeDistribution(
+							const isotopes_type::context_type& context){
 	// initializes store where folded distributions will be collected
-	isotopes_type isodistr;
+	isotopes_type isodistr(context);
 	// loops through elements and folds them first with themselves so often
 	// as their abundance in molecule is and then folds the result into store.
 	for (container::const_iterator it = elements.begin(); 
 								   it != elements.end(); ++it) {
 		isotopes_type element_isodistr = it->first.getIsotopeDistribution();
+		element_isodistr.setContext(context);
 		element_isodistr *= it->second;
 		isodistr *= element_isodistr;
 	}
@@ -174,11 +174,18 @@ class ComposedElement : public Element {
 		
 		/**
 		 * Updates isotope distribution by folding isotope distributions of elements
-		 * this composed element consists of.
+		 * this composed element consists of, with the context of the current
+		 * isotope distribution.
 		 * 
 		 */
 		void updateIsotopeDistribution();		
 
+		/**
+		 * Updates isotope distribution as above, but with the settings of
+		 * @c context, which the distribution keeps.
+		 */
+		void updateIsotopeDistribution(const isotopes_type::context_type& context);
+
 		/**
 		 * Destructor.
 		 */							
@@ -0,0 +1,400 @@
+#ifndef IMS_COMPACTRESIDUETABLE_H
+#define IMS_COMPACTRESIDUETABLE_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstddef>
+#include <ims/base/exception/invalidargumentexception.h>
+#include <ims/base/exception/ioexception.h>
+#include <ims/utils/mappedfile.h>
+#include <ims/utils/rangeminimum.h>
+#include <ims/decomp/residuetableformat.h>
+
+namespace ims {
+
+/**
+ * @brief Extended residue table stored in a single buffer with small entries.
+ *
+ * Every entry of the extended residue table is the smallest decomposable
+ * mass in the residue class r modulo the smallest alphabet mass, so it
+ * equals r + k * smallest mass. Only k is stored, which is bounded by the
+ * largest alphabet mass and fits into 32 bits for all practical alphabets
+ * and precisions, while the masses themselves do not.
+ *
+ * Columns (one per alphabet mass) lie one after another in one buffer,
+ * each starting on a cache line. A column equal to its predecessor, as
+ * found by Nijenhuis' improvement, shares the predecessor's storage.
+ *
+ * Every column is indexed for range minimum queries over its entries, see
+ * getMinimum(). The block minima of the index are stored after the
+ * entries and written with them.
+ *
+ * A table read from a file by read() uses the entries and block minima in
+ * place, so tables read from one memory-mapped file share its pages.
+ *
+ * @param ValueType Type of masses.
+ * @param EntryType Unsigned integer type of stored entries.
+ *
+ * @ingroup decomp
+ */
+template <typename ValueType, typename EntryType = unsigned int>
+class CompactResidueTable {
+	public:
+		/**
+		 * Type of masses.
+		 */
+		typedef ValueType value_type;
+
+		/**
+		 * Type of stored entries.
+		 */
+		typedef EntryType entry_type;
+
+		/**
+		 * Type of a column with masses, as used while filling the table.
+		 */
+		typedef std::vector<value_type> column_type;
+
+		typedef typename std::vector<entry_type>::size_type size_type;
+
+		/**
+		 * Default constructor, creates an empty table.
+		 */
+		CompactResidueTable() : smallest_mass(0), infty(0), column_length(0),
+			aligned_start(0), used(0), entries(0), minima(0) {}
+
+		CompactResidueTable(const CompactResidueTable& table);
+
+		CompactResidueTable& operator =(const CompactResidueTable& table);
+
+		/**
+		 * Clears the table and prepares it for @c number_of_columns columns
+		 * over residues modulo @c smallest_mass, @c infty standing for
+		 * "no decomposable mass".
+		 *
+		 * @throw InvalidArgumentException if masses up to @c infty can't be
+		 * stored in entries of @c entry_type.
+		 */
+		void reset(value_type smallest_mass, value_type infty, size_type number_of_columns);
+
+		/**
+		 * Appends @c column, which has one mass per residue.
+		 */
+		void appendColumn(const column_type& column);
+
+		/**
+		 * Appends a column equal to the last one, sharing its storage.
+		 */
+		void repeatColumn();
+
+		/**
+		 * Writes the table in ResidueTableFormat.
+		 */
+		void write(ResidueTableFormat::Writer& writer) const;
+
+		/**
+		 * Reads a table written by write(), keeping a reference to the 
+		 * reader's file instead of copying the entries.
+		 *
+		 * @throw IOException if the table is malformed.
+		 */
+		void read(ResidueTableFormat::Reader& reader);
+
+		/**
+		 * Gets the smallest decomposable mass with @c residue in @c column,
+		 * or infinity if there is none.
+		 */
+		value_type get(size_type column, value_type residue) const {
+			return decode(getColumn(column)[residue], residue);
+		}
+
+		/**
+		 * Gets the entries of @c column, to be decoded by decode().
+		 */
+		const entry_type* getColumn(size_type column) const {
+			return entries + column_offsets[column];
+		}
+
+		/**
+		 * Gets the mass stored as @c entry for @c residue.
+		 */
+		value_type decode(entry_type entry, value_type residue) const {
+			return entry == getEmptyEntry() ? infty : residue + entry * smallest_mass;
+		}
+
+		/**
+		 * Gets the smallest entry for the residues [@c first, @c last] 
+		 * in @c column.
+		 */
+		entry_type getMinimum(size_type column, value_type first, value_type last) const {
+			return range_minimum.getMinimum(getColumn(column),
+				minima + column_offsets[column] / column_length * range_minimum.getNumberOfMinima(),
+				static_cast<size_type>(first), static_cast<size_type>(last));
+		}
+
+		/**
+		 * Gets the entry standing for "no decomposable mass".
+		 */
+		static entry_type getEmptyEntry() {
+			return std::numeric_limits<entry_type>::max();
+		}
+
+		/**
+		 * Gets the value standing for "no decomposable mass".
+		 */
+		value_type infinity() const { return infty; }
+
+		/**
+		 * Gets the number of columns.
+		 */
+		size_type getNumberOfColumns() const { return column_offsets.size(); }
+
+		/**
+		 * Gets the number of columns with storage of their own.
+		 */
+		size_type getNumberOfStoredColumns() const {
+			return column_length == 0 ? 0 : used / column_length;
+		}
+
+		/**
+		 * Gets the number of bytes allocated by the table. Pages of a 
+		 * memory-mapped file the table was read from are not counted.
+		 */
+		std::size_t getMemoryUsage() const {
+			return buffer.capacity() * sizeof(entry_type) +
+				minima_buffer.capacity() * sizeof(entry_type) +
+				column_offsets.capacity() * sizeof(size_type) +
+				range_minimum.getMemoryUsage() +
+				(file.isMapped() ? 0 : file.size());
+		}
+
+	private:
+		/**
+		 * Number of entries per cache line, columns are padded to multiples of it.
+		 */
+		static size_type getEntriesPerCacheLine() {
+			return 64 / sizeof(entry_type) > 0 ? 64 / sizeof(entry_type) : 1;
+		}
+
+		/**
+		 * Moves the used entries into a new buffer for @c capacity entries
+		 * which starts on a cache line.
+		 */
+		void reallocate(size_type capacity);
+
+		/**
+		 * Builds the range minimum index of the column stored at @c offset.
+		 */
+		void indexColumn(size_type offset);
+
+		value_type smallest_mass;
+		value_type infty;
+		// number of entries per column including padding
+		size_type column_length;
+		// entries, the table starts at aligned_start
+		std::vector<entry_type> buffer;
+		size_type aligned_start;
+		// number of entries used after aligned_start
+		size_type used;
+		// start of every column relative to aligned_start
+		std::vector<size_type> column_offsets;
+		// file the entries were read from, if any
+		MappedFile file;
+		// first entry, either in buffer or in file
+		const entry_type* entries;
+		// range minimum index shared by all columns
+		RangeMinimum<entry_type> range_minimum;
+		// block minima of every stored column, one after another
+		std::vector<entry_type> minima_buffer;
+		// first block minimum, either in minima_buffer or in file
+		const entry_type* minima;
+};
+
+
+template <typename ValueType, typename EntryType>
+CompactResidueTable<ValueType, EntryType>::CompactResidueTable(
+		const CompactResidueTable& table) :
+	smallest_mass(table.smallest_mass), infty(table.infty),
+	column_length(table.column_length), aligned_start(0), used(0),
+	column_offsets(table.column_offsets), file(table.file), entries(table.entries),
+	range_minimum(table.range_minimum), minima_buffer(table.minima_buffer),
+	minima(table.minima) {
+	// copies owned entries and block minima, shares those read from a file
+	if (file.data() == 0 && table.entries != 0) {
+		reallocate(table.used);
+		std::copy(table.entries, table.entries + table.used, buffer.begin() + aligned_start);
+		minima = minima_buffer.empty() ? 0 : &minima_buffer[0];
+	}
+	used = table.used;
+}
+
+
+template <typename ValueType, typename EntryType>
+CompactResidueTable<ValueType, EntryType>&
+CompactResidueTable<ValueType, EntryType>::operator =(const CompactResidueTable& table) {
+	if (this != &table) {
+		CompactResidueTable copy(table);
+		smallest_mass = copy.smallest_mass;
+		infty = copy.infty;
+		column_length = copy.column_length;
+		buffer.swap(copy.buffer);
+		aligned_start = copy.aligned_start;
+		used = copy.used;
+		column_offsets.swap(copy.column_offsets);
+		file = copy.file;
+		entries = copy.entries;
+		range_minimum = copy.range_minimum;
+		minima_buffer.swap(copy.minima_buffer);
+		minima = copy.minima;
+	}
+	return *this;
+}
+
+
+template <typename ValueType, typename EntryType>
+void CompactResidueTable<ValueType, EntryType>::reset(value_type smallest_mass,
+		value_type infty, size_type number_of_columns) {
+	if (smallest_mass == 0 || infty / smallest_mass >= getEmptyEntry()) {
+		throw InvalidArgumentException(
+			"alphabet masses too large for the residue table, use a lower precision");
+	}
+	this->smallest_mass = smallest_mass;
+	this->infty = infty;
+	const size_type line = getEntriesPerCacheLine();
+	column_length = (static_cast<size_type>(smallest_mass) + line - 1) / line * line;
+	buffer.clear();
+	aligned_start = 0;
+	used = 0;
+	column_offsets.clear();
+	column_offsets.reserve(number_of_columns);
+	file = MappedFile();
+	entries = 0;
+	range_minimum.reset(static_cast<size_type>(smallest_mass));
+	minima_buffer.clear();
+	minima = 0;
+	// storage for all columns at once, growing column by column copies the
+	// table over and over. Only repeated columns leave some of it unused.
+	if (number_of_columns > 0) {
+		reallocate(number_of_columns * column_length);
+		minima_buffer.reserve(number_of_columns * range_minimum.getNumberOfMinima());
+	}
+}
+
+
+template <typename ValueType, typename EntryType>
+void CompactResidueTable<ValueType, EntryType>::appendColumn(const column_type& column) {
+	if (aligned_start + used + column_length > buffer.size()) {
+		reallocate(used + column_length);
+	}
+	entry_type* column_entries = &buffer[aligned_start + used];
+	for (size_type r = 0; r < static_cast<size_type>(smallest_mass); ++r) {
+		column_entries[r] = column[r] >= infty ? getEmptyEntry() :
+			static_cast<entry_type>((column[r] - r) / smallest_mass);
+	}
+	for (size_type r = static_cast<size_type>(smallest_mass); r < column_length; ++r) {
+		column_entries[r] = getEmptyEntry();
+	}
+	column_offsets.push_back(used);
+	used += column_length;
+	indexColumn(column_offsets.back());
+}
+
+
+template <typename ValueType, typename EntryType>
+void CompactResidueTable<ValueType, EntryType>::repeatColumn() {
+	column_offsets.push_back(column_offsets.back());
+}
+
+
+template <typename ValueType, typename EntryType>
+void CompactResidueTable<ValueType, EntryType>::reallocate(size_type capacity) {
+	const size_type line = getEntriesPerCacheLine();
+	std::vector<entry_type> new_buffer(capacity + line);
+	// address of the first entry modulo the cache line
+	std::size_t misalignment = reinterpret_cast<std::size_t>(&new_buffer[0]) % 64;
+	size_type new_start = misalignment == 0 ? 0 :
+		(64 - misalignment) / sizeof(entry_type) % line;
+	if (used > 0) {
+		std::copy(buffer.begin() + aligned_start, buffer.begin() + aligned_start + used,
+				  new_buffer.begin() + new_start);
+	}
+	buffer.swap(new_buffer);
+	aligned_start = new_start;
+	entries = &buffer[aligned_start];
+}
+
+
+template <typename ValueType, typename EntryType>
+void CompactResidueTable<ValueType, EntryType>::write(
+		ResidueTableFormat::Writer& writer) const {
+	writer.writeInteger(sizeof(entry_type));
+	writer.writeInteger(smallest_mass);
+	writer.writeInteger(infty);
+	writer.writeInteger(column_length);
+	writer.writeInteger(used);
+	writer.writeInteger(column_offsets.size());
+	for (size_type i = 0; i < column_offsets.size(); ++i) {
+		writer.writeInteger(column_offsets[i]);
+	}
+	writer.pad(ResidueTableFormat::getAlignment());
+	writer.writeBytes(entries, used * sizeof(entry_type));
+	writer.writeInteger(range_minimum.getBlockSize());
+	writer.writeInteger(range_minimum.getNumberOfMinima());
+	writer.pad(ResidueTableFormat::getAlignment());
+	writer.writeBytes(minima, getNumberOfStoredColumns() * 
+					  range_minimum.getNumberOfMinima() * sizeof(entry_type));
+}
+
+
+template <typename ValueType, typename EntryType>
+void CompactResidueTable<ValueType, EntryType>::read(
+		ResidueTableFormat::Reader& reader) {
+	if (reader.readInteger() != sizeof(entry_type)) {
+		throw IOException("residue table file has entries of another size");
+	}
+	smallest_mass = static_cast<value_type>(reader.readInteger());
+	infty = static_cast<value_type>(reader.readInteger());
+	column_length = static_cast<size_type>(reader.readInteger());
+	used = static_cast<size_type>(reader.readInteger());
+	if (smallest_mass == 0 || column_length < static_cast<size_type>(smallest_mass) ||
+			used % column_length != 0) {
+		throw IOException("residue table file is corrupt");
+	}
+	column_offsets.resize(static_cast<size_type>(reader.readInteger()));
+	for (size_type i = 0; i < column_offsets.size(); ++i) {
+		column_offsets[i] = static_cast<size_type>(reader.readInteger());
+		if (column_offsets[i] + column_length > used || 
+				column_offsets[i] % column_length != 0) {
+			throw IOException("residue table file is corrupt");
+		}
+	}
+	reader.pad(ResidueTableFormat::getAlignment());
+	file = reader.getFile();
+	entries = reinterpret_cast<const entry_type*>(
+		reader.readBytes(used * sizeof(entry_type)));
+	std::vector<entry_type>().swap(buffer);
+	aligned_start = 0;
+	range_minimum.reset(static_cast<size_type>(smallest_mass));
+	if (reader.readInteger() != range_minimum.getBlockSize() ||
+			reader.readInteger() != range_minimum.getNumberOfMinima()) {
+		throw IOException("residue table file has another range minimum index");
+	}
+	reader.pad(ResidueTableFormat::getAlignment());
+	std::vector<entry_type>().swap(minima_buffer);
+	minima = reinterpret_cast<const entry_type*>(reader.readBytes(
+		getNumberOfStoredColumns() * range_minimum.getNumberOfMinima() * sizeof(entry_type)));
+}
+
+
+template <typename ValueType, typename EntryType>
+void CompactResidueTable<ValueType, EntryType>::indexColumn(size_type offset) {
+	size_type start = minima_buffer.size();
+	minima_buffer.resize(start + range_minimum.getNumberOfMinima());
+	range_minimum.build(entries + offset, &minima_buffer[start]);
+	minima = &minima_buffer[0];
+}
+
+} // namespace ims
+
+#endif // IMS_COMPACTRESIDUETABLE_H
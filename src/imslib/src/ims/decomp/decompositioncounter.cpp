@@ -0,0 +1,275 @@
+#include <ims/decomp/decompositioncounter.h>
+#include <ims/decomp/linearconstraint.h>
+#include <ims/base/exception/invalidargumentexception.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace ims {
+
+namespace {
+
+/**
+ * Orders alphabet indices or table entries by their masses.
+ */
+class MassLess {
+	public:
+		MassLess(const std::vector<double>& masses) : masses(masses) {}
+		bool operator()(std::size_t i, std::size_t j) const {
+			return masses[i] < masses[j] || (masses[i] == masses[j] && i < j);
+		}
+	private:
+		const std::vector<double>& masses;
+};
+
+} // namespace
+
+
+DecompositionCounter::DecompositionCounter(const masses_type& alphabet_masses,
+		double max_mass, size_type max_table_size) :
+	alphabet_masses(alphabet_masses), max_mass(max_mass) {
+	if (alphabet_masses.empty()) {
+		throw InvalidArgumentException("alphabet is empty");
+	}
+	if (!(max_mass > 0.0)) {
+		throw InvalidArgumentException("largest mass is not positive");
+	}
+	std::vector<size_type> order;
+	for (size_type i = 0; i < alphabet_masses.size(); ++i) {
+		order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), MassLess(this->alphabet_masses));
+
+	// the combinations of the lightest j masses up to max_mass are at most
+	// the volume of the simplex of sides (max_mass + sum of the masses) / m_i
+	size_type tabulated = 1;
+	double sum = alphabet_masses[order[0]], product = alphabet_masses[order[0]];
+	for (size_type j = 2; j <= order.size(); ++j) {
+		sum += alphabet_masses[order[j-1]];
+		product *= alphabet_masses[order[j-1]] * j;
+		if (std::pow(max_mass + sum, static_cast<double>(j)) / product >
+				static_cast<double>(max_table_size)) {
+			break;
+		}
+		tabulated = j;
+	}
+	inner.assign(order.begin(), order.begin() + tabulated);
+	outer.assign(order.rbegin(), order.rend() - tabulated);
+
+	std::vector<double> unsorted_masses;
+	std::vector<unsigned int> unsorted_amounts, current(inner.size(), 0);
+	tabulate(0, 0.0, current, unsorted_masses, unsorted_amounts);
+
+	std::vector<size_type> permutation(unsorted_masses.size());
+	for (size_type i = 0; i < permutation.size(); ++i) {
+		permutation[i] = i;
+	}
+	std::sort(permutation.begin(), permutation.end(), MassLess(unsorted_masses));
+	masses.reserve(permutation.size());
+	amounts.reserve(unsorted_amounts.size());
+	for (size_type i = 0; i < permutation.size(); ++i) {
+		masses.push_back(unsorted_masses[permutation[i]]);
+		std::vector<unsigned int>::const_iterator entry_amounts =
+			unsorted_amounts.begin() + permutation[i] * inner.size();
+		amounts.insert(amounts.end(), entry_amounts, entry_amounts + inner.size());
+	}
+
+	// as many buckets as combinations, the last one holding the largest masses
+	size_type number_of_buckets = masses.size();
+	bucket_width = masses.back() / number_of_buckets;
+	if (!(bucket_width > 0.0)) {
+		bucket_width = 1.0;
+	}
+	buckets.reserve(number_of_buckets + 2);
+	for (size_type entry = 0; entry < masses.size(); ++entry) {
+		size_type bucket = std::min(number_of_buckets,
+			static_cast<size_type>(masses[entry] / bucket_width));
+		while (buckets.size() <= bucket) {
+			buckets.push_back(entry);
+		}
+	}
+	while (buckets.size() < number_of_buckets + 2) {
+		buckets.push_back(masses.size());
+	}
+}
+
+
+/**
+ * Adds all combinations of the tabulated masses from @c position on with
+ * the amounts chosen before and their @c mass.
+ */
+void DecompositionCounter::tabulate(size_type position, double mass,
+		std::vector<unsigned int>& current, std::vector<double>& unsorted_masses,
+		std::vector<unsigned int>& unsorted_amounts) {
+	if (position == inner.size()) {
+		unsorted_masses.push_back(mass);
+		unsorted_amounts.insert(unsorted_amounts.end(), current.begin(), current.end());
+		return;
+	}
+	// combinations slightly above max_mass may still be rounded into the window
+	const double limit = max_mass * (1.0 + 1.0e-12) + 2.0 * LinearConstraint::getTolerance();
+	const double alphabet_mass = alphabet_masses[inner[position]];
+	for (current[position] = 0; ; ++current[position]) {
+		double value = alphabet_mass * current[position] + mass;
+		if (value > limit) {
+			break;
+		}
+		tabulate(position + 1, value, current, unsorted_masses, unsorted_amounts);
+	}
+	current[position] = 0;
+}
+
+
+DecompositionCounter::number_of_decompositions_type
+DecompositionCounter::getNumberOfDecompositions(double mass, double error) const {
+	if (!std::isfinite(mass) || !std::isfinite(error)) {
+		// as RealMassDecomposer, nothing to decompose
+		return 0;
+	}
+	if (!(mass + error <= max_mass)) {
+		throw InvalidArgumentException("mass exceeds the largest mass of the counter");
+	}
+	Query query;
+	query.mass = mass;
+	query.error = error;
+	query.amounts.assign(alphabet_masses.size(), 0);
+	query.number = 0;
+	if (error >= 0.0) {
+		countOuter(0, 0.0, query);
+		// the empty decomposition isn't one
+		std::fill(query.amounts.begin(), query.amounts.end(), 0);
+		if (isWithinMassWindow(query)) {
+			--query.number;
+		}
+	}
+	return query.number;
+}
+
+
+/**
+ * Enumerates the amounts of the heavier masses from @c position on, @c mass
+ * being the mass of those chosen before.
+ */
+void DecompositionCounter::countOuter(size_type position, double mass,
+		Query& query) const {
+	if (position == outer.size()) {
+		countInner(mass, query);
+		return;
+	}
+	const double limit = query.mass + query.error + 2.0 * LinearConstraint::getTolerance();
+	const double alphabet_mass = alphabet_masses[outer[position]];
+	unsigned int& amount = query.amounts[outer[position]];
+	for (amount = 0; ; ++amount) {
+		double value = alphabet_mass * amount + mass;
+		if (value > limit) {
+			break;
+		}
+		countOuter(position + 1, value, query);
+	}
+	amount = 0;
+}
+
+
+/**
+ * Counts the combinations of the table completing the heavier masses of
+ * @c mass to the window. Those within a band of the limits are decided
+ * one by one.
+ */
+void DecompositionCounter::countInner(double mass, Query& query) const {
+	// the band covers the tolerance of the window and the rounding errors of
+	// different orders of summation
+	const double band = 2.0 * LinearConstraint::getTolerance();
+	const double low = query.mass - query.error - mass;
+	const double high = query.mass + query.error - mass;
+
+	size_type first = lowerBound(low - band), last = upperBound(high + band);
+	size_type inside_first = lowerBound(low + band), inside_last = upperBound(high - band);
+	if (inside_first < inside_last) {
+		query.number += inside_last - inside_first;
+	} else {
+		inside_first = inside_last = last;
+	}
+	for (size_type entry = first; entry < inside_first; ++entry) {
+		if (isWithinMassWindow(entry, query)) {
+			++query.number;
+		}
+	}
+	for (size_type entry = std::max(inside_last, first); entry < last; ++entry) {
+		if (isWithinMassWindow(entry, query)) {
+			++query.number;
+		}
+	}
+}
+
+
+/**
+ * Gets the first combination of the table whose mass is not below @c mass.
+ */
+DecompositionCounter::size_type DecompositionCounter::lowerBound(double mass) const {
+	if (mass <= 0.0) {
+		return 0;
+	}
+	size_type number_of_buckets = buckets.size() - 2;
+	double position = mass / bucket_width;
+	size_type bucket = position >= number_of_buckets ?
+		number_of_buckets : static_cast<size_type>(position);
+	return std::lower_bound(masses.begin() + buckets[bucket],
+		masses.begin() + buckets[bucket+1], mass) - masses.begin();
+}
+
+
+/**
+ * Gets the first combination of the table whose mass is above @c mass.
+ */
+DecompositionCounter::size_type DecompositionCounter::upperBound(double mass) const {
+	if (mass < 0.0) {
+		return 0;
+	}
+	size_type number_of_buckets = buckets.size() - 2;
+	double position = mass / bucket_width;
+	size_type bucket = position >= number_of_buckets ?
+		number_of_buckets : static_cast<size_type>(position);
+	return std::upper_bound(masses.begin() + buckets[bucket],
+		masses.begin() + buckets[bucket+1], mass) - masses.begin();
+}
+
+
+/**
+ * Returns true if the decomposition of the heavier masses of @c query and
+ * the combination @c entry lies within the mass window.
+ */
+bool DecompositionCounter::isWithinMassWindow(size_type entry, Query& query) const {
+	std::vector<unsigned int>::const_iterator entry_amounts =
+		amounts.begin() + entry * inner.size();
+	for (size_type i = 0; i < inner.size(); ++i) {
+		query.amounts[inner[i]] = entry_amounts[i];
+	}
+	bool within = isWithinMassWindow(query);
+	for (size_type i = 0; i < inner.size(); ++i) {
+		query.amounts[inner[i]] = 0;
+	}
+	return within;
+}
+
+
+/**
+ * Returns true if the decomposition of @c query lies within the mass
+ * window, summed up as by IntegerMassDecomposer::DecompositionCursor.
+ */
+bool DecompositionCounter::isWithinMassWindow(const Query& query) const {
+	double mass = 0.0;
+	for (size_type level = alphabet_masses.size(); level > 0; --level) {
+		mass = alphabet_masses[level-1] * query.amounts[level-1] + mass;
+	}
+	double distance = std::fabs(mass - query.mass) - query.error;
+	if (std::fabs(distance) > LinearConstraint::getTolerance()) {
+		return distance < 0.0;
+	}
+	mass = 0.0;
+	for (size_type level = 0; level < alphabet_masses.size(); ++level) {
+		mass += query.amounts[level] * alphabet_masses[level];
+	}
+	return std::fabs(mass - query.mass) <= query.error;
+}
+
+} // namespace ims
@@ -0,0 +1,124 @@
+#ifndef IMS_DECOMPOSITIONCOUNTER_H
+#define IMS_DECOMPOSITIONCOUNTER_H
+
+#include <vector>
+#include <cstddef>
+
+#include <ims/weights.h>
+
+namespace ims {
+
+/**
+ * @brief Counts the decompositions of real masses without enumerating
+ * them one by one.
+ *
+ * RealMassDecomposer::getNumberOfDecompositions() walks the decomposition
+ * tree, whose size grows with the number of decompositions. The counter
+ * instead tabulates once all combinations of the lightest alphabet masses
+ * up to a largest mass, sorted by their real mass, and for a query
+ * enumerates only the amounts of the heavier masses: the combinations
+ * completing them to the error window form a range of the table, found
+ * by two lookups in a bucket index. Combinations whose mass lies within
+ * a few rounding errors of the window limits are summed up again and
+ * decided as by RealMassDecomposer, so both count the same
+ * decompositions.
+ *
+ * As many alphabet masses are tabulated as the size of the table allows
+ * (see the constructor); for a query of mass @c M, the number of
+ * lookups grows with @c M to the power of the number of heavier masses.
+ * For CHNOPS up to 1000 Da, the table holds CHN and a query at 1000 Da
+ * enumerates about 10^4 amounts of OPS.
+ *
+ * @ingroup decomp
+ */
+class DecompositionCounter {
+	public:
+		/**
+		 * Type of alphabet masses.
+		 */
+		typedef Weights::alphabet_masses_type masses_type;
+
+		/**
+		 * Type of the number of decompositions.
+		 */
+		typedef unsigned long long number_of_decompositions_type;
+
+		/**
+		 * Type of sizes.
+		 */
+		typedef std::size_t size_type;
+
+		/**
+		 * Constructor tabulating the lightest of @c alphabet_masses up to
+		 * @c max_mass, taking as many as fit a table of
+		 * @c max_table_size combinations. At least the lightest mass is
+		 * tabulated. Throws InvalidArgumentException if the alphabet is
+		 * empty or @c max_mass is not positive.
+		 *
+		 * Unlike RealMassDecomposer, the counter works on real masses
+		 * only and has no precision.
+		 */
+		DecompositionCounter(const masses_type& alphabet_masses, double max_mass,
+							 size_type max_table_size = 2097152);
+
+		/**
+		 * Gets the number of decompositions of @c mass with @c error, as
+		 * RealMassDecomposer::getNumberOfDecompositions(), 0 if
+		 * @c mass or @c error is not finite. Throws
+		 * InvalidArgumentException if @c mass + @c error exceeds the
+		 * largest mass.
+		 */
+		number_of_decompositions_type getNumberOfDecompositions(double mass,
+																double error) const;
+
+		/**
+		 * Gets the largest mass that can be decomposed.
+		 */
+		double getMaxMass() const { return max_mass; }
+
+		/**
+		 * Gets the number of alphabet masses tabulated.
+		 */
+		size_type getNumberOfTabulatedMasses() const { return inner.size(); }
+
+		/**
+		 * Gets the number of combinations in the table.
+		 */
+		size_type getTableSize() const { return masses.size(); }
+
+	private:
+		/**
+		 * A query in progress, with the amounts of a decomposition.
+		 */
+		struct Query {
+			double mass, error;
+			std::vector<unsigned int> amounts;
+			number_of_decompositions_type number;
+		};
+
+		void tabulate(size_type position, double mass, std::vector<unsigned int>& current,
+					  std::vector<double>& unsorted_masses,
+					  std::vector<unsigned int>& unsorted_amounts);
+		void countOuter(size_type position, double mass, Query& query) const;
+		void countInner(double mass, Query& query) const;
+		size_type lowerBound(double mass) const;
+		size_type upperBound(double mass) const;
+		bool isWithinMassWindow(size_type entry, Query& query) const;
+		bool isWithinMassWindow(const Query& query) const;
+
+		masses_type alphabet_masses;
+		double max_mass;
+		// indices of the tabulated and enumerated alphabet masses
+		std::vector<size_type> inner, outer;
+		// masses of the combinations in ascending order, and their
+		// amounts, inner.size() per combination
+		std::vector<double> masses;
+		std::vector<unsigned int> amounts;
+		// index of the first combination of each bucket of masses
+		std::vector<size_type> buckets;
+		double bucket_width;
+};
+
+} // namespace ims
+
+#endif // IMS_DECOMPOSITIONCOUNTER_H
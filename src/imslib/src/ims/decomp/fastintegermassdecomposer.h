@@ -2,11 +2,16 @@
 #define FAST_IMS_INTEGERMASSDECOMPOSER_H
 
 #include <vector>
+#include <cmath>
 #include <utility>
 #include <limits>
+#include <algorithm>
+#include <cstddef>
 #include <ims/weights.h>
 #include <ims/utils/gcd.h>
 #include <ims/decomp/massdecomposer.h>
+#include <ims/decomp/residuetable.h>
+#include <ims/decomp/linearconstraint.h>
 
 namespace ims {
 
@@ -95,14 +100,78 @@ class FastIntegerMassDecomposer :
 
 		/**
 		 * Gets number of all possible decompositions for a given @c mass.
-		 * Since using getAllDecomposition() the usage of this function could 
-		 * be @b consuming.
+		 * Visits every decomposition, but doesn't store them.
 		 * 
 		 * @param mass Mass to be decomposed
 		 * @return number of decompositions for a given mass.
 		 */
 		virtual decomposition_value_type getNumberOfDecompositions(value_type mass);
-		
+
+		/**
+		 * Calls @c visitor(decomposition) for every possible decomposition 
+		 * of @c mass, without storing them. The decomposition passed is 
+		 * reused between calls and must be copied if it's to be kept.
+		 *
+		 * @param mass Mass to be decomposed.
+		 * @param visitor Functor taking a <tt>const decomposition_type&</tt>.
+		 */
+		template <typename DecompositionVisitor>
+		void visitAllDecompositions(value_type mass, DecompositionVisitor& visitor) const;
+
+		/**
+		 * Same as visitAllDecompositions(value_type, DecompositionVisitor&), 
+		 * but visits only decompositions whose amounts lie within 
+		 * [@c lower_bounds[i], @c upper_bounds[i]] for every alphabet mass i.
+		 *
+		 * @see DecompositionCursor::setBounds()
+		 */
+		template <typename DecompositionVisitor>
+		void visitAllDecompositions(value_type mass, const decomposition_type& lower_bounds,
+									const decomposition_type& upper_bounds,
+									DecompositionVisitor& visitor) const;
+
+		/**
+		 * Same interface as IntegerMassDecomposer::visitDecompositionsInRange(),
+		 * but decomposes the masses one after another.
+		 */
+		template <typename DecompositionVisitor>
+		void visitDecompositionsInRange(value_type low, value_type high,
+										DecompositionVisitor& visitor) const;
+
+		/**
+		 * Same interface as IntegerMassDecomposer::visitDecompositionSeries(),
+		 * but every series has one member only, since the iterative 
+		 * algorithm doesn't solve the smallest alphabet masses in closed form.
+		 */
+		template <typename SeriesVisitor>
+		void visitDecompositionSeries(value_type mass, SeriesVisitor& visitor) const;
+
+		/**
+		 * Gets the upper bound meaning "no limit" on the amount of an alphabet mass.
+		 */
+		static decomposition_value_type getUnboundedAmount() {
+			return std::numeric_limits<decomposition_value_type>::max();
+		}
+
+		/**
+		 * Gets the number of bytes allocated for the residue table and 
+		 * the other data structures built by the constructor.
+		 */
+		std::size_t getMemoryUsage() const {
+			std::size_t usage = sizeof(*this) + 
+				ertable.capacity() * sizeof(residues_table_row_type) +
+				(lcms.capacity() + mass_in_lcms.capacity()) * sizeof(value_type) +
+				witness_vector.capacity() * sizeof(typename witness_vector_type::value_type);
+			for (typename residues_table_type::const_iterator it = ertable.begin(); 
+					it != ertable.end(); ++it) {
+				usage += it->capacity() * sizeof(value_type);
+			}
+			return usage;
+		}
+
+		class DecompositionCursor;
+		friend class DecompositionCursor;
+
 	private:
 	
 		/**
@@ -156,13 +225,6 @@ class FastIntegerMassDecomposer :
 		 */
 		witness_vector_type witness_vector;
 
-		/**
-		 * Fills the extended residues table.
-		 */
-		void fillExtendedResidueTable(const Weights& _alphabet, residues_table_row_type& _lcms,
-									  residues_table_row_type& _mass_in_lcms, const value_type _infty,
-									  witness_vector_type& _witness_vector, residues_table_type& _ertable);
-
 		/**
 		 * Collects decompositions for @c mass by recursion. 
 		 *
@@ -173,194 +235,223 @@ class FastIntegerMassDecomposer :
 		 */
 		 void collectDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
 				decomposition_type decomposition, decompositions_type& decompositionsStore);
+
+		/**
+		 * Visitor that copies every decomposition into a container.
+		 */
+		class DecompositionsCollector {
+			public:
+				DecompositionsCollector(decompositions_type& decompositions) :
+					decompositions(decompositions) {}
+				void operator()(const decomposition_type& decomposition) {
+					decompositions.push_back(decomposition);
+				}
+			private:
+				decompositions_type& decompositions;
+		};
+
+		/**
+		 * Visitor that passes every decomposition on as a series of one.
+		 */
+		template <typename SeriesVisitor>
+		class SingleSeriesVisitor {
+			public:
+				SingleSeriesVisitor(SeriesVisitor& visitor) : visitor(visitor) {}
+				void operator()(const decomposition_type& decomposition) {
+					visitor(decomposition, 0, 0, 1);
+				}
+			private:
+				SeriesVisitor& visitor;
+		};
+
+		/**
+		 * Visitor that counts decompositions.
+		 */
+		class DecompositionsCounter {
+			public:
+				DecompositionsCounter() : number_of_decompositions(0) {}
+				void operator()(const decomposition_type&) {
+					++number_of_decompositions;
+				}
+				decomposition_value_type number_of_decompositions;
+		};
 };
 
 
+/**
+ * @brief Iterates over all decompositions of a mass one at a time.
+ *
+ * Implements the iterative algorithm of the paper as a resumable state 
+ * machine: next() runs it up to the next decomposition and returns.
+ * All buffers are allocated once by the constructor and reused by reset().
+ * The decomposer must outlive the cursor and is only read.
+ *
+ * @see IntegerMassDecomposer::DecompositionCursor
+ */
 template <typename ValueType, typename DecompositionValueType>
-FastIntegerMassDecomposer<ValueType, DecompositionValueType>::FastIntegerMassDecomposer(
-            const Weights& alphabet) : alphabet(alphabet){
+class FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor {
+	public:
+		/**
+		 * Constructor with decomposer whose decompositions are iterated.
+		 */
+		DecompositionCursor(const FastIntegerMassDecomposer& decomposer);
 
-	lcms.reserve(alphabet.size());
-	lcms.resize(alphabet.size());
+		/**
+		 * Restricts the amount of every alphabet mass i to 
+		 * [@c lower_bounds[i], @c upper_bounds[i]] for all following resets.
+		 * 
+		 * Unlike IntegerMassDecomposer::DecompositionCursor::setBounds() 
+		 * the bounds don't prune the enumeration, decompositions out of 
+		 * bounds are skipped once found.
+		 */
+		void setBounds(const decomposition_type& lower_bounds, 
+					   const decomposition_type& upper_bounds);
 
-	mass_in_lcms.reserve(alphabet.size());
-	mass_in_lcms.resize(alphabet.size());
+		/**
+		 * Removes the bounds set by setBounds().
+		 */
+		void clearBounds();
 
-	infty = alphabet.getWeight(0) * alphabet.getWeight(alphabet.size()-1);
+		/**
+		 * Adds @c constraint for all following resets. As with the bounds, 
+		 * decompositions not satisfying it are skipped once found.
+		 */
+		void addConstraint(const LinearConstraint& constraint) {
+			constraints.push_back(constraint);
+		}
 
-	fillExtendedResidueTable(alphabet, lcms, mass_in_lcms, infty, witness_vector, ertable);
+		/**
+		 * Removes all constraints added by addConstraint().
+		 */
+		void clearConstraints() { constraints.clear(); }
 
-}
+		/**
+		 * Restricts all following resets to the decompositions whose real 
+		 * mass lies within @c error of @c mass. As with the bounds, 
+		 * decompositions outside the window are skipped once found.
+		 *
+		 * @see IntegerMassDecomposer::DecompositionCursor::setMassWindow()
+		 */
+		void setMassWindow(double mass, double error) {
+			windowed = true;
+			window_mass = mass;
+			window_error = error;
+		}
 
+		/**
+		 * Removes the mass window set by setMassWindow().
+		 */
+		void clearMassWindow() { windowed = false; }
 
-template <typename ValueType, typename DecompositionValueType>
-void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::fillExtendedResidueTable(
-	const Weights& _alphabet, residues_table_row_type& _lcms, residues_table_row_type& _mass_in_lcms,
-	const value_type _infty, witness_vector_type& _witnessVector, residues_table_type& _ertable) {
+		/**
+		 * Gets the real mass of the current decomposition. Only valid after 
+		 * next() returned true with a mass window set.
+		 */
+		double getMass() const { return current_mass; }
 
-	if (_alphabet.size() < 2) {
-		return;
-	}
-	// caches the most often used mass - smallest mass
-	value_type smallestMass = _alphabet.getWeight(0), secondMass = _alphabet.getWeight(1);
+		/**
+		 * Starts iterating the decompositions of @c mass.
+		 */
+		void reset(value_type mass) { reset(mass, mass); }
+
+		/**
+		 * Starts iterating the decompositions of all masses in 
+		 * [@c low, @c high], one mass after another.
+		 */
+		void reset(value_type low, value_type high);
 
-	// initializes table: infinity everywhere except in the first field of every column
-	_ertable.reserve(_alphabet.size());
-	_ertable.assign(_alphabet.size(), std::vector<value_type>(smallestMass, _infty));
+		/**
+		 * Moves to the next decomposition. 
+		 *
+		 * @return false if there are no more decompositions.
+		 */
+		bool next();
 
-	for (size_type i = 0; i < _alphabet.size(); ++i) {
-		_ertable[i][0] = 0;
-	}
+		/**
+		 * Gets the current decomposition. Only valid after next() returned true.
+		 */
+		const decomposition_type& current() const { return decomposition; }
 
-	// initializes witness vector
-	_witnessVector.reserve(smallestMass);
-	_witnessVector.resize(smallestMass);
-
-	// fills second column (the first one is already correct)
-	size_type it_inc = secondMass % smallestMass, witness = 1;
-	typename residues_table_row_type::iterator it = _ertable[1].begin() + it_inc;
-	value_type mass = secondMass;
-	// initializes counter to create a witness vector
-	decomposition_value_type counter = 0;
-	while (it != _ertable[1].begin()) {
-		*it = mass;
-		mass += secondMass;
-		++counter;
-		_witnessVector[it - _ertable[1].begin()] = std::make_pair(witness, counter);
-		it += it_inc;
-		if (it >= _ertable[1].end()) {
-			it -= _ertable[1].size();
-		}
-	}
-	// fills cache variables for i==1
-	value_type d = gcd(smallestMass, secondMass);
-	_lcms[1] = secondMass*smallestMass / d;
-	_mass_in_lcms[1] = smallestMass / d;
-
-	// fills remaining table. i is the column index.
-	for (size_type i = 2; i < _alphabet.size(); ++i) {
-		// caches often used i-th alphabet mass
-		value_type currentMass = _alphabet.getWeight(i);
-
-		value_type d = gcd(smallestMass, currentMass);
-
-		// fills cache for various variables.
-		// note that values for i==0 are never assigned since they're unused anyway.
-		_lcms[i] = currentMass*smallestMass / d;
-		_mass_in_lcms[i] = smallestMass / d;
-
-		// Nijenhuis' improvement: Is currentMass composable with smaller alphabet?
-		if (currentMass >= _ertable[i-1][currentMass % smallestMass]) {
-			_ertable[i] = _ertable[i-1];
-			continue;
-		}
+		/**
+		 * Type of the number of decompositions.
+		 */
+		typedef unsigned long long number_of_decompositions_type;
 
-		const residues_table_row_type& prev_column = _ertable[i-1];
-		residues_table_row_type& cur_column = _ertable[i];
-
-		if (d == 1) {
-			// This loop is for the case that the gcd is 1. The optimization used below
-			// is not applicable here.
-
-			// p_inc is used to change residue (p) efficiently
-			size_type p_inc = currentMass % smallestMass;
-
-			// n is the value that will be written into the table
-			value_type n = 0;
-			// current residue (in paper variable 'r' is used)
-			size_type p = 0;
-			// counter for creation of witness vector
-			decomposition_value_type counter = 0;
-
-			for (size_type m = smallestMass; m > 0; --m) {
-				n += currentMass;
-				p += p_inc;
-				++counter;
-				if (p >= smallestMass) {
-					p -= smallestMass;
-				}
-				if (n > prev_column[p]) {
-					n = prev_column[p];
-					counter = 0;
-				} else {
-					_witnessVector[p] = std::make_pair(i, counter);
-				}
-				cur_column[p] = n;
+		/**
+		 * Counts the decompositions that next() would still return, one by
+		 * one, and finishes the iteration.
+		 *
+		 * @see IntegerMassDecomposer::DecompositionCursor::count()
+		 */
+		number_of_decompositions_type count() {
+			number_of_decompositions_type number = 0;
+			while (next()) {
+				++number;
 			}
+			return number;
 		}
-		else {
-			// If we're here, the gcd is not 1. We can use the following cache-optimized
-			// version of the algorithm. The trick is to put the iteration over all
-			// residue classes into the _inner_ loop.
-			//
-			// One could see it as going through one column in blocks which are gcd entries long.
-			size_type cur = currentMass % smallestMass;
-			size_type prev = 0;
-			size_type p_inc = cur-d;
-			// counters for creation of one witness vector
-			std::vector<decomposition_value_type> counters(smallestMass);
-
-			// copies first block from prev_column to cur_column
-			for (size_type j = 1; j < d; ++j) {
-				cur_column[j] = prev_column[j];
-			}
 
-			// first loop: goes through all blocks, updating cur_column for the first time.
-			for (size_type m = smallestMass / d; m > 1; m--) {
-				// r: current residue class
-				for (size_type r = 0; r < d; r++) {
-
-					++counters[cur];
-					if (cur_column[prev] + currentMass > prev_column[cur]) {
-						cur_column[cur] = prev_column[cur];
-						counters[cur] = 0;
-					} else {
-						cur_column[cur] = cur_column[prev] + currentMass;
-						_witnessVector[cur] = std::make_pair(i, counters[cur]);
-					}
-
-					prev++;
-					cur++;
-				}
+		/**
+		 * Gets the highest index whose amount may differ from the previous
+		 * decomposition. 
+		 *
+		 * @see IntegerMassDecomposer::DecompositionCursor::getChangedLevel()
+		 */
+		size_type getChangedLevel() const { return changed_level; }
 
-				prev = cur - d;
+	private:
+		void restart(value_type mass);
+		void ascend();
+		bool nextUnbounded();
+		bool isWithinBounds() const;
+		bool satisfiesConstraints() const;
+		bool isWithinMassWindow();
+		void returnFromRecursion();
+
+		const FastIntegerMassDecomposer& decomposer;
+
+		// corresponds 'k' in paper
+		size_type size;
+		// corresponds compomer 'c' in paper	
+		decomposition_type decomposition;
+		// stores amounts of current element (variable 'j' in paper)
+		std::vector<value_type> amounts;
+		// stores mass rests (variable 'm' in paper)
+		std::vector<value_type> mass_rests;
+		// stores left bounds for mass rests (variable 'lbound' in paper)
+		std::vector<value_type> lbounds;
+
+		size_type index;
+		bool isInWhileLoop, started;
+		// mass being decomposed and last mass of the range
+		value_type mass, high;
+
+		decomposition_type lower_bounds, upper_bounds;
+		bool bounded;
+		std::vector<LinearConstraint> constraints;
+		bool windowed;
+		double window_mass, window_error, current_mass;
+		// highest index changed since the previous decomposition
+		size_type changed_level;
+};
 
-				// this does: cur = (cur + currentMass) % smallestMass - d;
-				cur += p_inc;
-				if (cur >= smallestMass) {
-					cur -= smallestMass;
-				}
-			}
 
-			// second loop:
-			bool cont = true;
-			while (cont) {
-				cont = false;
-				prev++;
-				cur++;
-				++counters[cur];
-				for (size_type r = 1; r < d; ++r) {
-					if (cur_column[prev] + currentMass < cur_column[cur]) {
-						cur_column[cur] = cur_column[prev] + currentMass;
-						cont = true;
-						_witnessVector[cur] = std::make_pair(i, counters[cur]);
-					} else {
-						counters[cur] = 0;
-					}
-					prev++;
-					cur++;
-				}
+template <typename ValueType, typename DecompositionValueType>
+FastIntegerMassDecomposer<ValueType, DecompositionValueType>::FastIntegerMassDecomposer(
+            const Weights& alphabet) : alphabet(alphabet){
 
-				prev = cur - d;
+	lcms.reserve(alphabet.size());
+	lcms.resize(alphabet.size());
 
-				cur += p_inc;
-				if (cur >= smallestMass) {
-					cur -= smallestMass;
-				}
-			}
-		}
+	mass_in_lcms.reserve(alphabet.size());
+	mass_in_lcms.resize(alphabet.size());
+
+	infty = alphabet.getWeight(0) * alphabet.getWeight(alphabet.size()-1);
+
+	ResidueColumns<value_type> columns(ertable);
+	ResidueTable<value_type, decomposition_value_type>::fill(
+		alphabet, infty, lcms, mass_in_lcms, witness_vector, columns);
 
-	}
 }
 
 
@@ -412,51 +503,229 @@ typename FastIntegerMassDecomposer<ValueType, DecompositionValueType>::decomposi
 FastIntegerMassDecomposer<ValueType, DecompositionValueType>::
 getAllDecompositions(value_type mass) {
 	decompositions_type decompositions;
+	DecompositionsCollector collector(decompositions);
+	visitAllDecompositions(mass, collector);
+	return decompositions;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitAllDecompositions(value_type mass, DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	for (cursor.reset(mass); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitAllDecompositions(value_type mass, const decomposition_type& lower_bounds,
+					   const decomposition_type& upper_bounds,
+					   DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	cursor.setBounds(lower_bounds, upper_bounds);
+	for (cursor.reset(mass); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
 
-         // corresponds 'k' in paper
-        Weights::size_type size = alphabet.size();
 
-	// corresponds compomer 'c' in paper	
-	decomposition_type decomposition(size);
- 
-	// initializes max value of type that mass has
-	value_type max_value = std::numeric_limits<value_type>::max();
+template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitDecompositionsInRange(value_type low, value_type high, 
+						   DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	for (cursor.reset(low, high); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
+
 
-	std::vector<value_type> amounts(size),	// stores amounts of current element (variable 'j' in paper)
-		mass_rests(size),		// stores mass rests (variable 'm' in paper)
-		residues(size),			// stores residues (variable 'r' in paper)
-		lbounds(size, max_value);	// stores left bounds for mass rests (variable 'lbound' in paper)
+template <typename ValueType, typename DecompositionValueType>
+template <typename SeriesVisitor>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitDecompositionSeries(value_type mass, SeriesVisitor& visitor) const {
+	SingleSeriesVisitor<SeriesVisitor> single_series_visitor(visitor);
+	visitAllDecompositions(mass, single_series_visitor);
+}
 
-        bool isInWhileLoop = false;
 
-        // initializes mass rests
-        mass_rests[size-1] = mass;
+template <typename ValueType, typename DecompositionValueType>
+FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+DecompositionCursor(const FastIntegerMassDecomposer& decomposer) :
+	decomposer(decomposer), size(decomposer.alphabet.size()), 
+	decomposition(size), amounts(size), mass_rests(size), lbounds(size),
+	index(size), isInWhileLoop(false), started(false), mass(1), high(0), 
+	bounded(false), windowed(false), window_mass(0.0), window_error(0.0), 
+	current_mass(0.0), changed_level(0) {
+}
 
-        Weights::size_type index = size - 1;
 
-        while (index != size) {
+template <typename ValueType, typename DecompositionValueType>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+setBounds(const decomposition_type& lower_bounds, const decomposition_type& upper_bounds) {
+	this->lower_bounds = lower_bounds;
+	this->upper_bounds = upper_bounds;
+	bounded = true;
+}
 
-// 		std::cout << "index = " << index << ", isInWhileLoop = " << isInWhileLoop << ", amount = " << amounts[index]
-// 			<< "mass_rest = " << mass_rests[index] << '\n';
+
+template <typename ValueType, typename DecompositionValueType>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+clearBounds() {
+	bounded = false;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+bool FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+isWithinBounds() const {
+	for (size_type i = 0; i < size; ++i) {
+		if (decomposition[i] < lower_bounds.at(i) || decomposition[i] > upper_bounds.at(i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+reset(value_type low, value_type high) {
+	this->mass = low;
+	this->high = high;
+	if (low <= high) {
+		restart(low);
+	} else {
+		// nothing to decompose
+		index = size;
+		started = true;
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+restart(value_type mass) {
+	std::fill(decomposition.begin(), decomposition.end(), 0);
+	std::fill(amounts.begin(), amounts.end(), 0);
+	std::fill(lbounds.begin(), lbounds.end(), std::numeric_limits<value_type>::max());
+
+	// initializes mass rests
+	mass_rests[size-1] = mass;
+	index = size - 1;
+	isInWhileLoop = false;
+	started = false;
+	changed_level = size - 1;
+}
+
+
+/**
+ * Goes up one index, keeping track of the highest index changed.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+ascend() {
+	++index;
+	if (index > changed_level && index < size) {
+		changed_level = index;
+	}
+}
+
+
+/**
+ * "returns" from recursion (see the paper) after a decomposition was found.
+ */
+template <typename ValueType, typename DecompositionValueType>
+void FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+returnFromRecursion() {
+	ascend();
+	if (index == size) {
+		return;
+	}
+	isInWhileLoop = true;
+	// executes the rest of while-loop (see the paper)
+	if (mass_rests[index-1] >= decomposer.lcms[index]) {
+		mass_rests[index-1] -= decomposer.lcms[index];
+		decomposition[index] += decomposer.mass_in_lcms[index];
+	} else {
+		isInWhileLoop = false;
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+bool FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+satisfiesConstraints() const {
+	for (typename std::vector<LinearConstraint>::size_type c = 0; c < constraints.size(); ++c) {
+		if (!constraints[c].isSatisfied(decomposition)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+bool FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+isWithinMassWindow() {
+	if (!windowed) {
+		return true;
+	}
+	current_mass = 0.0;
+	for (size_type i = 0; i < size; ++i) {
+		current_mass += decomposition[i] * decomposer.alphabet.getAlphabetMass(i);
+	}
+	return std::fabs(current_mass - window_mass) <= window_error;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+bool FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+next() {
+	if (started) {
+		changed_level = 0;
+	}
+	for (;;) {
+		while (nextUnbounded()) {
+			if ((!bounded || isWithinBounds()) && satisfiesConstraints() && 
+					isWithinMassWindow()) {
+				return true;
+			}
+		}
+		if (mass >= high) {
+			return false;
+		}
+		restart(++mass);
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+bool FastIntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+nextUnbounded() {
+	const Weights& alphabet = decomposer.alphabet;
+
+	// continues where the last decomposition was found
+	if (started && index == 0) {
+		returnFromRecursion();
+	}
+	started = true;
+
+        while (index != size) {
 
             if (index == 0) {
 		value_type amount0 = mass_rests[index] / alphabet.getWeight(0);
 		if (amount0 * alphabet.getWeight(0) == mass_rests[index]) {
-			decomposition_type decomposition_copy(decomposition);
-			decomposition_copy[0] = static_cast<decomposition_value_type>(amount0);
-			decompositions.push_back(decomposition_copy);
-		}
-
-                // "returns" from recursion (see the paper)
-                ++index;
-                isInWhileLoop = true;
-                // executes the rest of while-loop (see the paper)
-		if (mass_rests[index-1] >= lcms[index]) {
-			mass_rests[index-1] -= lcms[index];
-			decomposition[index] += mass_in_lcms[index];
-		} else {
-			isInWhileLoop = false;
+			decomposition[0] = static_cast<decomposition_value_type>(amount0);
+			return true;
 		}
+		returnFromRecursion();
 
             } else {
                 // if we are in the while loop (see the paper)
@@ -470,13 +739,12 @@ getAllDecompositions(value_type mass) {
                     }
                 // if we are in the for loop (see the paper)
                 } else {
-                    if (amounts[index] < mass_in_lcms[index] && // checks the conditions of the for loop 
+                    if (amounts[index] < decomposer.mass_in_lcms[index] && // checks the conditions of the for loop 
                             mass_rests[index] >= amounts[index] * alphabet.getWeight(index)) {
 
                         decomposition[index] = static_cast<decomposition_value_type>(amounts[index]);
                         mass_rests[index-1] = mass_rests[index] - amounts[index] * alphabet.getWeight(index);
-                        residues[index] = mass_rests[index-1] % alphabet.getWeight(0);
-                        lbounds[index] = ertable[index-1][residues[index]];
+                        lbounds[index] = decomposer.ertable[index-1][mass_rests[index-1] % alphabet.getWeight(0)];
 
                         // enters in while loop
                         isInWhileLoop = true;
@@ -487,17 +755,17 @@ getAllDecompositions(value_type mass) {
                         // exits for loop
                         // "returns" from recursion, to do this
                         // resets functions variables
-                        lbounds[index] = max_value;
+                        lbounds[index] = std::numeric_limits<value_type>::max();
                         amounts[index] = 0;
                         decomposition[index] = 0;
-                        ++index;
+                        ascend();
                         // if we are not yet done with recursions
                         if (index != size) {
                             // we are back from recursion to while loop
                             isInWhileLoop = true;
-			    if (mass_rests[index-1] >= lcms[index]) {
-				mass_rests[index-1] -= lcms[index];
-				decomposition[index] += mass_in_lcms[index];
+			    if (mass_rests[index-1] >= decomposer.lcms[index]) {
+				mass_rests[index-1] -= decomposer.lcms[index];
+				decomposition[index] += decomposer.mass_in_lcms[index];
 			    } else {
 				isInWhileLoop = false;
 			    }
@@ -507,7 +775,7 @@ getAllDecompositions(value_type mass) {
             }
         }
 
-	return decompositions;
+	return false;
 }
 
 
@@ -572,8 +840,6 @@ collectDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
 
 /**
  * Gets number of all possible decompositions for a given @c mass.
- * Since using getAllDecomposition() the usage of this function could 
- * be @b consuming.
  * 
  * @param mass Mass to be decomposed
  * @return number of decompositions for given mass.
@@ -582,7 +848,9 @@ template <typename ValueType, typename DecompositionValueType>
 typename FastIntegerMassDecomposer<ValueType, DecompositionValueType>::
 decomposition_value_type FastIntegerMassDecomposer<ValueType, 
 DecompositionValueType>::getNumberOfDecompositions(value_type mass) {
-	return getAllDecompositions(mass).size();
+	DecompositionsCounter counter;
+	visitAllDecompositions(mass, counter);
+	return counter.number_of_decompositions;
 }
 
 
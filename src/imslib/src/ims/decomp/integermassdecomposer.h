@@ -3,9 +3,18 @@
 
 #include <vector>
 #include <utility>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <ostream>
 #include <ims/weights.h>
 #include <ims/utils/gcd.h>
+#include <ims/utils/mappedfile.h>
+#include <ims/decomp/residuetableformat.h>
 #include <ims/decomp/massdecomposer.h>
+#include <ims/decomp/compactresiduetable.h>
+#include <ims/decomp/residuetable.h>
+#include <ims/decomp/linearconstraint.h>
 
 namespace ims {
 
@@ -70,6 +79,27 @@ class IntegerMassDecomposer :
 		 */
 		IntegerMassDecomposer(const Weights& alphabet);
 
+		/**
+		 * Constructor with weights, reading the residue table and the 
+		 * other data structures from @c file, as written by save() for the 
+		 * same weights, instead of building them. The residue table is used
+		 * in place, so decomposers constructed from one memory-mapped file 
+		 * (in one or many processes) share a single copy.
+		 *
+		 * @param alphabet Weights over which masses to be decomposed.
+		 * @param file Contents of a file written by save().
+		 * @throw IOException if @c file wasn't written for @c alphabet.
+		 */
+		IntegerMassDecomposer(const Weights& alphabet, const MappedFile& file);
+
+		/**
+		 * Writes the residue table and the other data structures built by
+		 * the constructor to @c os in ResidueTableFormat.
+		 *
+		 * @throw IOException if writing fails.
+		 */
+		void save(std::ostream& os) const;
+
 		/**
 		 * Returns true if decomposition over the @c mass exists, otherwise - false.
 		 *
@@ -96,14 +126,116 @@ class IntegerMassDecomposer :
 
 		/**
 		 * Gets number of all possible decompositions for a given @c mass.
-		 * Since using getAllDecomposition() the usage of this function could 
-		 * be @b consuming.
+		 * Counts the series of visitDecompositionSeries(), so decompositions
+		 * are neither stored nor visited one by one.
 		 * 
 		 * @param mass Mass to be decomposed
 		 * @return number of decompositions for a given mass.
 		 */
 		virtual decomposition_value_type getNumberOfDecompositions(value_type mass);
-		
+
+		/**
+		 * Calls @c visitor(decomposition) for every possible decomposition 
+		 * of @c mass, without storing them. The decomposition passed is 
+		 * reused between calls and must be copied if it's to be kept.
+		 *
+		 * Uses the iterative engine of @c DecompositionCursor, which works
+		 * on a fixed buffer allocated once per call.
+		 *
+		 * @param mass Mass to be decomposed.
+		 * @param visitor Functor taking a <tt>const decomposition_type&</tt>.
+		 */
+		template <typename DecompositionVisitor>
+		void visitAllDecompositions(value_type mass, DecompositionVisitor& visitor) const;
+
+		/**
+		 * Same as visitAllDecompositions(value_type, DecompositionVisitor&), 
+		 * but visits only decompositions whose amounts lie within 
+		 * [@c lower_bounds[i], @c upper_bounds[i]] for every alphabet mass i. 
+		 * Bounds are pushed into the enumeration, see 
+		 * DecompositionCursor::setBounds().
+		 *
+		 * @param mass Mass to be decomposed.
+		 * @param lower_bounds Minimal amounts of alphabet masses.
+		 * @param upper_bounds Maximal amounts of alphabet masses, 
+		 * @c getUnboundedAmount() for no limit.
+		 * @param visitor Functor taking a <tt>const decomposition_type&</tt>.
+		 */
+		template <typename DecompositionVisitor>
+		void visitAllDecompositions(value_type mass, const decomposition_type& lower_bounds,
+									const decomposition_type& upper_bounds,
+									DecompositionVisitor& visitor) const;
+
+		/**
+		 * Calls @c visitor(decomposition) for every decomposition of every 
+		 * mass in [@c low, @c high]. All masses are decomposed in one 
+		 * traversal, which shares the amounts of the larger alphabet masses
+		 * between them instead of enumerating them again for every mass,
+		 * see DecompositionCursor::reset(value_type, value_type). 
+		 * Decompositions are not ordered by mass.
+		 *
+		 * @param low Smallest mass to be decomposed.
+		 * @param high Largest mass to be decomposed.
+		 * @param visitor Functor taking a <tt>const decomposition_type&</tt>.
+		 */
+		template <typename DecompositionVisitor>
+		void visitDecompositionsInRange(value_type low, value_type high,
+										DecompositionVisitor& visitor) const;
+
+		/**
+		 * Gets the upper bound meaning "no limit" on the amount of an alphabet mass.
+		 */
+		static decomposition_value_type getUnboundedAmount() {
+			return std::numeric_limits<decomposition_value_type>::max();
+		}
+
+		/**
+		 * Gets the number of bytes allocated for the residue table and 
+		 * the other data structures built by the constructor.
+		 */
+		std::size_t getMemoryUsage() const {
+			return sizeof(*this) + ertable.getMemoryUsage() +
+				(lcms.capacity() + mass_in_lcms.capacity()) * sizeof(value_type) +
+				witness_vector.capacity() * sizeof(typename witness_vector_type::value_type);
+		}
+
+		/**
+		 * Same as visitAllDecompositions(), but enumerates by recursion 
+		 * as in the paper. Visits decompositions in the same order, 
+		 * kept for comparison.
+		 *
+		 * @param mass Mass to be decomposed.
+		 * @param visitor Functor taking a <tt>const decomposition_type&</tt>.
+		 */
+		template <typename DecompositionVisitor>
+		void visitAllDecompositionsRecursively(value_type mass, 
+											   DecompositionVisitor& visitor) const;
+
+		/**
+		 * Visits all decompositions of @c mass in series, which differ only in 
+		 * the amounts of the two smallest alphabet masses. Calls 
+		 * @c visitor(decomposition, step1, step0, number) for every series: 
+		 * @c decomposition is its first member, the next members follow by 
+		 * adding @c step1 to the amount of alphabet mass 1 and taking 
+		 * @c step0 off the amount of alphabet mass 0, @c number members in 
+		 * total.
+		 *
+		 * The series are found in closed form from the mass left for the two 
+		 * smallest alphabet masses, so only the amounts of the larger alphabet 
+		 * masses are enumerated. This allows to count decompositions, or 
+		 * those fulfilling a condition that is linear in the amounts, without 
+		 * visiting them one by one.
+		 *
+		 * @param mass Mass to be decomposed.
+		 * @param visitor Functor taking <tt>(const decomposition_type&, 
+		 * decomposition_value_type, decomposition_value_type, value_type)</tt>.
+		 */
+		template <typename SeriesVisitor>
+		void visitDecompositionSeries(value_type mass, SeriesVisitor& visitor) const;
+
+		class DecompositionCursor;
+		friend class DecompositionCursor;
+
 	private:
 	
 		/**
@@ -119,7 +251,12 @@ class IntegerMassDecomposer :
 		/**
 		 * Type of the residues table.
 		 */
-		typedef std::vector<residues_table_row_type> residues_table_type;
+		typedef CompactResidueTable<value_type> residues_table_type;
+
+		/**
+		 * Type of entries of the residues table.
+		 */
+		typedef typename residues_table_type::entry_type residues_table_entry_type;
 
 		/**
 		 * Weights over which the mass is to be decomposed.
@@ -158,22 +295,329 @@ class IntegerMassDecomposer :
 		witness_vector_type witness_vector;
 
 		/**
-		 * Fills the extended residues table.
+		 * Inverse of the second alphabet mass divided by gcd with the 
+		 * smallest alphabet mass, modulo mass_in_lcms[1]. Gives the first 
+		 * amount of the second alphabet mass in every series.
+		 */
+		value_type second_mass_inverse;
+
+		/**
+		 * Computes second_mass_inverse from lcms and mass_in_lcms.
+		 */
+		void initializeSecondMassInverse();
+
+		/**
+		 * Returns true if some mass in [@c low, @c high] is decomposable
+		 * over the alphabet masses 0 to @c index. Uses range minimum 
+		 * queries on the residue table, see CompactResidueTable::getMinimum().
 		 */
-		void fillExtendedResidueTable(const Weights& _alphabet, residues_table_row_type& _lcms,
-									  residues_table_row_type& _mass_in_lcms, const value_type _infty,
-									  witness_vector_type& _witness_vector, residues_table_type& _ertable);
+		bool isDecomposable(size_type index, value_type low, value_type high) const;
 
 		/**
-		 * Collects decompositions for @c mass by recursion. 
+		 * Visits decompositions for @c mass by recursion. 
 		 *
 		 * @param mass Mass to be decomposed.
 		 * @param alphabetMassIndex An index of the mass in alphabet that is used on this step of recursion.
-		 * @param decomposition Decomposition which is calculated on this step of recursion.
-		 * @param decompositionStore Container where decompositions are collected.
+		 * @param decomposition Decomposition which is calculated on this step of recursion, 
+		 * shared by all steps.
+		 * @param visitor Functor that is called for every decomposition found.
 		 */
-		 void collectDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
-				decomposition_type decomposition, decompositions_type& decompositionsStore);
+		template <typename DecompositionVisitor>
+		void visitDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
+				decomposition_type& decomposition, DecompositionVisitor& visitor) const;
+
+		/**
+		 * Visits series of decompositions for @c mass by recursion down to 
+		 * the second alphabet mass, see visitDecompositionSeries().
+		 */
+		template <typename SeriesVisitor>
+		void visitSeriesRecursively(value_type mass, size_type alphabetMassIndex,
+				decomposition_type& decomposition, SeriesVisitor& visitor) const;
+
+		/**
+		 * Visitor that copies every decomposition into a container.
+		 */
+		class DecompositionsCollector {
+			public:
+				DecompositionsCollector(decompositions_type& decompositions) :
+					decompositions(decompositions) {}
+				void operator()(const decomposition_type& decomposition) {
+					decompositions.push_back(decomposition);
+				}
+			private:
+				decompositions_type& decompositions;
+		};
+
+		/**
+		 * Series visitor that sums up the numbers of decompositions.
+		 */
+		class SeriesCounter {
+			public:
+				SeriesCounter() : number_of_decompositions(0) {}
+				void operator()(const decomposition_type&, decomposition_value_type,
+								decomposition_value_type, value_type number) {
+					number_of_decompositions += number;
+				}
+				value_type number_of_decompositions;
+		};
+};
+
+
+/**
+ * @brief Iterates over all decompositions of a mass one at a time.
+ *
+ * Runs the enumeration of the paper with an explicit stack instead of 
+ * recursion, so that the caller can pull decompositions one by one:
+ *
+ * @code
+ * IntegerMassDecomposer<>::DecompositionCursor cursor(decomposer);
+ * for (cursor.reset(mass); cursor.next(); ) {
+ *     use(cursor.current());
+ * }
+ * @endcode
+ *
+ * All buffers are allocated once by the constructor and reused by reset(), 
+ * so one cursor can enumerate many masses without any allocation. The 
+ * decomposer must outlive the cursor and is only read, so several cursors 
+ * can work on one decomposer concurrently.
+ */
+template <typename ValueType, typename DecompositionValueType>
+class IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor {
+	public:
+		/**
+		 * Constructor with decomposer whose decompositions are iterated.
+		 */
+		DecompositionCursor(const IntegerMassDecomposer& decomposer);
+
+		/**
+		 * Restricts the amount of every alphabet mass i to 
+		 * [@c lower_bounds[i], @c upper_bounds[i]] for all following resets.
+		 * 
+		 * Lower bounds are taken off the mass up front, upper bounds prune 
+		 * every branch whose amount exceeds the bound or whose mass rest is 
+		 * too large to be taken by the smaller alphabet masses within 
+		 * their bounds. So only decompositions within the bounds are 
+		 * enumerated, rather than enumerating all and dropping most of them.
+		 *
+		 * @param lower_bounds Minimal amounts, one per alphabet mass.
+		 * @param upper_bounds Maximal amounts, one per alphabet mass, 
+		 * @c getUnboundedAmount() for no limit.
+		 */
+		void setBounds(const decomposition_type& lower_bounds, 
+					   const decomposition_type& upper_bounds);
+
+		/**
+		 * Removes the bounds set by setBounds().
+		 */
+		void clearBounds();
+
+		/**
+		 * Adds @c constraint for all following resets, only decompositions
+		 * satisfying all constraints are enumerated.
+		 *
+		 * Whenever the amount of an alphabet mass is chosen, the value of
+		 * the constraint is bounded from the amounts chosen so far and the
+		 * mass rest: over the smaller alphabet masses, it lies between the
+		 * mass rest times the smallest and the largest ratio of coefficient 
+		 * to alphabet mass. If these limits miss the allowed range, the 
+		 * branch is pruned.
+		 *
+		 * @param constraint Constraint with one coefficient per alphabet mass.
+		 */
+		void addConstraint(const LinearConstraint& constraint);
+
+		/**
+		 * Removes all constraints added by addConstraint().
+		 */
+		void clearConstraints();
+
+		/**
+		 * Restricts all following resets to the decompositions whose real 
+		 * mass over the alphabet masses of the weights lies within @c error 
+		 * of @c mass.
+		 *
+		 * The real mass of the amounts chosen so far is carried along the 
+		 * enumeration, and the real mass of the rest is bounded like the
+		 * value of a constraint (see addConstraint()), pruning branches that
+		 * miss the window. With a range of masses much wider than the 
+		 * window, the range of mass rests of every level is narrowed to 
+		 * the window, too. The decompositions found are checked with 
+		 * <tt>|real mass - mass| <= error</tt> without summing up their
+		 * real mass again, see getMass().
+		 */
+		void setMassWindow(double mass, double error);
+
+		/**
+		 * Removes the mass window set by setMassWindow().
+		 */
+		void clearMassWindow() { windowed = false; }
+
+		/**
+		 * Gets the real mass of the current decomposition. Only valid after 
+		 * next() returned true with a mass window set.
+		 */
+		double getMass() const { return current_mass; }
+
+		/**
+		 * Starts iterating the decompositions of @c mass.
+		 */
+		void reset(value_type mass);
+
+		/**
+		 * Starts iterating the decompositions of all masses in 
+		 * [@c low, @c high] in a single traversal. 
+		 *
+		 * Every level keeps the range of masses left for the levels below 
+		 * instead of a single mass rest. An amount is taken if some mass 
+		 * of its range is decomposable over the smaller alphabet masses, 
+		 * which is a range minimum query on the residue table. So the 
+		 * amounts of the larger alphabet masses are enumerated once for 
+		 * the whole range, rather than once per mass as by reset(value_type).
+		 * Bounds and constraints are applied as with single masses.
+		 */
+		void reset(value_type low, value_type high);
+
+		/**
+		 * Moves to the next decomposition. 
+		 *
+		 * @return false if there are no more decompositions.
+		 */
+		bool next();
+
+		/**
+		 * Gets the current decomposition. Only valid after next() returned true.
+		 */
+		const decomposition_type& current() const { return decomposition; }
+
+		/**
+		 * Type of the number of decompositions.
+		 */
+		typedef unsigned long long number_of_decompositions_type;
+
+		/**
+		 * Counts the decompositions that next() would still return and 
+		 * finishes the iteration.
+		 *
+		 * Right after reset(value_type, value_type) without constraints,
+		 * the traversal stops one level above the smallest alphabet mass:
+		 * its amounts within the range of mass rests and the mass window 
+		 * form an interval, which is counted from its ends. Otherwise the
+		 * decompositions are counted one by one.
+		 */
+		number_of_decompositions_type count();
+
+		/**
+		 * Gets the highest index whose amount may differ between the 
+		 * current and the previous decomposition, the amounts of all 
+		 * higher indices being the same. Gets the highest index of all for
+		 * the first decomposition after a reset. Only valid after next() 
+		 * returned true.
+		 *
+		 * Decompositions are enumerated with the amounts of the largest 
+		 * alphabet masses changing least often, so this is mostly 0 or 1. 
+		 * Anything computed from the amounts index by index, from the 
+		 * highest one down, can thus be kept for the higher indices and 
+		 * only be redone from this index on.
+		 */
+		size_type getChangedLevel() const { return changed_level; }
+
+	private:
+		/**
+		 * State of one level of the recursion in 
+		 * @c visitDecompositionsRecursively, together with the level's
+		 * constants, which are cached once by the constructor.
+		 */
+		struct Frame {
+			// mass to be decomposed over alphabet masses [0, level]
+			value_type mass;
+			// number of this level's mass modulo the lcm
+			value_type i;
+			// (mass - i * alphabet mass) modulo smallest alphabet mass
+			value_type mass_mod_alphabet0;
+			// smallest decomposable mass in the current residue class
+			value_type r;
+			// mass left for the levels below
+			value_type m;
+			// with ranges of masses: largest mass to be decomposed and 
+			// largest mass left for the levels below, mass and m being 
+			// the smallest ones
+			value_type high, m_high;
+
+			// this level's alphabet mass
+			value_type alphabet_mass;
+			// alphabet mass modulo smallest alphabet mass
+			value_type mass_mod_decrement;
+			value_type lcm;
+			value_type mass_in_lcm;
+			// column of the residue table for the levels below
+			const residues_table_entry_type* residues;
+
+			// bounds of this level's amount
+			decomposition_value_type lower, upper;
+			// largest mass rest the levels below can take within their bounds
+			value_type max_mass_below;
+		};
+
+		/**
+		 * Bounds on the value of one constraint on one level, see addConstraint().
+		 */
+		struct ConstraintBounds {
+			double coefficient;
+			// smallest and largest ratio of coefficient to alphabet mass 
+			// on the levels below
+			double min_ratio_below, max_ratio_below;
+			// value of the lower bounds on the levels below
+			double lower_bounds_value_below;
+			// value of the amounts chosen on this level and above
+			double value;
+		};
+
+		bool first(size_type level);
+		bool seek(size_type level);
+		bool advance(size_type level);
+		bool nextInRange();
+		bool firstInRange(size_type level);
+		bool seekInRange(size_type level);
+		bool advanceInRange(size_type level);
+		number_of_decompositions_type countInRange();
+		bool isWithinMassWindowAt(value_type amount);
+		bool admit(size_type level, bool found);
+		bool isAdmissible(size_type level);
+		bool isWithinLimits(ConstraintBounds* bounds, size_type level, 
+							double min, double max);
+		bool isWithinMassWindow(double mass);
+		bool fitMassWindow(size_type level);
+		void carryMass(size_type level);
+		void updateConstraintBounds();
+		void fillConstraintBounds(ConstraintBounds* bounds, 
+								  const LinearConstraint::coefficients_type& coefficients);
+
+		const IntegerMassDecomposer& decomposer;
+		std::vector<Frame> frames;
+		decomposition_type decomposition;
+		std::vector<LinearConstraint> constraints;
+		// bounds of constraint c on level l at c * frames.size() + l
+		std::vector<ConstraintBounds> constraint_bounds;
+		// bounds of the real mass on every level, the alphabet masses 
+		// being its coefficients
+		std::vector<ConstraintBounds> mass_bounds;
+		// real mass window, see setMassWindow()
+		bool windowed;
+		// lowest level whose ranges of mass rests are narrowed to the 
+		// mass window, frames.size() for none
+		size_type narrowed_level;
+		double window_mass, window_error;
+		// real mass of the current decomposition
+		double current_mass;
+		// mass of the lower bounds, taken off every mass to be decomposed
+		value_type lower_bounds_mass;
+		// false if some lower bound exceeds its upper bound
+		bool bounds_satisfiable;
+		bool started, finished;
+		// true if a range of masses is decomposed
+		bool ranged;
+		// highest level changed since the previous decomposition
+		size_type changed_level;
 };
 
 
@@ -189,178 +633,76 @@ IntegerMassDecomposer<ValueType, DecompositionValueType>::IntegerMassDecomposer(
 
 	infty = alphabet.getWeight(0) * alphabet.getWeight(alphabet.size()-1);
 
-	fillExtendedResidueTable(alphabet, lcms, mass_in_lcms, infty, witness_vector, ertable);
+	ResidueTable<value_type, decomposition_value_type>::fill(
+		alphabet, infty, lcms, mass_in_lcms, witness_vector, ertable);
 
+	initializeSecondMassInverse();
 }
 
 
 template <typename ValueType, typename DecompositionValueType>
-void IntegerMassDecomposer<ValueType, DecompositionValueType>::fillExtendedResidueTable(
-	const Weights& _alphabet, residues_table_row_type& _lcms, residues_table_row_type& _mass_in_lcms,
-	const value_type _infty, witness_vector_type& _witnessVector, residues_table_type& _ertable) {
-
-	if (_alphabet.size() < 2) {
-		return;
-	}
-	// caches the most often used mass - smallest mass
-	value_type smallestMass = _alphabet.getWeight(0), secondMass = _alphabet.getWeight(1);
-
-	// initializes table: infinity everywhere except in the first field of every column
-	_ertable.reserve(_alphabet.size());
-	_ertable.assign(_alphabet.size(), std::vector<value_type>(smallestMass, _infty));
-
-	for (size_type i = 0; i < _alphabet.size(); ++i) {
-		_ertable[i][0] = 0;
-	}
-
-	// initializes witness vector
-	_witnessVector.reserve(smallestMass);
-	_witnessVector.resize(smallestMass);
-
-	// fills second column (the first one is already correct)
-	size_type it_inc = secondMass % smallestMass, witness = 1;
-	typename residues_table_row_type::iterator it = _ertable[1].begin() + it_inc;
-	value_type mass = secondMass;
-	// initializes counter to create a witness vector
-	decomposition_value_type counter = 0;
-	while (it != _ertable[1].begin()) {
-		*it = mass;
-		mass += secondMass;
-		++counter;
-		_witnessVector[it - _ertable[1].begin()] = std::make_pair(witness, counter);
-		it += it_inc;
-		if (it >= _ertable[1].end()) {
-			it -= _ertable[1].size();
-		}
-	}
-	// fills cache variables for i==1
-	value_type d = gcd(smallestMass, secondMass);
-	_lcms[1] = secondMass*smallestMass / d;
-	_mass_in_lcms[1] = smallestMass / d;
-
-	// fills remaining table. i is the column index.
-	for (size_type i = 2; i < _alphabet.size(); ++i) {
-		// caches often used i-th alphabet mass
-		value_type currentMass = _alphabet.getWeight(i);
-
-		value_type d = gcd(smallestMass, currentMass);
-
-		// fills cache for various variables.
-		// note that values for i==0 are never assigned since they're unused anyway.
-		_lcms[i] = currentMass*smallestMass / d;
-		_mass_in_lcms[i] = smallestMass / d;
-
-		// Nijenhuis' improvement: Is currentMass composable with smaller alphabet?
-		if (currentMass >= _ertable[i-1][currentMass % smallestMass]) {
-			_ertable[i] = _ertable[i-1];
-			continue;
-		}
-
-		const residues_table_row_type& prev_column = _ertable[i-1];
-		residues_table_row_type& cur_column = _ertable[i];
-
-		if (d == 1) {
-			// This loop is for the case that the gcd is 1. The optimization used below
-			// is not applicable here.
-
-			// p_inc is used to change residue (p) efficiently
-			size_type p_inc = currentMass % smallestMass;
-
-			// n is the value that will be written into the table
-			value_type n = 0;
-			// current residue (in paper variable 'r' is used)
-			size_type p = 0;
-			// counter for creation of witness vector
-			decomposition_value_type counter = 0;
-
-			for (size_type m = smallestMass; m > 0; --m) {
-				n += currentMass;
-				p += p_inc;
-				++counter;
-				if (p >= smallestMass) {
-					p -= smallestMass;
-				}
-				if (n > prev_column[p]) {
-					n = prev_column[p];
-					counter = 0;
-				} else {
-					_witnessVector[p] = std::make_pair(i, counter);
-				}
-				cur_column[p] = n;
-			}
-		}
-		else {
-			// If we're here, the gcd is not 1. We can use the following cache-optimized
-			// version of the algorithm. The trick is to put the iteration over all
-			// residue classes into the _inner_ loop.
-			//
-			// One could see it as going through one column in blocks which are gcd entries long.
-			size_type cur = currentMass % smallestMass;
-			size_type prev = 0;
-			size_type p_inc = cur-d;
-			// counters for creation of one witness vector
-			std::vector<decomposition_value_type> counters(smallestMass);
-
-			// copies first block from prev_column to cur_column
-			for (size_type j = 1; j < d; ++j) {
-				cur_column[j] = prev_column[j];
-			}
+IntegerMassDecomposer<ValueType, DecompositionValueType>::IntegerMassDecomposer(
+			const Weights& alphabet, const MappedFile& file) : alphabet(alphabet) {
 
-			// first loop: goes through all blocks, updating cur_column for the first time.
-			for (size_type m = smallestMass / d; m > 1; m--) {
-				// r: current residue class
-				for (size_type r = 0; r < d; r++) {
-
-					++counters[cur];
-					if (cur_column[prev] + currentMass > prev_column[cur]) {
-						cur_column[cur] = prev_column[cur];
-						counters[cur] = 0;
-					} else {
-						cur_column[cur] = cur_column[prev] + currentMass;
-						_witnessVector[cur] = std::make_pair(i, counters[cur]);
-					}
-
-					prev++;
-					cur++;
-				}
+	typedef ResidueTableFormat::integer_type integer_type;
+	ResidueTableFormat::Reader reader(file);
+	ResidueTableFormat::readHeader(reader, alphabet);
 
-				prev = cur - d;
+	infty = static_cast<value_type>(reader.readInteger());
+	lcms.resize(alphabet.size());
+	mass_in_lcms.resize(alphabet.size());
+	for (size_type i = 0; i < alphabet.size(); ++i) {
+		lcms[i] = static_cast<value_type>(reader.readInteger());
+		mass_in_lcms[i] = static_cast<value_type>(reader.readInteger());
+	}
+	integer_type witnesses = reader.readInteger();
+	if (witnesses > file.size()) {
+		throw IOException("residue table file is corrupt");
+	}
+	witness_vector.resize(static_cast<size_type>(witnesses));
+	for (size_type i = 0; i < witness_vector.size(); ++i) {
+		witness_vector[i].first = static_cast<size_type>(reader.readInteger());
+		witness_vector[i].second = static_cast<decomposition_value_type>(reader.readInteger());
+	}
+	ertable.read(reader);
+	if (ertable.getNumberOfColumns() != alphabet.size() || 
+			ertable.infinity() != infty) {
+		throw IOException("residue table file is corrupt");
+	}
 
-				// this does: cur = (cur + currentMass) % smallestMass - d;
-				cur += p_inc;
-				if (cur >= smallestMass) {
-					cur -= smallestMass;
-				}
-			}
+	initializeSecondMassInverse();
+}
 
-			// second loop:
-			bool cont = true;
-			while (cont) {
-				cont = false;
-				prev++;
-				cur++;
-				++counters[cur];
-				for (size_type r = 1; r < d; ++r) {
-					if (cur_column[prev] + currentMass < cur_column[cur]) {
-						cur_column[cur] = cur_column[prev] + currentMass;
-						cont = true;
-						_witnessVector[cur] = std::make_pair(i, counters[cur]);
-					} else {
-						counters[cur] = 0;
-					}
-					prev++;
-					cur++;
-				}
 
-				prev = cur - d;
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::save(std::ostream& os) const {
+	ResidueTableFormat::Writer writer(os);
+	ResidueTableFormat::writeHeader(writer, alphabet);
+
+	writer.writeInteger(infty);
+	for (size_type i = 0; i < alphabet.size(); ++i) {
+		writer.writeInteger(lcms[i]);
+		writer.writeInteger(mass_in_lcms[i]);
+	}
+	writer.writeInteger(witness_vector.size());
+	for (size_type i = 0; i < witness_vector.size(); ++i) {
+		writer.writeInteger(witness_vector[i].first);
+		writer.writeInteger(witness_vector[i].second);
+	}
+	ertable.write(writer);
+}
 
-				cur += p_inc;
-				if (cur >= smallestMass) {
-					cur -= smallestMass;
-				}
-			}
-		}
 
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::initializeSecondMassInverse() {
+	second_mass_inverse = 0;
+	if (alphabet.size() > 1 && mass_in_lcms[1] > 1) {
+		// (second mass / gcd) * u1 + mass_in_lcm * u2 = 1
+		long long u1, u2;
+		long long mass_in_lcm = static_cast<long long>(mass_in_lcms[1]);
+		gcd(static_cast<long long>(lcms[1] / alphabet.getWeight(0)), mass_in_lcm, u1, u2);
+		second_mass_inverse = static_cast<value_type>(
+			(u1 % mass_in_lcm + mass_in_lcm) % mass_in_lcm);
 	}
 }
 
@@ -369,7 +711,7 @@ template <typename ValueType, typename DecompositionValueType>
 bool IntegerMassDecomposer<ValueType, DecompositionValueType>::
 exist(value_type mass) {
 
-	value_type residue = ertable.back().at(mass % alphabet.getWeight(0));
+	value_type residue = ertable.get(ertable.getNumberOfColumns() - 1, mass % alphabet.getWeight(0));
 	return (residue != infty && mass >= residue);
 }
 
@@ -389,7 +731,7 @@ getDecomposition(value_type mass) {
 
 	// initial mass residue: in FIND-ONE algorithm in paper corresponds variable "r"
 	value_type r = mass % alphabet.getWeight(0);
-	value_type m = ertable.back().at(r);
+	value_type m = ertable.get(ertable.getNumberOfColumns() - 1, r);
 
 	decomposition.at(0) = static_cast<decomposition_value_type>
 		((mass - m) / alphabet.getWeight(0));
@@ -413,22 +755,105 @@ typename IntegerMassDecomposer<ValueType, DecompositionValueType>::decomposition
 IntegerMassDecomposer<ValueType, DecompositionValueType>::
 getAllDecompositions(value_type mass) {
 	decompositions_type decompositionsStore;
-	decomposition_type decomposition(alphabet.size());
-	collectDecompositionsRecursively(mass, alphabet.size()-1, decomposition, decompositionsStore);
+	DecompositionsCollector collector(decompositionsStore);
+	visitAllDecompositions(mass, collector);
 	return decompositionsStore;
 }
 
 
 template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitAllDecompositions(value_type mass, DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	for (cursor.reset(mass); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitAllDecompositions(value_type mass, const decomposition_type& lower_bounds,
+					   const decomposition_type& upper_bounds,
+					   DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	cursor.setBounds(lower_bounds, upper_bounds);
+	for (cursor.reset(mass); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitDecompositionsInRange(value_type low, value_type high,
+						   DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	for (cursor.reset(low, high); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+bool IntegerMassDecomposer<ValueType, DecompositionValueType>::
+isDecomposable(size_type index, value_type low, value_type high) const {
+	const value_type smallestMass = alphabet.getWeight(0);
+	if (index == 0) {
+		return (low + smallestMass - 1) / smallestMass * smallestMass <= high;
+	}
+
+	// the entry of residue r is the smallest k for which k * smallestMass + r
+	// is decomposable, so a mass q * smallestMass + r is decomposable iff 
+	// the entry is at most q. The range covers at most three runs of 
+	// residues with one quotient each: the first and the last one, and all 
+	// residues with the quotients in between, of which the largest counts.
+	const residues_table_entry_type empty = residues_table_type::getEmptyEntry();
+	const value_type low_quotient = low / smallestMass, high_quotient = high / smallestMass;
+	const value_type low_residue = low % smallestMass, high_residue = high % smallestMass;
+	residues_table_entry_type entry;
+	if (low_quotient == high_quotient) {
+		entry = ertable.getMinimum(index, low_residue, high_residue);
+		return entry != empty && entry <= low_quotient;
+	}
+	entry = ertable.getMinimum(index, low_residue, smallestMass - 1);
+	if (entry != empty && entry <= low_quotient) {
+		return true;
+	}
+	if (high_quotient > low_quotient + 1) {
+		entry = ertable.getMinimum(index, 0, smallestMass - 1);
+		if (entry != empty && entry <= high_quotient - 1) {
+			return true;
+		}
+	}
+	entry = ertable.getMinimum(index, 0, high_residue);
+	return entry != empty && entry <= high_quotient;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
 void IntegerMassDecomposer<ValueType, DecompositionValueType>::
-collectDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
- decomposition_type decomposition, decompositions_type& decompositionsStore) {
+visitAllDecompositionsRecursively(value_type mass, DecompositionVisitor& visitor) const {
+	decomposition_type decomposition(alphabet.size());
+	visitDecompositionsRecursively(mass, alphabet.size()-1, decomposition, visitor);
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename DecompositionVisitor>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
+ decomposition_type& decomposition, DecompositionVisitor& visitor) const {
 	if (alphabetMassIndex == 0) {
 		value_type numberOfMasses0 = mass / alphabet.getWeight(0);
 		if (numberOfMasses0 * alphabet.getWeight(0) == mass) {
 			decomposition[0] = static_cast<decomposition_value_type>(
 															numberOfMasses0);
-			decompositionsStore.push_back(decomposition);
+			visitor(decomposition);
 		}
 		return;
 	}
@@ -452,7 +877,7 @@ collectDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
 		}
 
 		/* r: current residue class. will stay the same in the following loop */
-		value_type r = ertable[alphabetMassIndex-1][mass_mod_alphabet0];
+		value_type r = ertable.get(alphabetMassIndex-1, mass_mod_alphabet0);
 
 		// TODO: if infty was std::numeric_limits<...>... the following 'if' would not be necessary
 		if (r != infty) {
@@ -460,7 +885,7 @@ collectDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
 				/* the condition of the 'for' loop (m >= r) and decrementing the mass
 				 * in steps of the lcm ensures that m is decomposable. Therefore
 				 * the recursion will result in at least one witness. */
-				collectDecompositionsRecursively(m, alphabetMassIndex-1, decomposition, decompositionsStore);
+				visitDecompositionsRecursively(m, alphabetMassIndex-1, decomposition, visitor);
 				decomposition[alphabetMassIndex] += mass_in_lcm;
 				// this check is needed because mass could have unsigned type and after reduction on i*alphabetMass will be still be positive but huge
 				// and that will end up in unfinite loop
@@ -479,10 +904,807 @@ collectDecompositionsRecursively(value_type mass, size_type alphabetMassIndex,
 
 }
 
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename SeriesVisitor>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitDecompositionSeries(value_type mass, SeriesVisitor& visitor) const {
+	decomposition_type decomposition(alphabet.size());
+	if (alphabet.size() == 1) {
+		value_type numberOfMasses0 = mass / alphabet.getWeight(0);
+		if (numberOfMasses0 * alphabet.getWeight(0) == mass) {
+			decomposition[0] = static_cast<decomposition_value_type>(numberOfMasses0);
+			visitor(decomposition, 0, 0, 1);
+		}
+		return;
+	}
+	visitSeriesRecursively(mass, alphabet.size()-1, decomposition, visitor);
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+template <typename SeriesVisitor>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::
+visitSeriesRecursively(value_type mass, size_type alphabetMassIndex,
+ decomposition_type& decomposition, SeriesVisitor& visitor) const {
+	if (alphabetMassIndex == 1) {
+		// mass = amount1 * alphabet mass 1 + amount0 * alphabet mass 0 is solvable
+		// iff gcd divides mass. Then amount1 is fixed modulo mass_in_lcm, 
+		// each further solution takes one lcm more from alphabet mass 1.
+		const value_type smallestMass = alphabet.getWeight(0);
+		const value_type mass_in_lcm = mass_in_lcms[1];
+		const value_type d = smallestMass / mass_in_lcm;
+		if (mass % d != 0) {
+			return;
+		}
+		value_type i = (mass / d) % mass_in_lcm * second_mass_inverse % mass_in_lcm;
+		if (mass < i * alphabet.getWeight(1)) {
+			return;
+		}
+		value_type m = mass - i * alphabet.getWeight(1);
+		decomposition[1] = static_cast<decomposition_value_type>(i);
+		decomposition[0] = static_cast<decomposition_value_type>(m / smallestMass);
+		visitor(decomposition, static_cast<decomposition_value_type>(mass_in_lcm),
+				static_cast<decomposition_value_type>(lcms[1] / smallestMass),
+				m / lcms[1] + 1);
+		return;
+	}
+
+	// same as visitDecompositionsRecursively, see there
+	const value_type lcm = lcms[alphabetMassIndex];
+	const value_type mass_in_lcm = mass_in_lcms[alphabetMassIndex];
+
+	value_type mass_mod_alphabet0 = mass % alphabet.getWeight(0);
+	const value_type mass_mod_decrement = alphabet.getWeight(alphabetMassIndex) % alphabet.getWeight(0);
+
+	for (value_type i = 0; i < mass_in_lcm; ++i) {
+		decomposition[alphabetMassIndex] = static_cast<decomposition_value_type>(i);
+		if (mass < i*alphabet.getWeight(alphabetMassIndex)) {
+			break;
+		}
+		value_type r = ertable.get(alphabetMassIndex-1, mass_mod_alphabet0);
+		if (r != infty) {
+			for (value_type m = mass - i * alphabet.getWeight(alphabetMassIndex); m >= r; m -= lcm) {
+				visitSeriesRecursively(m, alphabetMassIndex-1, decomposition, visitor);
+				decomposition[alphabetMassIndex] += mass_in_lcm;
+				if (m < lcm) {
+					break;
+				}
+			}
+		}
+		if (mass_mod_alphabet0 < mass_mod_decrement) {
+			mass_mod_alphabet0 += alphabet.getWeight(0) - mass_mod_decrement;
+		} else {
+			mass_mod_alphabet0 -= mass_mod_decrement;
+		}
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+DecompositionCursor(const IntegerMassDecomposer& decomposer) :
+	decomposer(decomposer), frames(decomposer.alphabet.size()),
+	decomposition(decomposer.alphabet.size()), 
+	mass_bounds(decomposer.alphabet.size()), windowed(false), 
+	narrowed_level(decomposer.alphabet.size()), window_mass(0.0),
+	window_error(0.0), current_mass(0.0), started(true), finished(true), 
+	ranged(false), changed_level(0) {
+
+	const Weights& alphabet = decomposer.alphabet;
+	frames[0].alphabet_mass = alphabet.getWeight(0);
+	for (size_type level = 1; level < frames.size(); ++level) {
+		Frame& frame = frames[level];
+		frame.alphabet_mass = alphabet.getWeight(level);
+		frame.mass_mod_decrement = frame.alphabet_mass % alphabet.getWeight(0);
+		frame.lcm = decomposer.lcms[level];
+		frame.mass_in_lcm = decomposer.mass_in_lcms[level];
+		frame.residues = decomposer.ertable.getColumn(level-1);
+	}
+	clearBounds();
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+setBounds(const decomposition_type& lower_bounds, const decomposition_type& upper_bounds) {
+	const Weights& alphabet = decomposer.alphabet;
+	const value_type unbounded_mass = std::numeric_limits<value_type>::max();
+
+	lower_bounds_mass = 0;
+	bounds_satisfiable = true;
+	value_type mass_below = 0;
+	for (size_type level = 0; level < frames.size(); ++level) {
+		Frame& frame = frames[level];
+		frame.lower = lower_bounds.at(level);
+		frame.upper = upper_bounds.at(level);
+		frame.max_mass_below = mass_below;
+		if (frame.lower > frame.upper) {
+			bounds_satisfiable = false;
+			continue;
+		}
+		lower_bounds_mass += frame.lower * alphabet.getWeight(level);
+
+		// adds the largest mass this level can take, saturating on overflow
+		value_type span = frame.upper - frame.lower;
+		if (mass_below != unbounded_mass) {
+			if (span > (unbounded_mass - mass_below) / alphabet.getWeight(level)) {
+				mass_below = unbounded_mass;
+			} else {
+				mass_below += span * alphabet.getWeight(level);
+			}
+		}
+	}
+	updateConstraintBounds();
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+clearBounds() {
+	for (size_type level = 0; level < frames.size(); ++level) {
+		frames[level].lower = 0;
+		frames[level].upper = getUnboundedAmount();
+		frames[level].max_mass_below = std::numeric_limits<value_type>::max();
+	}
+	lower_bounds_mass = 0;
+	bounds_satisfiable = true;
+	updateConstraintBounds();
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+addConstraint(const LinearConstraint& constraint) {
+	constraints.push_back(constraint);
+	updateConstraintBounds();
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+clearConstraints() {
+	constraints.clear();
+	constraint_bounds.clear();
+}
+
+
+/**
+ * Caches the bounds of all constraints on every level, which depend 
+ * on the constraints and on the bounds of the amounts.
+ */
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+updateConstraintBounds() {
+	const Weights& alphabet = decomposer.alphabet;
+	const size_type levels = frames.size();
+	constraint_bounds.resize(constraints.size() * levels);
+
+	for (size_type c = 0; c < constraints.size(); ++c) {
+		fillConstraintBounds(&constraint_bounds[c * levels], constraints[c].getCoefficients());
+	}
+
+	LinearConstraint::coefficients_type masses(levels);
+	for (size_type level = 0; level < levels; ++level) {
+		masses[level] = alphabet.getAlphabetMass(level);
+	}
+	fillConstraintBounds(&mass_bounds[0], masses);
+}
+
+
+/**
+ * Fills the bounds of a linear function with @c coefficients on every level.
+ */
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+fillConstraintBounds(ConstraintBounds* bounds, 
+					 const LinearConstraint::coefficients_type& coefficients) {
+	const Weights& alphabet = decomposer.alphabet;
+	// levels below the first one: no mass can be taken
+	bool any_below = false;
+	double min_ratio = 0.0, max_ratio = 0.0, lower_bounds_value = 0.0;
+	for (size_type level = 0; level < frames.size(); ++level) {
+		bounds[level].coefficient = coefficients.at(level);
+		bounds[level].min_ratio_below = min_ratio;
+		bounds[level].max_ratio_below = max_ratio;
+		bounds[level].lower_bounds_value_below = lower_bounds_value;
+		bounds[level].value = 0.0;
+
+		lower_bounds_value += bounds[level].coefficient * frames[level].lower;
+		// alphabet masses whose amount is fixed by the bounds take no mass rest
+		if (frames[level].upper > frames[level].lower) {
+			double ratio = bounds[level].coefficient / alphabet.getWeight(level);
+			if (!any_below || ratio < min_ratio) {
+				min_ratio = ratio;
+			}
+			if (!any_below || ratio > max_ratio) {
+				max_ratio = ratio;
+			}
+			any_below = true;
+		}
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+setMassWindow(double mass, double error) {
+	windowed = true;
+	window_mass = mass;
+	window_error = error;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+reset(value_type mass) {
+	started = false;
+	ranged = false;
+	finished = !bounds_satisfiable || mass < lower_bounds_mass;
+	if (!finished) {
+		frames.back().mass = mass - lower_bounds_mass;
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+reset(value_type low, value_type high) {
+	started = false;
+	ranged = true;
+	finished = !bounds_satisfiable || low > high || high < lower_bounds_mass;
+	// narrowing only pays off if the masses of the range spread much 
+	// wider than the mass window, as with coarse precisions. Level 1 
+	// leaves at most one amount to level 0 unless the range is wider 
+	// than the smallest alphabet mass.
+	narrowed_level = frames.size();
+	if (windowed && 
+		static_cast<double>(high - low) * window_mass > 16.0 * window_error * high) {
+		narrowed_level = high - low >= frames[0].alphabet_mass ? 1 : 2;
+	}
+	if (!finished) {
+		frames.back().mass = low > lower_bounds_mass ? low - lower_bounds_mass : 0;
+		frames.back().high = high - lower_bounds_mass;
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+next() {
+	if (finished) {
+		return false;
+	}
+	if (ranged) {
+		return nextInRange();
+	}
+	const size_type top = frames.size() - 1;
+	const value_type smallestMass = decomposer.alphabet.getWeight(0);
+
+	// a single alphabet mass has at most one decomposition
+	if (top == 0) {
+		finished = true;
+		changed_level = 0;
+		value_type numberOfMasses0 = frames[0].mass / smallestMass;
+		if (numberOfMasses0 * smallestMass != frames[0].mass ||
+			numberOfMasses0 > static_cast<value_type>(frames[0].upper - frames[0].lower)) {
+			return false;
+		}
+		decomposition[0] = static_cast<decomposition_value_type>(
+			numberOfMasses0 + frames[0].lower);
+		for (size_type c = 0; c < constraints.size(); ++c) {
+			if (!constraints[c].isSatisfied(decomposition)) {
+				return false;
+			}
+		}
+		return !windowed || isWithinMassWindow(mass_bounds[0].coefficient * decomposition[0]);
+	}
+
+	// level on which the enumeration continues: either the topmost one
+	// when starting, or the lowest one, where the last decomposition was found
+	size_type level = 1;
+	bool found;
+	if (!started) {
+		started = true;
+		level = top;
+		found = admit(level, first(level));
+	} else {
+		found = admit(level, advance(level));
+	}
+	// level 0 changes with level 1
+	changed_level = level;
+
+	for (;;) {
+		if (!found) {
+			// this level is exhausted, continues on the level above
+			if (level == top) {
+				finished = true;
+				return false;
+			}
+			++level;
+			if (level > changed_level) {
+				changed_level = level;
+			}
+			found = admit(level, advance(level));
+		} else if (level == 1) {
+			// what's left is decomposed over the smallest mass only, 
+			// its upper bound is ensured by max_mass_below of level 1
+			value_type m = frames[1].m;
+			value_type numberOfMasses0 = m / smallestMass;
+			if (numberOfMasses0 * smallestMass == m) {
+				decomposition[0] = static_cast<decomposition_value_type>(
+					numberOfMasses0 + frames[0].lower);
+				if (!windowed || isWithinMassWindow(mass_bounds[1].value + 
+						mass_bounds[0].coefficient * decomposition[0])) {
+					return true;
+				}
+			}
+			found = admit(level, advance(level));
+		} else {
+			// descends with the mass left
+			frames[level-1].mass = frames[level].m;
+			--level;
+			found = admit(level, first(level));
+		}
+	}
+}
+
+
+/**
+ * Positions @c level on its first sub-mass, returns false if there is none.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+first(size_type level) {
+	Frame& frame = frames[level];
+	frame.i = 0;
+	frame.mass_mod_alphabet0 = frame.mass % decomposer.alphabet.getWeight(0);
+	return seek(level);
+}
+
+
+/**
+ * Starting with the current i of @c level, finds the first i for which
+ * a decomposable sub-mass exists.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+seek(size_type level) {
+	Frame& frame = frames[level];
+	const value_type smallestMass = decomposer.alphabet.getWeight(0);
+
+	const value_type span = frame.upper - frame.lower;
+
+	for (; frame.i < frame.mass_in_lcm; ++frame.i) {
+		// amounts only grow from here on
+		if (frame.mass < frame.i * frame.alphabet_mass || frame.i > span) {
+			return false;
+		}
+		frame.r = decomposer.ertable.decode(frame.residues[frame.mass_mod_alphabet0],
+				frame.mass_mod_alphabet0);
+		if (frame.r != decomposer.infty) {
+			frame.m = frame.mass - frame.i * frame.alphabet_mass;
+			value_type amount = frame.i;
+			bool reachable = true;
+			if (frame.m > frame.max_mass_below) {
+				// skips the lcm steps whose mass rest is too large for the 
+				// levels below, unless this takes the amount out of bounds
+				value_type steps = (frame.m - frame.max_mass_below + frame.lcm - 1) / frame.lcm;
+				reachable = steps <= frame.m / frame.lcm && 
+							steps <= (span - frame.i) / frame.mass_in_lcm;
+				if (reachable) {
+					frame.m -= steps * frame.lcm;
+					amount += steps * frame.mass_in_lcm;
+				}
+			}
+			if (reachable && frame.m >= frame.r) {
+				decomposition[level] = static_cast<decomposition_value_type>(
+					amount + frame.lower);
+				return true;
+			}
+		}
+		// subtle way of changing the modulo, see visitDecompositionsRecursively
+		if (frame.mass_mod_alphabet0 < frame.mass_mod_decrement) {
+			frame.mass_mod_alphabet0 += smallestMass - frame.mass_mod_decrement;
+		} else {
+			frame.mass_mod_alphabet0 -= frame.mass_mod_decrement;
+		}
+	}
+	return false;
+}
+
+
+/**
+ * Moves @c level to its next sub-mass: first by lcm steps within the current
+ * residue class, then on to the next i.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+advance(size_type level) {
+	Frame& frame = frames[level];
+	if (frame.m >= frame.lcm && 
+		decomposition[level] + frame.mass_in_lcm <= frame.upper) {
+		frame.m -= frame.lcm;
+		if (frame.m >= frame.r) {
+			decomposition[level] += static_cast<decomposition_value_type>(frame.mass_in_lcm);
+			return true;
+		}
+	}
+	if (frame.mass_mod_alphabet0 < frame.mass_mod_decrement) {
+		frame.mass_mod_alphabet0 += decomposer.alphabet.getWeight(0) - frame.mass_mod_decrement;
+	} else {
+		frame.mass_mod_alphabet0 -= frame.mass_mod_decrement;
+	}
+	++frame.i;
+	return seek(level);
+}
+
+
+/**
+ * Same as next(), but for a range of masses. Unlike with single masses, the
+ * amount of the smallest alphabet mass is a level of its own, since the
+ * mass range left for it may hold several multiples of it.
+ */
+template <typename ValueType, typename DecompositionValueType>
+bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+nextInRange() {
+	const size_type top = frames.size() - 1;
+
+	size_type level = 0;
+	bool found;
+	if (!started) {
+		started = true;
+		level = top;
+		found = admit(level, firstInRange(level));
+	} else {
+		found = admit(level, advanceInRange(level));
+	}
+	changed_level = level;
+
+	for (;;) {
+		if (!found) {
+			if (level == top) {
+				finished = true;
+				return false;
+			}
+			++level;
+			if (level > changed_level) {
+				changed_level = level;
+			}
+			found = admit(level, advanceInRange(level));
+		} else if (level == 0) {
+			// isAdmissible() summed up the real mass on level 0
+			if (!windowed || isWithinMassWindow(mass_bounds[0].value)) {
+				return true;
+			}
+			found = admit(level, advanceInRange(level));
+		} else {
+			// descends with the mass range left
+			frames[level-1].mass = frames[level].m;
+			frames[level-1].high = frames[level].m_high;
+			--level;
+			found = admit(level, firstInRange(level));
+		}
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+typename IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+number_of_decompositions_type
+IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+count() {
+	number_of_decompositions_type number = 0;
+	if (started || !ranged || !constraints.empty() || frames.size() < 2) {
+		while (next()) {
+			++number;
+		}
+		return number;
+	}
+	if (finished) {
+		return 0;
+	}
+
+	// same as nextInRange(), but level 1 counts the amounts of level 0
+	const size_type top = frames.size() - 1;
+	size_type level = top;
+	started = true;
+	bool found = admit(level, firstInRange(level));
+	for (;;) {
+		if (!found) {
+			if (level == top) {
+				finished = true;
+				return number;
+			}
+			++level;
+			found = admit(level, advanceInRange(level));
+		} else if (level == 1) {
+			number += countInRange();
+			found = admit(level, advanceInRange(level));
+		} else {
+			frames[level-1].mass = frames[level].m;
+			frames[level-1].high = frames[level].m_high;
+			--level;
+			found = admit(level, firstInRange(level));
+		}
+	}
+}
+
+
+/**
+ * Counts the amounts of level 0 for the range of mass rests of level 1,
+ * which nextInRange() would return one by one. The real mass grows with 
+ * the amount, so those within the mass window form an interval. Its ends
+ * are estimated and then checked as single decompositions are.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline typename IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+number_of_decompositions_type
+IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+countInRange() {
+	const Frame& above = frames[1];
+	const Frame& frame = frames[0];
+	const value_type span = frame.upper - frame.lower;
+	value_type first = (above.m + frame.alphabet_mass - 1) / frame.alphabet_mass;
+	value_type last = std::min(span, above.m_high / frame.alphabet_mass);
+	if (first > last) {
+		return 0;
+	}
+	if (windowed) {
+		const double coefficient = mass_bounds[0].coefficient;
+		const double value = mass_bounds[1].value + coefficient * frame.lower;
+		// one amount more on both ends for rounding
+		const double low = std::ceil(
+			(window_mass - window_error - value) / coefficient) - 1.0;
+		const double high = std::floor(
+			(window_mass + window_error - value) / coefficient) + 1.0;
+		if (high < static_cast<double>(first) || low > static_cast<double>(last)) {
+			return 0;
+		}
+		if (low > static_cast<double>(first)) {
+			first = static_cast<value_type>(low);
+		}
+		if (high < static_cast<double>(last)) {
+			last = static_cast<value_type>(high);
+		}
+		while (first <= last && !isWithinMassWindowAt(first)) {
+			++first;
+		}
+		while (last > first && !isWithinMassWindowAt(last)) {
+			--last;
+		}
+		if (first > last) {
+			return 0;
+		}
+	}
+	return last - first + 1;
+}
+
+
+/**
+ * Returns true if level 0 with @c amount completes a decomposition 
+ * within the mass window, see isWithinMassWindow().
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+isWithinMassWindowAt(value_type amount) {
+	decomposition[0] = static_cast<decomposition_value_type>(amount + frames[0].lower);
+	carryMass(0);
+	return isWithinMassWindow(mass_bounds[0].value);
+}
+
+
+/**
+ * Positions @c level on its first amount for a range of masses, skipping 
+ * the amounts whose mass rests are too large for the levels below.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+firstInRange(size_type level) {
+	Frame& frame = frames[level];
+	frame.i = 0;
+	if (level == 0) {
+		frame.i = (frame.mass + frame.alphabet_mass - 1) / frame.alphabet_mass;
+	} else if (frame.mass > frame.max_mass_below) {
+		frame.i = (frame.mass - frame.max_mass_below + frame.alphabet_mass - 1) / 
+				  frame.alphabet_mass;
+	}
+	return seekInRange(level);
+}
+
+
+/**
+ * Starting with the current amount of @c level, finds the first amount 
+ * whose range of mass rests holds a mass decomposable over the levels below.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+seekInRange(size_type level) {
+	Frame& frame = frames[level];
+	const value_type span = frame.upper - frame.lower;
+	const value_type max_amount = std::min(span, frame.high / frame.alphabet_mass);
+
+	if (level == 0) {
+		// firstInRange() made the amount large enough
+		frame.m = frame.m_high = 0;
+		if (frame.i > max_amount) {
+			return false;
+		}
+		decomposition[0] = static_cast<decomposition_value_type>(frame.i + frame.lower);
+		carryMass(0);
+		return true;
+	}
+	for (; frame.i <= max_amount; ++frame.i) {
+		value_type taken = frame.i * frame.alphabet_mass;
+		frame.m = frame.mass > taken ? frame.mass - taken : 0;
+		frame.m_high = std::min(frame.high - taken, frame.max_mass_below);
+		if (frame.m <= frame.m_high && (level < narrowed_level || fitMassWindow(level)) &&
+			decomposer.isDecomposable(level - 1, frame.m, frame.m_high)) {
+			decomposition[level] = static_cast<decomposition_value_type>(
+				frame.i + frame.lower);
+			carryMass(level);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**
+ * Adds the real mass of the amount of @c level to the real mass of the
+ * amounts above. Done with and without a mass window, being cheaper 
+ * than testing for one.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline void IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+carryMass(size_type level) {
+	double mass = mass_bounds[level].coefficient * decomposition[level];
+	if (level + 1 < frames.size()) {
+		mass += mass_bounds[level+1].value;
+	}
+	mass_bounds[level].value = mass;
+}
+
+
+/**
+ * Narrows the range of mass rests of @c level to those whose real mass 
+ * may fill the mass window, given the amounts chosen on @c level and above.
+ * Returns false if none is left.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+fitMassWindow(size_type level) {
+	Frame& frame = frames[level];
+	const ConstraintBounds& bounds = mass_bounds[level];
+	if (bounds.min_ratio_below <= 0.0) {
+		// no mass below to bound
+		return true;
+	}
+	double value = bounds.coefficient * (frame.i + frame.lower) + 
+				   bounds.lower_bounds_value_below;
+	if (level + 1 < frames.size()) {
+		value += mass_bounds[level+1].value;
+	}
+	// the real mass of a rest lies between rest times the smallest and 
+	// the largest ratio of alphabet mass to weight below
+	const double tolerance = LinearConstraint::getTolerance();
+	const double low = (window_mass - window_error - tolerance - value) / bounds.max_ratio_below;
+	const double high = (window_mass + window_error + tolerance - value) / bounds.min_ratio_below;
+	if (high < static_cast<double>(frame.m) || low > static_cast<double>(frame.m_high)) {
+		return false;
+	}
+	if (low > static_cast<double>(frame.m)) {
+		frame.m = static_cast<value_type>(std::ceil(low));
+	}
+	if (high < static_cast<double>(frame.m_high)) {
+		frame.m_high = static_cast<value_type>(std::floor(high));
+	}
+	return frame.m <= frame.m_high;
+}
+
+
+/**
+ * Moves @c level to its next amount for a range of masses.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+advanceInRange(size_type level) {
+	++frames[level].i;
+	return seekInRange(level);
+}
+
+
+/**
+ * Skips the sub-masses of @c level that can't satisfy the constraints or
+ * the mass window, starting with the current one if @c found.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+admit(size_type level, bool found) {
+	if (constraints.empty() && (!windowed || ranged)) {
+		return found;
+	}
+	while (found && !isAdmissible(level)) {
+		found = ranged ? advanceInRange(level) : advance(level);
+	}
+	return found;
+}
+
+
+/**
+ * Returns true if the amounts chosen on @c level and above, together with 
+ * the mass rest of @c level, may still satisfy all constraints and the
+ * mass window. The window goes first, being the most selective.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+isAdmissible(size_type level) {
+	if (windowed && !ranged && !isWithinLimits(&mass_bounds[0], level, 
+			window_mass - window_error, window_mass + window_error)) {
+		return false;
+	}
+	for (size_type c = 0; c < constraints.size(); ++c) {
+		if (!isWithinLimits(&constraint_bounds[c * frames.size()], level, 
+				constraints[c].getMin(), constraints[c].getMax())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/**
+ * Returns true if the value of a linear function with @c bounds may still 
+ * lie within [@c min, @c max]. Updates its value on @c level, which is 
+ * only read below an admissible level. With a range of mass rests, the 
+ * value bounds are taken at the end of the range where they are widest.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+isWithinLimits(ConstraintBounds* bounds, size_type level, double min, double max) {
+	const double low_rest = static_cast<double>(frames[level].m);
+	const double high_rest = ranged ? static_cast<double>(frames[level].m_high) : low_rest;
+	double value = bounds[level].coefficient * decomposition[level];
+	if (level + 1 < frames.size()) {
+		value += bounds[level+1].value;
+	}
+	bounds[level].value = value;
+
+	value += bounds[level].lower_bounds_value_below;
+	const double max_ratio = bounds[level].max_ratio_below;
+	const double min_ratio = bounds[level].min_ratio_below;
+	return value + std::max(low_rest * max_ratio, high_rest * max_ratio) >= 
+				min - LinearConstraint::getTolerance() &&
+		   value + std::min(low_rest * min_ratio, high_rest * min_ratio) <= 
+				max + LinearConstraint::getTolerance();
+}
+
+
+/**
+ * Returns true if the real @c mass of a complete decomposition lies 
+ * within the mass window, keeping it as the current mass. Close to the 
+ * limits, the mass is summed up again in the order of 
+ * DecompUtils::getParentMass(), so that rounding doesn't depend on the 
+ * order of enumeration.
+ */
+template <typename ValueType, typename DecompositionValueType>
+inline bool IntegerMassDecomposer<ValueType, DecompositionValueType>::DecompositionCursor::
+isWithinMassWindow(double mass) {
+	double distance = std::fabs(mass - window_mass) - window_error;
+	if (std::fabs(distance) > LinearConstraint::getTolerance()) {
+		current_mass = mass;
+		return distance < 0.0;
+	}
+	current_mass = 0.0;
+	for (size_type level = 0; level < frames.size(); ++level) {
+		current_mass += decomposition[level] * mass_bounds[level].coefficient;
+	}
+	return std::fabs(current_mass - window_mass) <= window_error;
+}
+
+
 /**
  * Gets number of all possible decompositions for a given @c mass.
- * Since using getAllDecomposition() the usage of this function could 
- * be @b consuming.
  * 
  * @param mass Mass to be decomposed
  * @return number of decompositions for given mass.
@@ -491,7 +1713,9 @@ template <typename ValueType, typename DecompositionValueType>
 typename IntegerMassDecomposer<ValueType, DecompositionValueType>::
 decomposition_value_type IntegerMassDecomposer<ValueType, 
 DecompositionValueType>::getNumberOfDecompositions(value_type mass) {
-	return getAllDecompositions(mass).size();
+	SeriesCounter counter;
+	visitDecompositionSeries(mass, counter);
+	return static_cast<decomposition_value_type>(counter.number_of_decompositions);
 }
 
 
@@ -0,0 +1,103 @@
+#ifndef IMS_LINEARCONSTRAINT_H
+#define IMS_LINEARCONSTRAINT_H
+
+#include <vector>
+
+namespace ims {
+
+/**
+ * @brief Linear constraint on the amounts of a decomposition:
+ * min <= sum(coefficients[i] * decomposition[i]) <= max.
+ *
+ * Many chemical rules are of this form, e.g. the double bond equivalent
+ * DBE = 1 + C - H/2 + N/2 (with the constant 1 moved into the limits) or
+ * ratio windows like H/C <= 3.1, written as H - 3.1 C <= 0. Since the
+ * value is linear, the decomposition cursors can bound it for partial
+ * decompositions and prune whole subtrees of the enumeration.
+ *
+ * @see IntegerMassDecomposer::DecompositionCursor::addConstraint()
+ *
+ * @ingroup decomp
+ */
+class LinearConstraint {
+	public:
+		/**
+		 * Type of coefficients, one per alphabet mass.
+		 */
+		typedef std::vector<double> coefficients_type;
+
+		/**
+		 * Constructor with coefficients and limits of the value.
+		 */
+		LinearConstraint(const coefficients_type& coefficients,
+						 double min, double max) :
+			coefficients(coefficients), min(min), max(max) {}
+
+		/**
+		 * Gets the coefficients.
+		 */
+		const coefficients_type& getCoefficients() const { return coefficients; }
+
+		/**
+		 * Gets the coefficient of alphabet mass @c index.
+		 */
+		double getCoefficient(coefficients_type::size_type index) const {
+			return coefficients.at(index);
+		}
+
+		/**
+		 * Gets the smallest value allowed.
+		 */
+		double getMin() const { return min; }
+
+		/**
+		 * Gets the largest value allowed.
+		 */
+		double getMax() const { return max; }
+
+		/**
+		 * Gets the value of @c decomposition.
+		 */
+		template <typename DecompositionType>
+		double getValue(const DecompositionType& decomposition) const;
+
+		/**
+		 * Returns true if @c value lies within the limits, up to rounding
+		 * errors of the floating point coefficients.
+		 */
+		bool isSatisfied(double value) const {
+			return value >= min - getTolerance() && value <= max + getTolerance();
+		}
+
+		/**
+		 * Returns true if the value of @c decomposition lies within the limits.
+		 */
+		template <typename DecompositionType>
+		bool isSatisfied(const DecompositionType& decomposition) const {
+			return isSatisfied(getValue(decomposition));
+		}
+
+		/**
+		 * Gets the absolute tolerance for comparing values with the limits.
+		 */
+		static double getTolerance() { return 1.0e-9; }
+
+	private:
+		coefficients_type coefficients;
+		double min, max;
+};
+
+
+template <typename DecompositionType>
+double LinearConstraint::getValue(const DecompositionType& decomposition) const {
+	double value = 0.0;
+	for (coefficients_type::size_type i = 0;
+			i < coefficients.size() && i < decomposition.size(); ++i) {
+		value += coefficients[i] * decomposition[i];
+	}
+	return value;
+}
+
+} // namespace ims
+
+#endif // IMS_LINEARCONSTRAINT_H
@@ -0,0 +1,129 @@
+#include <ims/decomp/precisionselector.h>
+#include <ims/decomp/decomputils.h>
+#include <ims/base/exception/invalidargumentexception.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace ims {
+
+namespace {
+
+// seconds per candidate decomposition checked by the real mass filter
+const double CANDIDATE_COST = 3.0e-07;
+// seconds per integer mass of the window
+const double INTEGER_MASS_COST = 3.0e-08;
+// seconds per residue table entry built
+const double TABLE_ENTRY_COST = 1.0e-08;
+// integer weights have to fit the entries of CompactResidueTable
+const double MAX_WEIGHT = 4294967295.0;
+
+} // namespace
+
+
+PrecisionSelector::PrecisionSelector(const masses_type& alphabet_masses) :
+	alphabet_masses(alphabet_masses), queries(0.0), max_table_size(33554432.0) {
+	if (alphabet_masses.empty()) {
+		throw InvalidArgumentException("alphabet is empty");
+	}
+	setMassRange(100.0, 1000.0, 2.0);
+}
+
+
+void PrecisionSelector::setMassRange(double min_mass, double max_mass,
+		double ppm, double absolute_error, std::size_t samples) {
+	std::vector<double> masses, errors;
+	for (std::size_t i = 0; i < samples; ++i) {
+		double mass = min_mass;
+		if (samples > 1) {
+			mass += (max_mass - min_mass) * i / (samples - 1);
+		}
+		masses.push_back(mass);
+		errors.push_back(mass * ppm * 1.0e-06 + absolute_error);
+	}
+	setMasses(masses, errors);
+}
+
+
+void PrecisionSelector::setMasses(const std::vector<double>& masses,
+		const std::vector<double>& errors) {
+	if (masses.empty() || masses.size() != errors.size()) {
+		throw InvalidArgumentException("masses and errors don't match");
+	}
+	this->masses = masses;
+	this->errors = errors;
+}
+
+
+double PrecisionSelector::getDensity(double mass) const {
+	// decompositions of masses up to M with k alphabet masses lie in a
+	// simplex of volume M^k / (k! * product of masses)
+	double density = 1.0;
+	for (masses_type::size_type i = 0; i < alphabet_masses.size(); ++i) {
+		if (i > 0) {
+			density *= mass / i;
+		}
+		density /= alphabet_masses[i];
+	}
+	return density;
+}
+
+
+double PrecisionSelector::getCost(double precision) const {
+	double min_mass = *std::min_element(alphabet_masses.begin(), alphabet_masses.end());
+	double max_mass = *std::max_element(alphabet_masses.begin(), alphabet_masses.end());
+	double table_size = alphabet_masses.size() * std::ceil(min_mass / precision);
+	if (precision <= 0.0 || std::ceil(max_mass / precision) >= MAX_WEIGHT ||
+			table_size > max_table_size) {
+		return -1.0;
+	}
+
+	std::pair<double, double> rounding_errors =
+		DecompUtils::getMinMaxWeightsRoundingErrors(Weights(alphabet_masses, precision));
+
+	double query_cost = 0.0;
+	for (std::vector<double>::size_type i = 0; i < masses.size(); ++i) {
+		// integer masses enumerated by RealMassDecomposer::getIntegerMassRange()
+		double integer_masses =
+			((1 + rounding_errors.second) * (masses[i] + errors[i]) -
+			 (1 + rounding_errors.first) * (masses[i] - errors[i])) / precision + 1;
+		query_cost += CANDIDATE_COST * getDensity(masses[i]) * integer_masses * precision +
+					  INTEGER_MASS_COST * integer_masses;
+	}
+	double queries = this->queries > 0.0 ? this->queries : masses.size();
+	return TABLE_ENTRY_COST * table_size + query_cost * queries / masses.size();
+}
+
+
+double PrecisionSelector::select() const {
+	std::vector<double> candidates = getCandidates();
+	double best_precision = 0.0, best_cost = -1.0;
+	for (std::vector<double>::size_type i = 0; i < candidates.size(); ++i) {
+		double cost = getCost(candidates[i]);
+		if (cost >= 0.0 && (best_cost < 0.0 || cost < best_cost)) {
+			best_cost = cost;
+			best_precision = candidates[i];
+		}
+	}
+	if (best_cost < 0.0) {
+		throw InvalidArgumentException("no feasible precision for the alphabet");
+	}
+	return best_precision;
+}
+
+
+std::vector<double> PrecisionSelector::getCandidates() {
+	std::vector<double> candidates;
+	const double factors[] = { 1.0, 2.0, 5.0 };
+	for (int exponent = -6; exponent <= -2; ++exponent) {
+		for (int i = 0; i < 3; ++i) {
+			candidates.push_back(factors[i] * std::pow(10.0, exponent));
+			if (exponent == -2) {
+				break;
+			}
+		}
+	}
+	return candidates;
+}
+
+} // namespace ims
@@ -0,0 +1,110 @@
+#ifndef IMS_PRECISIONSELECTOR_H
+#define IMS_PRECISIONSELECTOR_H
+
+#include <vector>
+#include <cstddef>
+
+#include <ims/weights.h>
+
+namespace ims {
+
+/**
+ * @brief Chooses the precision of the integer weights used for real mass
+ * decomposition.
+ *
+ * The precision trades the size of the residue table, which grows with
+ * the smallest integer weight, against the work of RealMassDecomposer:
+ * a query enumerates all integer masses the real mass and its error
+ * window map to, widened by the rounding errors of the weights (see
+ * DecompUtils::getMinMaxWeightsRoundingErrors()), and rejects the
+ * decompositions whose real mass lies outside the window. Since these
+ * rounding errors depend irregularly on the precision, a finer precision
+ * is not always faster.
+ *
+ * The expected time of a query for mass @c M with error @c e is modelled as
+ * - the number of candidate decompositions, the density of decompositions
+ *   of the alphabet at @c M times the width of the widened window in Da, and
+ * - the number of integer masses in the widened window,
+ * each weighted with a measured cost. Building the table costs time
+ * proportional to its size, spread over the number of queries
+ * (see setNumberOfQueries()). select() returns the candidate precision
+ * with the smallest total over the given masses.
+ *
+ * Decompositions do not depend on the precision, RealMassDecomposer
+ * checks the real masses.
+ *
+ * @ingroup decomp
+ */
+class PrecisionSelector {
+	public:
+		/**
+		 * Type of alphabet masses.
+		 */
+		typedef Weights::alphabet_masses_type masses_type;
+
+		/**
+		 * Constructor with the alphabet masses. The masses expected to be
+		 * decomposed default to 100 to 1000 Da with an error of 2 ppm.
+		 */
+		explicit PrecisionSelector(const masses_type& alphabet_masses);
+
+		/**
+		 * Sets the masses expected to be decomposed to @c samples masses
+		 * evenly spread from @c min_mass to @c max_mass, each with an
+		 * error of @c ppm parts per million plus @c absolute_error Da.
+		 */
+		void setMassRange(double min_mass, double max_mass, double ppm,
+						  double absolute_error = 0.0, std::size_t samples = 16);
+
+		/**
+		 * Sets the masses expected to be decomposed and their errors.
+		 */
+		void setMasses(const std::vector<double>& masses,
+					   const std::vector<double>& errors);
+
+		/**
+		 * Sets the number of queries the decomposer is built for, to which
+		 * the masses are representative. Defaults to the number of masses.
+		 */
+		void setNumberOfQueries(double queries) { this->queries = queries; }
+
+		/**
+		 * Sets the largest residue table allowed, in entries.
+		 */
+		void setMaxTableSize(double size) { max_table_size = size; }
+
+		/**
+		 * Gets the expected time in seconds to build a decomposer with
+		 * @c precision and decompose all queries, or a negative value if the
+		 * precision is not feasible (the table is too large or the integer
+		 * weights overflow).
+		 */
+		double getCost(double precision) const;
+
+		/**
+		 * Gets the feasible candidate precision of smallest cost.
+		 */
+		double select() const;
+
+		/**
+		 * Gets the precisions considered by select(), 1, 2 and 5 times
+		 * powers of ten from 1e-6 to 1e-2.
+		 */
+		static std::vector<double> getCandidates();
+
+	private:
+		/**
+		 * Gets the number of decompositions per Da at @c mass.
+		 */
+		double getDensity(double mass) const;
+
+		masses_type alphabet_masses;
+		std::vector<double> masses;
+		std::vector<double> errors;
+		double queries;
+		double max_table_size;
+};
+
+} // namespace ims
+
+#endif // IMS_PRECISIONSELECTOR_H
@@ -8,85 +8,200 @@
 #include <ims/decomp/realmassdecomposer.h>
 #include <ims/decomp/decomputils.h>
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cmath>
 
 namespace ims {
 
 
-RealMassDecomposer::RealMassDecomposer(const Weights& weights) :
-		weights(weights) {
+template <typename IntegerDecomposerType>
+BasicRealMassDecomposer<IntegerDecomposerType>::BasicRealMassDecomposer(
+		const Weights& weights) : weights(weights), 
+		decomposer(new integer_decomposer_type(weights)) {
 			
 	rounding_errors =
 		DecompUtils::getMinMaxWeightsRoundingErrors(weights);
 	precision = weights.getPrecision();
-	decomposer = std::auto_ptr<integer_decomposer_type>(
-							new integer_decomposer_type(weights));
 }
 
 
-RealMassDecomposer::decompositions_type
-RealMassDecomposer::getDecompositions(double mass, double error) {
-	// defines the range of integers to be decomposed
-	integer_value_type start_integer_mass = static_cast<integer_value_type>(
-		ceil((1 + rounding_errors.first) * (mass - error) / precision));
+template <typename IntegerDecomposerType>
+BasicRealMassDecomposer<IntegerDecomposerType>::BasicRealMassDecomposer(
+		const Weights& weights, integer_decomposer_type* decomposer) : 
+		weights(weights), decomposer(decomposer) {
+			
+	rounding_errors =
+		DecompUtils::getMinMaxWeightsRoundingErrors(weights);
+	precision = weights.getPrecision();
+}
+
+
+template <typename IntegerDecomposerType>
+std::pair<typename BasicRealMassDecomposer<IntegerDecomposerType>::integer_value_type, 
+		  typename BasicRealMassDecomposer<IntegerDecomposerType>::integer_value_type>
+BasicRealMassDecomposer<IntegerDecomposerType>::getIntegerMassRange(double mass, 
+																	double error) const {
+	// defines the range of integers to be decomposed. The ends are rounded
+	// outwards and the range is half-open, so decompositions exactly at 
+	// the error limits are kept despite floating point errors; the real
+	// mass check removes anything outside.
+	integer_value_type start_integer_mass = static_cast<integer_value_type>(1);
+	if (!std::isfinite(mass) || !std::isfinite(error) || mass + error <= 0) {
+		// nothing to decompose, and no integer to round to
+		return std::make_pair(start_integer_mass, start_integer_mass);
+	}
+	if (mass - error > 0) {
+		start_integer_mass = std::max(start_integer_mass, static_cast<integer_value_type>(
+			floor((1 + rounding_errors.first) * (mass - error) / precision)));
+	}
 	integer_value_type end_integer_mass = static_cast<integer_value_type>(
-		floor((1 + rounding_errors.second) * (mass + error) / precision));
+		ceil((1 + rounding_errors.second) * (mass + error) / precision)) + 1;
 
-	decompositions_type all_decompositions_from_range;
+	return std::make_pair(start_integer_mass, end_integer_mass);
+}
 
-	// loops and finds decompositions for every integer mass,
-	// then checks if real mass of decomposition lays in the allowed
-	// error interval [mass-error; mass+error]
-	for (integer_value_type integer_mass = start_integer_mass;
-							integer_mass < end_integer_mass; ++integer_mass) {
-		decompositions_type decompositions =
-			decomposer->getAllDecompositions(integer_mass);
-		for (decompositions_type::iterator pos = decompositions.begin();
-			 						pos != decompositions.end();) {
-			double parent_mass =
-						DecompUtils::getParentMass(weights, *pos);
-			if (fabs(parent_mass - mass) > error) {
-				pos = decompositions.erase(pos);
-			} else {
-				++pos;
-			}
+
+namespace {
+
+/**
+ * Copies every decomposition it visits into a container.
+ */
+template <typename DecompositionsType>
+class DecompositionsCollector {
+	public:
+		DecompositionsCollector(DecompositionsType& decompositions) :
+			decompositions(decompositions) {}
+		void operator()(const typename DecompositionsType::value_type& decomposition) {
+			decompositions.push_back(decomposition);
 		}
-		all_decompositions_from_range.insert(all_decompositions_from_range.end(), 
-								decompositions.begin(), decompositions.end());
-	}
+	private:
+		DecompositionsType& decompositions;
+};
+
+} // namespace
+
 
+template <typename IntegerDecomposerType>
+typename BasicRealMassDecomposer<IntegerDecomposerType>::decompositions_type
+BasicRealMassDecomposer<IntegerDecomposerType>::getDecompositions(double mass, double error) {
+	decompositions_type all_decompositions_from_range;
+	DecompositionsCollector<decompositions_type> collector(all_decompositions_from_range);
+	visitDecompositions(mass, error, collector);
 	return all_decompositions_from_range;
 }
 
-RealMassDecomposer::number_of_decompositions_type
-RealMassDecomposer::getNumberOfDecompositions(double mass, double error) {
-	// defines the range of integers to be decomposed
-	integer_value_type start_integer_mass = static_cast<integer_value_type>(1);
-	if (mass - error > 0) {
-		start_integer_mass = static_cast<integer_value_type>(
-		ceil((1 + rounding_errors.first) * (mass - error) / precision));
+
+template <typename IntegerDecomposerType>
+typename BasicRealMassDecomposer<IntegerDecomposerType>::decompositions_type
+BasicRealMassDecomposer<IntegerDecomposerType>::getClosestDecompositions(double mass, 
+		double error, size_type number) {
+	decompositions_type closest;
+	DecompositionCursor cursor(*this);
+	cursor.getClosest(mass, error, number, closest);
+	return closest;
+}
+
+
+template <typename IntegerDecomposerType>
+typename BasicRealMassDecomposer<IntegerDecomposerType>::number_of_decompositions_type
+BasicRealMassDecomposer<IntegerDecomposerType>::getNumberOfDecompositions(double mass, 
+																		  double error) const {
+	DecompositionCursor cursor(*this);
+	cursor.reset(mass, error);
+	return cursor.count();
+}
+
+
+template <typename IntegerDecomposerType>
+BasicRealMassDecomposer<IntegerDecomposerType>::DecompositionCursor::DecompositionCursor(
+		const BasicRealMassDecomposer& decomposer) :
+	decomposer(decomposer), cursor(*decomposer.decomposer) {
+}
+
+
+template <typename IntegerDecomposerType>
+void BasicRealMassDecomposer<IntegerDecomposerType>::DecompositionCursor::reset(
+		double mass, double error) {
+	// real masses out of the error interval [mass-error; mass+error]
+	// are pruned by the integer decomposer's cursor
+	cursor.setMassWindow(mass, error);
+	std::pair<integer_value_type, integer_value_type> range = 
+		decomposer.getIntegerMassRange(mass, error);
+	if (range.first < range.second) {
+		cursor.reset(range.first, range.second - 1);
+	} else {
+		// no integer mass, low > high
+		cursor.reset(1, 0);
 	}
-	integer_value_type end_integer_mass = static_cast<integer_value_type>(
-		floor((1 + rounding_errors.second) * (mass + error) / precision));
-
-	number_of_decompositions_type number_of_decompositions = static_cast<number_of_decompositions_type>(0);
-
-	// loops and finds decompositions for every integer mass,
-	// then checks if real mass of decomposition lays in the allowed
-	// error interval [mass-error; mass+error]
-	for (integer_value_type integer_mass = start_integer_mass;
-							integer_mass < end_integer_mass; ++integer_mass) {
-		decompositions_type decompositions =
-			decomposer->getAllDecompositions(integer_mass);
-		for (decompositions_type::iterator pos = decompositions.begin();
-			 						pos != decompositions.end(); ++pos) {
-			double parent_mass = DecompUtils::getParentMass(weights, *pos);
-			if (fabs(parent_mass - mass) <= error) {
-				++number_of_decompositions;
+}
+
+
+template <typename IntegerDecomposerType>
+bool BasicRealMassDecomposer<IntegerDecomposerType>::DecompositionCursor::next() {
+	return cursor.next();
+}
+
+
+template <typename IntegerDecomposerType>
+void BasicRealMassDecomposer<IntegerDecomposerType>::DecompositionCursor::getClosest(
+		double mass, double error, size_type number, decompositions_type& closest) {
+	closest.clear();
+	std::pair<integer_value_type, integer_value_type> range = 
+		decomposer.getIntegerMassRange(mass, error);
+	if (number == 0 || !(range.first < range.second)) {
+		return;
+	}
+
+	// closest decompositions found so far with their distances to the mass, 
+	// a heap with the farthest one on top
+	typedef std::pair<double, decomposition_type> candidate_type;
+	std::vector<candidate_type> candidates;
+
+	// the first window is 64 times smaller than the error
+	double window = error / 64.0;
+	while (true) {
+		if (window > error) {
+			window = error;
+		}
+		candidates.clear();
+		for (reset(mass, window); next(); ) {
+			// the mass carried by the cursor depends on the order of 
+			// summation, so equally close decompositions are ranked by the sum
+			// in alphabet order
+			double distance = std::fabs(
+				DecompUtils::getParentMass(decomposer.weights, current()) - mass);
+			if (candidates.size() < number) {
+				candidates.push_back(candidate_type(distance, current()));
+				std::push_heap(candidates.begin(), candidates.end());
+			} else if (distance < candidates.front().first || 
+					   (distance == candidates.front().first && 
+						current() < candidates.front().second)) {
+				// replaces the farthest one, reusing its storage
+				std::pop_heap(candidates.begin(), candidates.end());
+				candidates.back().first = distance;
+				candidates.back().second = current();
+				std::push_heap(candidates.begin(), candidates.end());
 			}
 		}
+		// all decompositions within the window are known, those outside 
+		// are farther away
+		if (candidates.size() == number || window >= error) {
+			break;
+		}
+		window *= 4.0;
 	}
 
-	return number_of_decompositions;
+	std::sort_heap(candidates.begin(), candidates.end());
+	closest.reserve(candidates.size());
+	for (typename std::vector<candidate_type>::const_iterator it = candidates.begin(); 
+			it != candidates.end(); ++it) {
+		closest.push_back(it->second);
+	}
 }
 
+// instantiates the real mass decomposer for the available integer decomposers
+template class BasicRealMassDecomposer<IntegerMassDecomposer<> >;
+template class BasicRealMassDecomposer<FastIntegerMassDecomposer<> >;
+
 } // namespace ims
@@ -2,9 +2,12 @@
 #define IMS_REALMASSDECOMPOSER_H
 
 #include <utility>
-#include <memory>
+#include <cmath>
+#include <limits>
 
 #include <ims/decomp/integermassdecomposer.h>
+#include <ims/decomp/fastintegermassdecomposer.h>
+#include <ims/decomp/decomputils.h>
 
 namespace ims {
 
@@ -24,31 +27,57 @@ namespace ims {
  * them using @c IntegerMassDecomposer, does some checks (i.e. on false 
  * positives appeared due to rounding) and collects decompositions together.
  * 
+ * The integer decomposer is a template parameter. It has to provide a 
+ * @c DecompositionCursor that can be reset to a range of masses and 
+ * restricted to a window of real masses, as 
+ * @c IntegerMassDecomposer (the default) and @c FastIntegerMassDecomposer 
+ * do. Both are instantiated in realmassdecomposer.cpp, @c RealMassDecomposer
+ * is the one with the default.
+ * 
+ * @param IntegerDecomposerType Type of decomposer for integer masses.
+ * 
  * @see IntegerMassDecomposer
  * 
  * @ingroup decomp
  * 
  * @author Anton Pervukhin <Anton.Pervukhin@CeBiTec.Uni-Bielefeld.DE> 
  */
-class RealMassDecomposer {
+template <typename IntegerDecomposerType = IntegerMassDecomposer<> >
+class BasicRealMassDecomposer {
 	public:
 		
 		/**
 		 * Type of integer decomposer.
 		 */
-		typedef IntegerMassDecomposer<> integer_decomposer_type;
+		typedef IntegerDecomposerType integer_decomposer_type;
 		
 		/**
 		 * Type of integer values that are decomposed.
 		 */
-		typedef integer_decomposer_type::value_type integer_value_type;
+		typedef typename integer_decomposer_type::value_type integer_value_type;
 		
 		/**
 		 * Type of result decompositions from integer decomposer.
 		 */
-		typedef integer_decomposer_type::decompositions_type 
+		typedef typename integer_decomposer_type::decompositions_type 
 											decompositions_type;
 
+		/**
+		 * Type of the number of decompositions kept.
+		 */
+		typedef typename decompositions_type::size_type size_type;
+
+		/**
+		 * Type of one decomposition.
+		 */
+		typedef typename integer_decomposer_type::decomposition_type decomposition_type;
+
+		/**
+		 * Type of amounts in a decomposition.
+		 */
+		typedef typename integer_decomposer_type::decomposition_value_type 
+											decomposition_value_type;
+
 		/**
 		 * Type of the number of decompositions.
 		 */
@@ -59,7 +88,30 @@ class RealMassDecomposer {
 		 * 
 		 * @param weights Weights over which values/masses to be decomposed.
 		 */
-		RealMassDecomposer(const Weights& weights);
+		BasicRealMassDecomposer(const Weights& weights);
+
+		/**
+		 * Constructor with weights and an integer decomposer built for 
+		 * them, e.g. one read from a residue table file. Takes ownership 
+		 * of @c decomposer, which must have been allocated by new.
+		 * 
+		 * @param weights Weights over which values/masses to be decomposed.
+		 * @param decomposer Integer decomposer for @c weights.
+		 */
+		BasicRealMassDecomposer(const Weights& weights, 
+								integer_decomposer_type* decomposer);
+
+		/**
+		 * Destructor, deletes the integer decomposer.
+		 */
+		~BasicRealMassDecomposer() { delete decomposer; }
+
+		/**
+		 * Gets the integer decomposer, e.g. to save its residue table.
+		 */
+		const integer_decomposer_type& getIntegerDecomposer() const {
+			return *decomposer;
+		}
 		
 		/**
 		 * Gets all decompositions for a @c mass with an @c error allowed.
@@ -70,17 +122,95 @@ class RealMassDecomposer {
 		 */
 		decompositions_type getDecompositions(double mass, double error);
 
+		/**
+		 * Gets the @c number decompositions closest to @c mass with an 
+		 * @c error allowed, see DecompositionCursor::getClosest().
+		 * 
+		 * @param mass Mass to be decomposed.
+		 * @param error Error allowed between given and result decomposition.
+		 * @param number Maximal number of decompositions returned.
+		 * @return Decompositions ordered by increasing distance of their 
+		 * real masses to @c mass.
+		 */
+		decompositions_type getClosestDecompositions(double mass, double error, 
+													 size_type number);
+
 		/**
 		 * Gets a number of all decompositions for a @c mass with an @c error
-		 * allowed. It's similar to the @c getDecompositions(double,double) function
-		 * but less space consuming, since doesn't use container to store decompositions.
+		 * allowed, see DecompositionCursor::count(). With 
+		 * IntegerMassDecomposer, all integer masses of the range are 
+		 * decomposed in one traversal and the amounts of the smallest 
+		 * alphabet mass are counted rather than enumerated. The larger 
+		 * alphabet masses are still enumerated, so this costs about as much
+		 * as visitDecompositions() with a visitor doing nothing. For many 
+		 * masses, DecompositionCounter gives the same numbers much faster.
 		 * 
 		 * @param mass Mass to be decomposed.
 		 * @param error Error allowed between given and result decomposition.
 		 * @return Number of all decompositions for a given mass and error.
 		 */
-		number_of_decompositions_type getNumberOfDecompositions(double mass, double error);
+		number_of_decompositions_type getNumberOfDecompositions(double mass, double error) const;
+
+		/**
+		 * Calls @c visitor(decomposition) for every decomposition of @c mass 
+		 * with an @c error allowed, without storing them. The decomposition 
+		 * passed is reused between calls and must be copied if it's to be kept.
+		 * 
+		 * @param mass Mass to be decomposed.
+		 * @param error Error allowed between given and result decomposition.
+		 * @param visitor Functor taking a <tt>const decomposition_type&</tt>.
+		 */
+		template <typename DecompositionVisitor>
+		void visitDecompositions(double mass, double error, 
+								 DecompositionVisitor& visitor) const;
+
+		/**
+		 * Same as visitDecompositions(double, double, DecompositionVisitor&), 
+		 * but visits only decompositions whose amounts lie within 
+		 * [@c lower_bounds[i], @c upper_bounds[i]] for every element i of 
+		 * the weights. Depending on the integer decomposer, bounds prune 
+		 * the enumeration rather than filtering its results, see 
+		 * DecompositionCursor::setBounds().
+		 *
+		 * @param mass Mass to be decomposed.
+		 * @param error Error allowed between given and result decomposition.
+		 * @param lower_bounds Minimal amounts of elements.
+		 * @param upper_bounds Maximal amounts of elements, 
+		 * @c getUnboundedAmount() for no limit.
+		 * @param visitor Functor taking a <tt>const decomposition_type&</tt>.
+		 */
+		template <typename DecompositionVisitor>
+		void visitDecompositions(double mass, double error, 
+								 const decomposition_type& lower_bounds,
+								 const decomposition_type& upper_bounds,
+								 DecompositionVisitor& visitor) const;
+
+		/**
+		 * Gets the upper bound meaning "no limit" on the amount of an element.
+		 */
+		static decomposition_value_type getUnboundedAmount() {
+			return std::numeric_limits<decomposition_value_type>::max();
+		}
+
+		/**
+		 * Gets the number of bytes allocated for the precomputed tables of
+		 * the integer decomposer.
+		 */
+		std::size_t getMemoryUsage() const {
+			return sizeof(*this) + decomposer->getMemoryUsage();
+		}
+
+		class DecompositionCursor;
+		friend class DecompositionCursor;
+
 	private:
+		/**
+		 * Gets the range [first, second) of integer masses whose decompositions 
+		 * may lie within @c error of @c mass.
+		 */
+		std::pair<integer_value_type, integer_value_type> 
+			getIntegerMassRange(double mass, double error) const;
+
 		/**
 		 * Weights over which values/masses to be decomposed.
 		 */
@@ -98,11 +228,158 @@ class RealMassDecomposer {
 		
 		/**
 		 * Decomposer to be used for exact decomposing using 
-		 * integer arithmetics.
+		 * integer arithmetics, owned.
+		 */
+		integer_decomposer_type* decomposer;
+
+		// not copyable, the integer decomposer is owned
+		BasicRealMassDecomposer(const BasicRealMassDecomposer&);
+		BasicRealMassDecomposer& operator=(const BasicRealMassDecomposer&);
+};
+
+
+/**
+ * Real mass decomposer with the default integer decomposer.
+ */
+typedef BasicRealMassDecomposer<> RealMassDecomposer;
+
+
+/**
+ * @brief Iterates over all decompositions of a real mass one at a time.
+ *
+ * Cursor counterpart of @c BasicRealMassDecomposer::visitDecompositions:
+ *
+ * @code
+ * RealMassDecomposer::DecompositionCursor cursor(decomposer);
+ * for (cursor.reset(mass, error); cursor.next(); ) {
+ *     use(cursor.current());
+ * }
+ * @endcode
+ *
+ * Buffers are allocated once and reused by reset(). The decomposer must 
+ * outlive the cursor and is only read.
+ */
+template <typename IntegerDecomposerType>
+class BasicRealMassDecomposer<IntegerDecomposerType>::DecompositionCursor {
+	public:
+		/**
+		 * Constructor with decomposer whose decompositions are iterated.
+		 */
+		DecompositionCursor(const BasicRealMassDecomposer& decomposer);
+
+		/**
+		 * Restricts the amount of every element i to 
+		 * [@c lower_bounds[i], @c upper_bounds[i]] for all following resets.
+		 * The bounds are passed on to the integer decomposer's cursor.
 		 */
-		std::auto_ptr<integer_decomposer_type> decomposer;
+		void setBounds(const decomposition_type& lower_bounds, 
+					   const decomposition_type& upper_bounds) {
+			cursor.setBounds(lower_bounds, upper_bounds);
+		}
+
+		/**
+		 * Removes the bounds set by setBounds().
+		 */
+		void clearBounds() { cursor.clearBounds(); }
+
+		/**
+		 * Adds a linear @c constraint on the amounts for all following 
+		 * resets, see LinearConstraint. It's passed on to the integer 
+		 * decomposer's cursor.
+		 */
+		void addConstraint(const LinearConstraint& constraint) {
+			cursor.addConstraint(constraint);
+		}
+
+		/**
+		 * Removes all constraints added by addConstraint().
+		 */
+		void clearConstraints() { cursor.clearConstraints(); }
+
+		/**
+		 * Starts iterating the decompositions of @c mass with @c error allowed.
+		 */
+		void reset(double mass, double error);
+
+		/**
+		 * Moves to the next decomposition.
+		 *
+		 * @return false if there are no more decompositions.
+		 */
+		bool next();
+
+		/**
+		 * Gets the current decomposition. Only valid after next() returned true.
+		 */
+		const decomposition_type& current() const { return cursor.current(); }
+
+		/**
+		 * Counts the decompositions that next() would still return and 
+		 * finishes the iteration, see 
+		 * IntegerMassDecomposer<>::DecompositionCursor::count().
+		 */
+		number_of_decompositions_type count() { return cursor.count(); }
+
+		/**
+		 * Gets the highest index whose amount may differ from the previous
+		 * decomposition, see IntegerMassDecomposer<>::DecompositionCursor::getChangedLevel().
+		 */
+		size_type getChangedLevel() const { return cursor.getChangedLevel(); }
+
+		/**
+		 * Gets the @c number decompositions of @c mass within @c error
+		 * whose real masses are closest to @c mass, ordered by increasing
+		 * distance (decompositions at the same distance by their amounts).
+		 * Bounds and constraints apply as for reset().
+		 *
+		 * Decompositions are searched within windows around @c mass that 
+		 * grow by a factor of 4 up to @c error, keeping the closest ones in
+		 * a heap of size @c number. The first window holding @c number 
+		 * decompositions contains the closest ones, so where decompositions 
+		 * are dense only a small part of the error window is enumerated. 
+		 * If there are fewer than @c number, the whole window is 
+		 * enumerated at about 4/3 of the cost of reset().
+		 *
+		 * Leaves the cursor reset to the last window searched.
+		 */
+		void getClosest(double mass, double error, size_type number, 
+						decompositions_type& closest);
+
+		/**
+		 * Gets the real mass of the current decomposition. Only valid after 
+		 * next() returned true.
+		 */
+		double getMass() const { return cursor.getMass(); }
+
+	private:
+		const BasicRealMassDecomposer& decomposer;
+		typename integer_decomposer_type::DecompositionCursor cursor;
 };
 
+
+template <typename IntegerDecomposerType>
+template <typename DecompositionVisitor>
+void BasicRealMassDecomposer<IntegerDecomposerType>::visitDecompositions(
+		double mass, double error, DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	for (cursor.reset(mass, error); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
+
+
+template <typename IntegerDecomposerType>
+template <typename DecompositionVisitor>
+void BasicRealMassDecomposer<IntegerDecomposerType>::visitDecompositions(
+		double mass, double error, const decomposition_type& lower_bounds,
+		const decomposition_type& upper_bounds, DecompositionVisitor& visitor) const {
+	DecompositionCursor cursor(*this);
+	cursor.setBounds(lower_bounds, upper_bounds);
+	for (cursor.reset(mass, error); cursor.next(); ) {
+		visitor(cursor.current());
+	}
+}
+
 } // namespace ims
 
 #endif // IMS_REALMASSDECOMPOSER_H
@@ -0,0 +1,380 @@
+#ifndef IMS_RESIDUECOLUMNFILLER_H
+#define IMS_RESIDUECOLUMNFILLER_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <ims/utils/gcd.h>
+
+namespace ims {
+
+/**
+ * @brief Fills a column of the extended residue table from the previous one.
+ *
+ * Adding the alphabet mass @c m to a residue modulo the smallest alphabet
+ * mass @c a again and again visits all residues of its class modulo
+ * <tt>d = gcd(a, m)</tt> in one round. Along the round, the column is the
+ * recurrence <tt>n(p + m) = min(prev_column[p + m], n(p) + m)</tt>. Every
+ * round starts at its smallest entry of the previous column, which the
+ * recurrence can't improve: residue 0 with mass 0 for the class of 0. This
+ * is what fillSequentially() does. The witness of a residue whose mass
+ * is improved is the column together with the number of times @c m was
+ * added since the round last took an entry of the previous column.
+ *
+ * The residues visited one after another lie far apart, so for large
+ * columns every step waits for main memory, although it does next to no
+ * computation. fill() cuts the rounds into lanes instead, lane @c j
+ * starting at the residues <tt>[j * d, (j + 1) * d)</tt> and running until
+ * it reaches the start of another lane. The lanes are stepped together: in
+ * every step they visit consecutive residues, so the columns are read and
+ * written in long runs. By the three gap theorem, the lanes take at most
+ * three different lengths. Every lane restarts the recurrence from its
+ * first residues. Afterwards, in the order of each round, the end of a lane
+ * is carried into the next lane as long as it gives a smaller (or equal)
+ * mass than the lane's own recurrence, which usually takes only a few
+ * steps. Column and witnesses are the same as those of fillSequentially().
+ *
+ * The lane buffers are kept between columns.
+ *
+ * @param ValueType Type of masses.
+ * @param DecompositionValueType Type of amounts in the witness vector.
+ *
+ * @ingroup decomp
+ */
+template <typename ValueType, typename DecompositionValueType>
+class ResidueColumnFiller {
+	public:
+		typedef ValueType value_type;
+
+		typedef DecompositionValueType decomposition_value_type;
+
+		typedef std::vector<value_type> column_type;
+
+		typedef typename column_type::size_type size_type;
+
+		/**
+		 * Type of the witness vector, see IntegerMassDecomposer.
+		 */
+		typedef std::vector< std::pair<size_type, decomposition_value_type> > witness_vector_type;
+
+		/**
+		 * Creates a filler with the default number of lanes.
+		 */
+		ResidueColumnFiller() : max_lanes(DEFAULT_LANES), min_column_size(DEFAULT_MIN_COLUMN_SIZE) {}
+
+		/**
+		 * Sets the number of residues visited by all lanes in one step.
+		 */
+		void setNumberOfLanes(size_type lanes) { max_lanes = lanes; }
+
+		/**
+		 * Sets the size of the smallest column filled in lanes. Smaller
+		 * columns are filled sequentially.
+		 */
+		void setMinColumnSize(size_type size) { min_column_size = size; }
+
+		/**
+		 * Fills @c cur_column from @c prev_column for the alphabet mass
+		 * @c mass at @c column. Sets the witnesses of the residues whose
+		 * smallest mass is improved. @c prev_column[0] must be 0, as it is
+		 * in every column of the table.
+		 */
+		void fill(const column_type& prev_column, column_type& cur_column,
+				  witness_vector_type& witness_vector, size_type column, value_type mass);
+
+		/**
+		 * Same as fill(), but follows the rounds residue by residue.
+		 */
+		static void fillSequentially(const column_type& prev_column, column_type& cur_column,
+				  witness_vector_type& witness_vector, size_type column, value_type mass);
+
+		/**
+		 * Fills @c cur_column for the alphabet mass @c mass at @c column,
+		 * if the previous column is infinity everywhere except residue 0:
+		 * residues reached from 0 get the multiples of @c mass, other
+		 * entries are left unchanged. This is the column of the second
+		 * alphabet mass.
+		 */
+		static void fillMultiples(column_type& cur_column, witness_vector_type& witness_vector,
+				  size_type column, value_type mass);
+
+		/**
+		 * Default number of residues per step: they span two pages, while
+		 * the state of the lanes stays in the first level cache.
+		 */
+		static const size_type DEFAULT_LANES = 1024;
+
+		/**
+		 * Default size of the smallest column filled in lanes. Smaller
+		 * columns fit into the cache, where the rounds are faster.
+		 */
+		static const size_type DEFAULT_MIN_COLUMN_SIZE = 131072;
+
+		/**
+		 * Lanes are at least this long on average.
+		 */
+		static const size_type MIN_LANE_LENGTH = 64;
+
+	private:
+		/**
+		 * Gets the inverse of @c value modulo @c modulus, which are coprime.
+		 */
+		static size_type getInverse(size_type value, size_type modulus);
+
+		/**
+		 * Gets the residue of class @c residue_class the round of which starts
+		 * there, the smallest entry of @c prev_column in the class.
+		 */
+		static size_type getRoundStart(const column_type& prev_column,
+									   size_type residue_class, size_type classes);
+
+		size_type max_lanes;
+		size_type min_column_size;
+		// masses and counters of the classes of every lane after its last step
+		column_type lane_masses;
+		std::vector<decomposition_value_type> lane_counters;
+		// lengths of the lanes
+		std::vector<size_type> lane_lengths;
+		// lanes still running
+		std::vector<size_type> running;
+		// different lengths of the lanes
+		std::vector<size_type> ends;
+		// (index in the round, lane) of the lane starts
+		std::vector< std::pair<size_type, size_type> > starts;
+};
+
+
+template <typename ValueType, typename DecompositionValueType>
+typename ResidueColumnFiller<ValueType, DecompositionValueType>::size_type
+ResidueColumnFiller<ValueType, DecompositionValueType>::getInverse(
+		size_type value, size_type modulus) {
+	long long u1, u2;
+	long long m = static_cast<long long>(modulus);
+	gcd(static_cast<long long>(value), m, u1, u2);
+	return static_cast<size_type>((u1 % m + m) % m);
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+typename ResidueColumnFiller<ValueType, DecompositionValueType>::size_type
+ResidueColumnFiller<ValueType, DecompositionValueType>::getRoundStart(
+		const column_type& prev_column, size_type residue_class, size_type classes) {
+	if (residue_class == 0) {
+		return 0;
+	}
+	size_type start = residue_class;
+	for (size_type p = residue_class + classes; p < prev_column.size(); p += classes) {
+		if (prev_column[p] < prev_column[start]) {
+			start = p;
+		}
+	}
+	return start;
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void ResidueColumnFiller<ValueType, DecompositionValueType>::fillSequentially(
+		const column_type& prev_column, column_type& cur_column,
+		witness_vector_type& witness_vector, size_type column, value_type mass) {
+
+	size_type size = prev_column.size();
+	// p_inc is used to change residue (p) efficiently
+	size_type p_inc = mass % size;
+	size_type classes = gcd(size, p_inc);
+
+	for (size_type r = 0; r < classes; ++r) {
+		// current residue (in paper variable 'r' is used)
+		size_type p = getRoundStart(prev_column, r, classes);
+		// n is the value that will be written into the table
+		value_type n = prev_column[p];
+		// counter for creation of witness vector
+		decomposition_value_type counter = 0;
+
+		cur_column[p] = n;
+		for (size_type m = size / classes - 1; m > 0; --m) {
+			n += mass;
+			p += p_inc;
+			++counter;
+			if (p >= size) {
+				p -= size;
+			}
+			if (n > prev_column[p]) {
+				n = prev_column[p];
+				counter = 0;
+			} else {
+				witness_vector[p] = std::make_pair(column, counter);
+			}
+			cur_column[p] = n;
+		}
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void ResidueColumnFiller<ValueType, DecompositionValueType>::fillMultiples(
+		column_type& cur_column, witness_vector_type& witness_vector,
+		size_type column, value_type mass) {
+
+	size_type size = cur_column.size();
+	size_type p_inc = mass % size;
+	size_type classes = gcd(size, p_inc), blocks = size / classes;
+	if (blocks == 1) {
+		return;
+	}
+	// residue q * classes is reached from 0 by adding mass q * inverse times
+	size_type inverse = getInverse(p_inc / classes, blocks), times = 0;
+	for (size_type p = classes; p < size; p += classes) {
+		times += inverse;
+		if (times >= blocks) {
+			times -= blocks;
+		}
+		cur_column[p] = static_cast<value_type>(times) * mass;
+		witness_vector[p] = std::make_pair(column,
+			static_cast<decomposition_value_type>(times));
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+void ResidueColumnFiller<ValueType, DecompositionValueType>::fill(
+		const column_type& prev_column, column_type& cur_column,
+		witness_vector_type& witness_vector, size_type column, value_type mass) {
+
+	size_type size = prev_column.size();
+	size_type p_inc = mass % size;
+	size_type classes = gcd(size, p_inc);
+	// the rounds step through blocks of one residue of every class
+	size_type blocks = size / classes, block_inc = p_inc / classes;
+	size_type lanes = std::min(max_lanes / classes, blocks / MIN_LANE_LENGTH);
+	if (size < min_column_size || lanes < 2) {
+		fillSequentially(prev_column, cur_column, witness_vector, column, mass);
+		return;
+	}
+
+	// the lane starting at block j starts at j * inverse in the rounds
+	size_type inverse = getInverse(block_inc, blocks);
+
+	starts.resize(lanes);
+	size_type start = 0;
+	for (size_type j = 0; j < lanes; ++j) {
+		starts[j] = std::make_pair(start, j);
+		start += inverse;
+		if (start >= blocks) {
+			start -= blocks;
+		}
+	}
+	std::sort(starts.begin(), starts.end());
+
+	// a lane ends where the next one starts, the last one ends with the round
+	lane_lengths.resize(lanes);
+	for (size_type s = 0; s < lanes; ++s) {
+		size_type end = s + 1 < lanes ? starts[s + 1].first : blocks;
+		lane_lengths[starts[s].second] = end - starts[s].first;
+	}
+	ends.assign(lane_lengths.begin(), lane_lengths.end());
+	std::sort(ends.begin(), ends.end());
+	ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+
+	// first step: every lane restarts the recurrence at its residues
+	lane_masses.resize(lanes * classes);
+	lane_counters.assign(lanes * classes, 0);
+	running.resize(lanes);
+	for (size_type p = 0; p < lanes * classes; ++p) {
+		lane_masses[p] = cur_column[p] = prev_column[p];
+	}
+	for (size_type j = 0; j < lanes; ++j) {
+		running[j] = j;
+	}
+
+	// remaining steps, the lanes visiting residues [offset, offset + lanes * classes)
+	size_type offset = 0;
+	typename std::vector<size_type>::const_iterator end = ends.begin();
+	for (size_type step = 1; step < ends.back(); ++step) {
+		offset += p_inc;
+		if (offset >= size) {
+			offset -= size;
+		}
+		if (step == *end) {
+			// drops the lanes that have ended
+			size_type kept = 0;
+			for (size_type r = 0; r < running.size(); ++r) {
+				if (lane_lengths[running[r]] > step) {
+					running[kept++] = running[r];
+				}
+			}
+			running.resize(kept);
+			++end;
+		}
+		for (size_type l = 0; l < running.size(); ++l) {
+			size_type lane = running[l] * classes;
+			size_type p = lane + offset;
+			if (p >= size) {
+				p -= size;
+			}
+			for (size_type r = 0; r < classes; ++r, ++p) {
+				value_type n = lane_masses[lane + r] + mass;
+				decomposition_value_type counter = lane_counters[lane + r] + 1;
+				if (n > prev_column[p]) {
+					n = prev_column[p];
+					counter = 0;
+				} else {
+					witness_vector[p] = std::make_pair(column, counter);
+				}
+				cur_column[p] = lane_masses[lane + r] = n;
+				lane_counters[lane + r] = counter;
+			}
+		}
+	}
+
+	// carries the end of every lane into the next one, round by round
+	for (size_type r = 0; r < classes; ++r) {
+		// the lane of the round's start is finished from there on
+		size_type round_start = getRoundStart(prev_column, r, classes) / classes;
+		size_type first = static_cast<size_type>(std::upper_bound(starts.begin(), starts.end(),
+			std::make_pair(round_start * inverse % blocks, lanes)) - starts.begin()) - 1;
+		value_type n = lane_masses[starts[first].second * classes + r];
+		decomposition_value_type counter = lane_counters[starts[first].second * classes + r];
+
+		// the lanes up to the one of the round's start again
+		for (size_type s = first + 1; s <= first + lanes; ++s) {
+			size_type j = starts[s % lanes].second, length = lane_lengths[j];
+			size_type p = j * classes + r, step = 0;
+			for (; step < length; ++step) {
+				n += mass;
+				++counter;
+				if (n > cur_column[p]) {
+					break;
+				}
+				cur_column[p] = n;
+				witness_vector[p] = std::make_pair(column, counter);
+				p += p_inc;
+				if (p >= size) {
+					p -= size;
+				}
+			}
+			if (step < length) {
+				// the lane's own recurrence is smaller from here on
+				n = lane_masses[j * classes + r];
+				counter = lane_counters[j * classes + r];
+			}
+		}
+	}
+}
+
+
+template <typename ValueType, typename DecompositionValueType>
+const typename ResidueColumnFiller<ValueType, DecompositionValueType>::size_type
+ResidueColumnFiller<ValueType, DecompositionValueType>::DEFAULT_LANES;
+
+template <typename ValueType, typename DecompositionValueType>
+const typename ResidueColumnFiller<ValueType, DecompositionValueType>::size_type
+ResidueColumnFiller<ValueType, DecompositionValueType>::DEFAULT_MIN_COLUMN_SIZE;
+
+template <typename ValueType, typename DecompositionValueType>
+const typename ResidueColumnFiller<ValueType, DecompositionValueType>::size_type
+ResidueColumnFiller<ValueType, DecompositionValueType>::MIN_LANE_LENGTH;
+
+} // namespace ims
+
+#endif // IMS_RESIDUECOLUMNFILLER_H
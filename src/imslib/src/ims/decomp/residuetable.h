@@ -1,8 +1,100 @@
 #ifndef IMS_RESIDUETABLE_H
 #define IMS_RESIDUETABLE_H
 
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <ims/weights.h>
+#include <ims/utils/gcd.h>
+#include <ims/decomp/residuecolumnfiller.h>
+
 namespace ims {
 
+/**
+ * @brief Extended residue table stored as one vector of masses per column.
+ *
+ * Layout for ResidueTable::fill() over a table of type @c table_type,
+ * as used by FastIntegerMassDecomposer and the two mass decomposers.
+ * Columns are indexed as <tt>table[column][residue]</tt>.
+ *
+ * @param ValueType Type of masses.
+ *
+ * @see CompactResidueTable
+ *
+ * @ingroup decomp
+ */
+template <typename ValueType>
+class ResidueColumns {
+	public:
+		typedef ValueType value_type;
+
+		/**
+		 * Type of a column with masses.
+		 */
+		typedef std::vector<value_type> column_type;
+
+		/**
+		 * Type of the table, a vector of columns.
+		 */
+		typedef std::vector<column_type> table_type;
+
+		typedef typename table_type::size_type size_type;
+
+		/**
+		 * Creates a layout that stores the columns in @c table.
+		 */
+		explicit ResidueColumns(table_type& table) : table(table) {}
+
+		/**
+		 * Clears the table and prepares it for @c number_of_columns columns.
+		 */
+		void reset(value_type /* smallest_mass */, value_type /* infty */,
+				   size_type number_of_columns) {
+			table.clear();
+			table.reserve(number_of_columns);
+		}
+
+		/**
+		 * Appends @c column, which has one mass per residue.
+		 */
+		void appendColumn(const column_type& column) {
+			table.push_back(column);
+		}
+
+		/**
+		 * Appends a copy of the last column.
+		 */
+		void repeatColumn() {
+			table.push_back(table.back());
+		}
+
+	private:
+		table_type& table;
+};
+
+
+/**
+ * @brief Builds the extended residue table of an alphabet.
+ *
+ * The table holds for every alphabet mass i and every residue r modulo the
+ * smallest alphabet mass the smallest mass with residue r that is
+ * decomposable over the alphabet masses 0 to i. It is filled column by
+ * column, see ResidueColumnFiller, and handed to a layout that stores the
+ * columns. fill() is the single implementation used by all decomposers
+ * built on the table, whatever their layout is:
+ * - ResidueColumns keeps a vector of masses per column,
+ * - CompactResidueTable keeps small entries in a single buffer, which
+ *   may also be read from a memory-mapped file.
+ *
+ * A layout provides the members of ResidueColumns:
+ * <tt>reset(smallest_mass, infty, number_of_columns)</tt>,
+ * <tt>appendColumn(column)</tt> and <tt>repeatColumn()</tt>.
+ *
+ * @param ValueType Type of masses.
+ * @param DecompositionValueType Type of decomposition elements.
+ *
+ * @ingroup decomp
+ */
 template <typename ValueType, typename DecompositionValueType>
 class ResidueTable {
 	public:
@@ -18,7 +110,7 @@ class ResidueTable {
 		typedef std::vector<decomposition_type> decompositions_type;
 
 		typedef std::vector< std::pair<size_type, decomposition_value_type> > witness_vector_type;
-		
+
 		/** Type of rows of residues table. */
 		typedef std::vector<value_type> row_type;
 
@@ -40,16 +132,27 @@ class ResidueTable {
 					row_type& mass_in_lcms,
 					table_type& table);
 
-		
+
 		value_type infinity() const { return infty; }
 
-	private:
-		void fill(
+		/**
+		 * Fills @c table with the extended residue table of @c weights,
+		 * @c infty standing for "no decomposable mass". Also fills the
+		 * caches @c lcms and @c mass_in_lcms, which have one entry per
+		 * alphabet mass, and @c witness_vector.
+		 *
+		 * @param LayoutType Type storing the columns, see above.
+		 */
+		template <typename LayoutType>
+		static void fill(
 			const Weights& weights,
+			value_type infty,
 			row_type& lcms,
 			row_type& mass_in_lcms,
-			table_type& table);
+			witness_vector_type& witness_vector,
+			LayoutType& table);
 
+	private:
 		value_type infty;
 
 		/**
@@ -71,65 +174,59 @@ ResidueTable<ValueType,DecompositionValueType>::ResidueTable(
 {
 	assert(weights.size() > 0);
 	infty = weights[0] * weights.back();
-	fill(weights, lcms, mass_in_lcms, table);
+	ResidueColumns<value_type> columns(table);
+	fill(weights, infty, lcms, mass_in_lcms, witness_vector, columns);
 }
 
 template <typename ValueType, typename DecompositionValueType>
+template <typename LayoutType>
 void ResidueTable<ValueType,DecompositionValueType>::fill(
 		const Weights& weights,
+		value_type infty,
 		row_type& lcms,
 		row_type& mass_in_lcms,
-		table_type& table
+		witness_vector_type& witness_vector,
+		LayoutType& table
 )
 {
-	if (weights.size() < 2) {
-		return;
-	}
 	// cache the most often used mass - smallest mass
 	value_type smallestMass = weights.getWeight(0);
-	value_type secondMass = weights.getWeight(1);
 
-	// initialize table: infinity everywhere except in the first field of every column
-	table.reserve(weights.size());
-	table.assign(weights.size(), std::vector<value_type>(smallestMass, infty));
+	// only the previous and the current column are kept here, finished
+	// columns are handed to the layout.
+	// initialize columns: infinity everywhere except in the first field
+	table.reset(smallestMass, infty, weights.size());
+	row_type prev_column, cur_column(smallestMass, infty);
+	cur_column[0] = 0;
+	table.appendColumn(cur_column);
 
-	for (size_type i = 0; i < weights.size(); ++i) {
-		table[i][0] = 0;
+	if (weights.size() < 2) {
+		return;
 	}
+	value_type secondMass = weights.getWeight(1);
 
 	// initialize witness vector
 	witness_vector.reserve(smallestMass);
 	witness_vector.resize(smallestMass);
 
 	// fill second column (the first one is already correct)
-	size_type it_inc = secondMass % smallestMass, witness = 1;
-	typename row_type::iterator it = table[1].begin() + it_inc;
-	value_type mass = secondMass;
-	// counter for creation one witness vector
-	decomposition_value_type counter = 0;
-	while (it != table[1].begin()) {
-		*it = mass;
-		mass += secondMass;
-		++counter;
-		witness_vector[it - table[1].begin()] = std::make_pair(witness, counter);
-		it += it_inc;
-		if (it >= table[1].end()) {
-			it -= table[1].size();
-		}
-	}
+	ResidueColumnFiller<value_type, decomposition_value_type>::fillMultiples(
+		cur_column, witness_vector, 1, secondMass);
+	table.appendColumn(cur_column);
 	// fill cache variables for i==1
 	value_type d = gcd(smallestMass, secondMass);
 	lcms[1] = secondMass*smallestMass / d;
 	mass_in_lcms[1] = smallestMass / d;
 
+	// fills the columns from the previous ones
+	ResidueColumnFiller<value_type, decomposition_value_type> filler;
+
 	// fill remaining table. i is the column index.
 	for (size_type i = 2; i < weights.size(); ++i) {
 		// cache often used i-th alphabet mass
 		value_type currentMass = weights.getWeight(i);
-//		std::cout << "Current alphabet mass = " << currentMass << std::endl;
 
 		value_type d = gcd(smallestMass, currentMass);
-//		std::cout << "gcd = " << d << std::endl;
 
 		// Fill cache for various variables.
 		// Note that values for i==0 are never assigned since they're unused anyway.
@@ -137,117 +234,20 @@ void ResidueTable<ValueType,DecompositionValueType>::fill(
 		mass_in_lcms[i] = smallestMass / d;
 
 		// Nijenhuis' improvement: Is currentMass composable with smaller alphabet?
-		if (currentMass >= table[i-1][currentMass % smallestMass]) {
-//			std::cout << "Nijenhuis improvement: current alphabet mass is bigger than " << table.at(i-1).at(currentMass % smallestMass) << std::endl;
-			table[i] = table[i-1];
+		// cur_column still holds column i-1 here
+		if (currentMass >= cur_column[currentMass % smallestMass]) {
+			table.repeatColumn();
 			continue;
 		}
 
-		const row_type& prev_column = table[i-1];
-		row_type& cur_column = table[i];
-
-		if (d == 1) {
-			// This loop is for the case that the gcd is 1. The optimization used below
-			// is not applicable here.
-
-			// p_inc (as i understood) is used to change residue (p) efficiently
-			size_type p_inc = currentMass % smallestMass;
-//			std::cout << "p_inc = " << p_inc << std::endl;
-
-			// n is the value that will be written into the table
-			value_type n = 0;
-			// current residue (in paper variable 'r' is used)
-			size_type p = 0;
-			// counter for creation one witness vector
-			decomposition_value_type counter = 0;
-
-			for (size_type m = smallestMass; m > 0; --m) {
-				n += currentMass;
-				p += p_inc;
-				++counter;
-				if (p >= smallestMass) {
-					p -= smallestMass;
-				}
-				if (n > prev_column[p]) {
-					n = prev_column[p];
-					counter = 0;
-				} else {
-					witness_vector[p] = std::make_pair(i, counter);
-				}
-				cur_column[p] = n;
-			}
-		}
-		else {
-			// If we're here, the gcd is not 1. We can use the following cache-optimized
-			// version of the algorithm. The trick is to put the iteration over all
-			// residue classes into the _inner_ loop.
-			//
-			// One could see it as going through one column in blocks which are gcd entries long.
-			size_type cur = currentMass % smallestMass;
-			size_type prev = 0;
-			size_type p_inc = cur-d;
-			// counters for creation one witness vector
-			std::vector<decomposition_value_type> counters(smallestMass);
-
-			// copy first block from prev_column to cur_column
-			for (size_type j = 1; j < d; ++j) {
-				cur_column[j] = prev_column[j];
-			}
-
-			// first loop: Go through all blocks, updating cur_column for the first time.
-			for (size_type m = smallestMass / d; m > 1; m--) {
-				// r: current residue class
-				for (size_type r = 0; r < d; r++) {
-
-					++counters[cur];
-					if (cur_column[prev] + currentMass > prev_column[cur]) {
-						cur_column[cur] = prev_column[cur];
-						counters[cur] = 0;
-					} else {
-						cur_column[cur] = cur_column[prev] + currentMass;
-						witness_vector[cur] = std::make_pair(i, counters[cur]);
-					}
-
-					prev++;
-					cur++;
-				}
-
-				prev = cur - d;
-
-				// this does: cur = (cur + currentMass) % smallestMass - d;
-				cur += p_inc;
-				if (cur >= smallestMass) {
-					cur -= smallestMass;
-				}
-			}
-
-			// second loop:
-			bool cont = true;
-			while (cont) {
-				cont = false;
-				prev++;
-				cur++;
-				++counters[cur];
-				for (size_type r = 1; r < d; ++r) {
-					if (cur_column[prev] + currentMass < cur_column[cur]) {
-						cur_column[cur] = cur_column[prev] + currentMass;
-						cont = true;
-						witness_vector[cur] = std::make_pair(i, counters[cur]);
-					} else {
-						counters[cur] = 0;
-					}
-					prev++;
-					cur++;
-				}
-
-				prev = cur - d;
-
-				cur += p_inc;
-				if (cur >= smallestMass) {
-					cur -= smallestMass;
-				}
-			}
-		}
+		prev_column.swap(cur_column);
+		// every residue is written
+		cur_column.resize(smallestMass);
+
+		// fills the column round by round, see ResidueColumnFiller
+		filler.fill(prev_column, cur_column, witness_vector, i, currentMass);
+
+		table.appendColumn(cur_column);
 	}
 }
 
@@ -0,0 +1,138 @@
+#include <ims/decomp/residuetableformat.h>
+
+#include <sstream>
+#include <iomanip>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+namespace ims {
+
+void ResidueTableFormat::Writer::writeBytes(const void* bytes, std::size_t size) {
+	if (!os.write(static_cast<const char*>(bytes), size)) {
+		throw IOException("unable to write residue table");
+	}
+	position += size;
+}
+
+
+void ResidueTableFormat::Writer::pad(std::size_t alignment) {
+	const char zero = 0;
+	while (position % alignment != 0) {
+		writeBytes(&zero, 1);
+	}
+}
+
+
+const char* ResidueTableFormat::Reader::readBytes(std::size_t size) {
+	if (size > file.size() - position) {
+		throw IOException("residue table file is truncated");
+	}
+	const char* bytes = file.data() + position;
+	position += size;
+	return bytes;
+}
+
+
+void ResidueTableFormat::Reader::pad(std::size_t alignment) {
+	std::size_t padding = (alignment - position % alignment) % alignment;
+	readBytes(padding);
+}
+
+
+void ResidueTableFormat::writeHeader(Writer& writer, const Weights& weights) {
+	writer.writeBytes(getMagic(), 8);
+	writer.writeInteger(getByteOrderMark());
+	writer.writeInteger(getVersion());
+	writer.writeInteger(getKey(weights));
+	writer.writeDouble(weights.getPrecision());
+	writer.writeInteger(weights.size());
+	for (Weights::size_type i = 0; i < weights.size(); ++i) {
+		writer.writeInteger(weights.getWeight(i));
+	}
+}
+
+
+void ResidueTableFormat::readHeader(Reader& reader, const Weights& weights) {
+	if (std::memcmp(reader.readBytes(8), getMagic(), 8) != 0) {
+		throw IOException("not a residue table file");
+	}
+	if (reader.readInteger() != getByteOrderMark()) {
+		throw IOException("residue table file was written with a different byte order");
+	}
+	if (reader.readInteger() != getVersion()) {
+		throw IOException("residue table file has an unsupported version");
+	}
+	bool matches = reader.readInteger() == getKey(weights);
+	matches = reader.readDouble() == weights.getPrecision() && matches;
+	matches = reader.readInteger() == weights.size() && matches;
+	for (Weights::size_type i = 0; matches && i < weights.size(); ++i) {
+		matches = reader.readInteger() == static_cast<integer_type>(weights.getWeight(i));
+	}
+	if (!matches) {
+		throw IOException("residue table file was written for other weights");
+	}
+}
+
+
+ResidueTableFormat::integer_type ResidueTableFormat::getKey(const Weights& weights) {
+	// 64-bit FNV-1a over the precision and the integer weights
+	integer_type hash = 14695981039346656037ULL;
+	std::vector<integer_type> values;
+	integer_type precision_bits;
+	double precision = weights.getPrecision();
+	std::memcpy(&precision_bits, &precision, sizeof(precision_bits));
+	values.push_back(precision_bits);
+	for (Weights::size_type i = 0; i < weights.size(); ++i) {
+		values.push_back(weights.getWeight(i));
+	}
+	for (std::vector<integer_type>::size_type i = 0; i < values.size(); ++i) {
+		for (unsigned int byte = 0; byte < sizeof(integer_type); ++byte) {
+			hash ^= (values[i] >> (8 * byte)) & 0xff;
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+
+std::string ResidueTableFormat::getFileName(const Weights& weights) {
+	std::ostringstream name;
+	name << "residues-" << std::hex << std::setw(16) << std::setfill('0')
+		 << getKey(weights) << ".ims";
+	return name.str();
+}
+
+
+
+std::string ResidueTableFormat::getPath(const Weights& weights, const std::string& directory) {
+	if (directory.empty()) {
+		return getFileName(weights);
+	}
+	char last = directory[directory.size() - 1];
+	return (last == '/' || last == '\\') ? directory + getFileName(weights) :
+		directory + "/" + getFileName(weights);
+}
+
+
+std::string ResidueTableFormat::getTemporaryPath(const std::string& path) {
+	std::ostringstream temporary_path;
+#ifndef _WIN32
+	temporary_path << path << ".tmp" << getpid();
+#else
+	temporary_path << path << ".tmp" << _getpid();
+#endif
+	return temporary_path.str();
+}
+
+
+void ResidueTableFormat::install(const std::string& temporary_path, const std::string& path) {
+	if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+		std::remove(temporary_path.c_str());
+	}
+}
+
+} // namespace ims
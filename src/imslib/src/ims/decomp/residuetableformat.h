@@ -0,0 +1,221 @@
+#ifndef IMS_RESIDUETABLEFORMAT_H
+#define IMS_RESIDUETABLEFORMAT_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+
+#include <ims/weights.h>
+#include <ims/utils/mappedfile.h>
+#include <ims/base/exception/ioexception.h>
+
+namespace ims {
+
+/**
+ * @brief Binary on-disk format of precomputed residue tables.
+ *
+ * A file holds the state an integer mass decomposer builds in its
+ * constructor: integer weights and precision, the lcms, the witness vector
+ * and the extended residue table with the range minimum index of its
+ * columns. Both are aligned to a cache line in the file, so they can be
+ * used in place when the file is memory-mapped (see MappedFile).
+ *
+ * Integers are written as 64-bit and floating point numbers as
+ * @c double, both in the byte order of the writing machine, which is
+ * checked when reading. Files are keyed by a hash of the integer weights
+ * and the precision, see getKey() and getFileName().
+ *
+ * @see IntegerMassDecomposer::save()
+ *
+ * @ingroup decomp
+ */
+class ResidueTableFormat {
+	public:
+		/**
+		 * Type of integers in the file.
+		 */
+		typedef unsigned long long integer_type;
+
+		/**
+		 * Writes values to a stream, keeping track of the position.
+		 */
+		class Writer {
+			public:
+				explicit Writer(std::ostream& os) : os(os), position(0) {}
+
+				void writeInteger(integer_type value) {
+					writeBytes(&value, sizeof(value));
+				}
+
+				void writeDouble(double value) {
+					writeBytes(&value, sizeof(value));
+				}
+
+				void writeBytes(const void* bytes, std::size_t size);
+
+				/**
+				 * Writes zeros up to the next multiple of @c alignment.
+				 */
+				void pad(std::size_t alignment);
+
+			private:
+				std::ostream& os;
+				std::size_t position;
+		};
+
+		/**
+		 * Reads values from the contents of a mapped file.
+		 */
+		class Reader {
+			public:
+				explicit Reader(const MappedFile& file) :
+					file(file), position(0) {}
+
+				integer_type readInteger() {
+					integer_type value;
+					std::memcpy(&value, readBytes(sizeof(value)), sizeof(value));
+					return value;
+				}
+
+				double readDouble() {
+					double value;
+					std::memcpy(&value, readBytes(sizeof(value)), sizeof(value));
+					return value;
+				}
+
+				/**
+				 * Gets the next @c size bytes in place and skips them.
+				 *
+				 * @throw IOException if the file is too short.
+				 */
+				const char* readBytes(std::size_t size);
+
+				/**
+				 * Skips up to the next multiple of @c alignment.
+				 */
+				void pad(std::size_t alignment);
+
+				/**
+				 * Gets the file read from.
+				 */
+				const MappedFile& getFile() const { return file; }
+
+			private:
+				MappedFile file;
+				std::size_t position;
+		};
+
+		/**
+		 * Gets the version of the format written.
+		 */
+		static integer_type getVersion() { return 2; }
+
+		/**
+		 * Gets the alignment of the residue table in the file.
+		 */
+		static std::size_t getAlignment() { return 64; }
+
+		/**
+		 * Writes the file header for @c weights.
+		 */
+		static void writeHeader(Writer& writer, const Weights& weights);
+
+		/**
+		 * Reads the file header and checks that it was written for
+		 * @c weights by a compatible machine.
+		 *
+		 * @throw IOException otherwise.
+		 */
+		static void readHeader(Reader& reader, const Weights& weights);
+
+		/**
+		 * Gets the key of files for @c weights, a hash of the integer
+		 * weights and the precision.
+		 */
+		static integer_type getKey(const Weights& weights);
+
+		/**
+		 * Gets the name of the file for @c weights, made of its key.
+		 */
+		static std::string getFileName(const Weights& weights);
+
+		/**
+		 * Gets a decomposer for @c weights, reading it from the file 
+		 * getFileName() in @c directory. If the file doesn't exist or can't
+		 * be read, the decomposer is built and the file written, so the 
+		 * next call (e.g. by another process) maps it. Files are written 
+		 * under a temporary name and renamed, so readers never see partial
+		 * files.
+		 *
+		 * @param DecomposerType Integer decomposer with a constructor 
+		 * taking a MappedFile and save(), like IntegerMassDecomposer.
+		 * @return The new decomposer, to be deleted by the caller.
+		 */
+		template <typename DecomposerType>
+		static DecomposerType* createDecomposer(const Weights& weights, 
+												const std::string& directory);
+
+	private:
+		/**
+		 * Gets the path of the file for @c weights in @c directory.
+		 */
+		static std::string getPath(const Weights& weights, const std::string& directory);
+
+		/**
+		 * Gets a temporary file name next to @c path, unique to this process.
+		 */
+		static std::string getTemporaryPath(const std::string& path);
+
+		/**
+		 * Renames the file @c temporary_path to @c path, or removes it
+		 * if that fails (e.g. another process installed the file first).
+		 */
+		static void install(const std::string& temporary_path, const std::string& path);
+
+		static const char* getMagic() { return "IMSRESTB"; }
+
+		static integer_type getByteOrderMark() { return 0x0102030405060708ULL; }
+};
+
+
+template <typename DecomposerType>
+DecomposerType* ResidueTableFormat::createDecomposer(const Weights& weights,
+		const std::string& directory) {
+	std::string path = getPath(weights, directory);
+	try {
+		MappedFile file(path);
+		return new DecomposerType(weights, file);
+	} catch (IOException&) {
+		// no usable file, builds the decomposer and writes one
+	}
+	DecomposerType* decomposer = new DecomposerType(weights);
+	try {
+		std::string temporary_path = getTemporaryPath(path);
+		std::ofstream ofs(temporary_path.c_str(), std::ios::out | std::ios::binary);
+		if (ofs) {
+			try {
+				decomposer->save(ofs);
+			} catch (IOException&) {
+				// the decomposer is usable anyway
+			}
+			ofs.close();
+			if (ofs) {
+				install(temporary_path, path);
+			} else {
+				std::remove(temporary_path.c_str());
+			}
+		}
+	} catch (...) {
+		delete decomposer;
+		throw;
+	}
+	return decomposer;
+}
+
+} // namespace ims
+
+#endif // IMS_RESIDUETABLEFORMAT_H
@@ -163,7 +163,7 @@ class Element {
 		    IsotopeDistribution::abundance_type maxval=-FLT_MAX;
 		    int maxindex=0;
 		    
-		    for (int i=0; i < IsotopeDistribution::SIZE; i++) {
+		    for (IsotopeDistribution::size_type i=0; i < isotopes.size(); i++) {
 /* 		      std::cerr << "Abundance is " << isotopes.getAbundance(i) << std::endl; */
 		      
 		      if (isotopes.getAbundance(i) > 0.5) { 
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <ims/fineisotopedistribution.h>
+
+namespace ims {
+
+namespace {
+
+bool lessMass(const FineIsotopeDistribution::peak_type& p1,
+			  const FineIsotopeDistribution::peak_type& p2) {
+	return p1.mass < p2.mass;
+}
+
+} // namespace
+
+
+const FineIsotopeDistribution::mass_type
+FineIsotopeDistribution::DEFAULT_RESOLUTION = 1e-6;
+
+const FineIsotopeDistribution::abundance_type
+FineIsotopeDistribution::DEFAULT_THRESHOLD = 1e-9;
+
+
+FineIsotopeDistribution::FineIsotopeDistribution(
+		const IsotopeDistribution& distribution,
+		mass_type resolution, abundance_type threshold) :
+	resolution(resolution), threshold(threshold) {
+	for (IsotopeDistribution::size_type i = 0; i < distribution.size(); ++i) {
+		if (distribution.getAbundance(i) > 0.0) {
+			peaks.push_back(peak_type(distribution.getMass(i),
+									  distribution.getAbundance(i)));
+		}
+	}
+	merge();
+}
+
+
+FineIsotopeDistribution& FineIsotopeDistribution::operator *=(
+		const FineIsotopeDistribution& distribution) {
+	if (distribution.empty()) {
+		return *this;
+	}
+	if (this->empty()) {
+		peaks = distribution.peaks;
+		merge();
+		return *this;
+	}
+	peaks_container products;
+	products.reserve(peaks.size() * distribution.size());
+	for (size_type i = 0; i < peaks.size(); ++i) {
+		for (size_type j = 0; j < distribution.size(); ++j) {
+			abundance_type abundance = peaks[i].abundance *
+									   distribution.peaks[j].abundance;
+			// drops products as they are made, most of them being tiny
+			if (abundance >= threshold) {
+				products.push_back(peak_type(peaks[i].mass +
+											 distribution.peaks[j].mass,
+											 abundance));
+			}
+		}
+	}
+	peaks.swap(products);
+	merge();
+	return *this;
+}
+
+
+/**
+ * Folds the distribution with itself @c power times. Implements the
+ * Russian Multiplication Scheme as IsotopeDistribution does, so it takes
+ * about 2 log(power) foldings.
+ */
+FineIsotopeDistribution& FineIsotopeDistribution::operator *=(unsigned int power) {
+	if (power <= 1) {
+		return *this;
+	}
+	FineIsotopeDistribution this_power_two_index(*this);
+	FineIsotopeDistribution result(resolution, threshold);
+	for (;;) {
+		if (power & 1) {
+			result *= this_power_two_index;
+		}
+		power >>= 1;
+		if (power == 0) {
+			break;
+		}
+		this_power_two_index *= this_power_two_index;
+	}
+	peaks.swap(result.peaks);
+	return *this;
+}
+
+
+void FineIsotopeDistribution::merge() {
+	if (peaks.empty()) {
+		return;
+	}
+	std::sort(peaks.begin(), peaks.end(), lessMass);
+	size_type last = 0;
+	for (size_type i = 1; i < peaks.size(); ++i) {
+		peak_type& merged = peaks[last];
+		if (peaks[i].mass - merged.mass <= resolution) {
+			abundance_type abundance = merged.abundance + peaks[i].abundance;
+			if (abundance > 0.0) {
+				merged.mass = (merged.mass * merged.abundance +
+							   peaks[i].mass * peaks[i].abundance) / abundance;
+			}
+			merged.abundance = abundance;
+		} else {
+			peaks[++last] = peaks[i];
+		}
+	}
+	peaks.resize(last + 1);
+}
+
+
+FineIsotopeDistribution::masses_container
+FineIsotopeDistribution::getMasses() const {
+	masses_container masses;
+	for (size_type i = 0; i < size(); ++i) {
+		masses.push_back(getMass(i));
+	}
+	return masses;
+}
+
+
+FineIsotopeDistribution::abundances_container
+FineIsotopeDistribution::getAbundances() const {
+	abundances_container abundances;
+	for (size_type i = 0; i < size(); ++i) {
+		abundances.push_back(getAbundance(i));
+	}
+	return abundances;
+}
+
+
+FineIsotopeDistribution::abundance_type
+FineIsotopeDistribution::getAbundancesSum() const {
+	abundance_type sum = 0.0;
+	for (size_type i = 0; i < size(); ++i) {
+		sum += getAbundance(i);
+	}
+	return sum;
+}
+
+
+std::ostream& operator <<(std::ostream& os,
+						  const FineIsotopeDistribution& distribution) {
+	for (FineIsotopeDistribution::size_type i = 0; i < distribution.size(); ++i) {
+		os << distribution.getMass(i) << ' '
+		   << distribution.getAbundance(i) << '\n';
+	}
+	return os;
+}
+
+} // namespace ims
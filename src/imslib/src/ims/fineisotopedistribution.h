@@ -0,0 +1,169 @@
+#ifndef IMS_FINE_ISOTOPE_DISTRIBUTION_H
+#define IMS_FINE_ISOTOPE_DISTRIBUTION_H
+
+#include <vector>
+#include <ostream>
+#include <ims/isotopedistribution.h>
+
+namespace ims {
+
+/**
+ * @brief Represents the fine structure of an isotope distribution, with
+ * peaks closer than a resolution merged and improbable peaks pruned.
+ *
+ * Unlike @c IsotopeDistribution, which has one peak per nominal mass,
+ * isotopologues of the same nominal mass are kept apart if their masses
+ * differ by more than the resolution, e.g. for C2H6NS (76.0221; 92.50 %)
+ * the M+1 peak splits into
+ * 		(77.0191; 0.34 %)	15N
+ * 		(77.0215; 0.74 %)	33S
+ * 		(77.0255; 2.00 %)	13C
+ * 		(77.0284; 0.06 %)	2H
+ * and M+2 (78.0179; 4.18 %) of 34S from 13C2 and others, which resolve
+ * on high-resolution instruments.
+ * Unlike @c IsotopeSpecies, which enumerates every isotopologue, the
+ * number of peaks is bounded by pruning and merging:
+ * - folding drops every product of two peaks whose abundance is below the
+ *   threshold, so the abundances may sum up to a bit less than 1,
+ * - peaks whose masses differ by at most the resolution are merged into
+ *   one peak at their abundance-weighted mass.
+ *
+ * A resolution of 0 merges only peaks of the same mass. Since powers are
+ * folded by the Russian Multiplication Scheme, the same isotopologue may
+ * then show up as several peaks differing in the last bits of their
+ * masses, so the resolution should be at least @c DEFAULT_RESOLUTION.
+ *
+ * Peaks are kept ordered by mass. Folding uses the resolution and
+ * threshold of the distribution folded into.
+ *
+ * @see IsotopeDistribution
+ */
+class FineIsotopeDistribution {
+	public:
+		/**
+		 * Type of isotope mass.
+		 */
+		typedef IsotopeDistribution::mass_type mass_type;
+
+		/**
+		 * Type of isotope abundance.
+		 */
+		typedef IsotopeDistribution::abundance_type abundance_type;
+
+		/**
+		 * Type of isotope peak, the same as of @c IsotopeDistribution, but
+		 * with the absolute mass.
+		 */
+		typedef IsotopeDistribution::peak_type peak_type;
+
+		/**
+		 * Type of container with isotope peaks.
+		 */
+		typedef std::vector<peak_type> peaks_container;
+
+		typedef peaks_container::size_type size_type;
+
+		typedef std::vector<mass_type> masses_container;
+
+		typedef std::vector<abundance_type> abundances_container;
+
+		/**
+		 * Resolution merging the isotopologues of one composition only,
+		 * 1e-6.
+		 */
+		static const mass_type DEFAULT_RESOLUTION;
+
+		/**
+		 * Threshold below which products are pruned by default, 1e-9.
+		 */
+		static const abundance_type DEFAULT_THRESHOLD;
+
+		/**
+		 * Constructor of an empty distribution, which folded with any
+		 * distribution gives that distribution.
+		 *
+		 * @param resolution Largest difference of masses merged into one peak.
+		 * @param threshold Smallest abundance of products kept by folding.
+		 */
+		FineIsotopeDistribution(mass_type resolution = DEFAULT_RESOLUTION,
+								abundance_type threshold = DEFAULT_THRESHOLD) :
+			resolution(resolution), threshold(threshold) {}
+
+		/**
+		 * Constructor with the peaks of @c distribution that have an
+		 * abundance, e.g. the isotopes of an element.
+		 */
+		FineIsotopeDistribution(const IsotopeDistribution& distribution,
+								mass_type resolution = DEFAULT_RESOLUTION,
+								abundance_type threshold = DEFAULT_THRESHOLD);
+
+		/**
+		 * Gets the number of peaks.
+		 */
+		size_type size() const { return peaks.size(); }
+
+		/**
+		 * Returns true if the distribution has no peaks.
+		 */
+		bool empty() const { return peaks.empty(); }
+
+		/**
+		 * Folds this distribution with @c distribution, pruning and
+		 * merging the products.
+		 */
+		FineIsotopeDistribution& operator *=(
+				const FineIsotopeDistribution& distribution);
+
+		/**
+		 * Folds this distribution with itself @c pow times, using the
+		 * Russian Multiplication Scheme.
+		 */
+		FineIsotopeDistribution& operator *=(unsigned int pow);
+
+		/**
+		 * Gets the mass of peak @c i.
+		 */
+		mass_type getMass(size_type i) const { return peaks[i].mass; }
+
+		/**
+		 * Gets the abundance of peak @c i.
+		 */
+		abundance_type getAbundance(size_type i) const { return peaks[i].abundance; }
+
+		/**
+		 * Gets the masses of all peaks.
+		 */
+		masses_container getMasses() const;
+
+		/**
+		 * Gets the abundances of all peaks.
+		 */
+		abundances_container getAbundances() const;
+
+		/**
+		 * Gets the sum of all abundances, which is 1 less the abundance
+		 * of the pruned products.
+		 */
+		abundance_type getAbundancesSum() const;
+
+		mass_type getResolution() const { return resolution; }
+
+		abundance_type getThreshold() const { return threshold; }
+
+	private:
+		/**
+		 * Orders peaks by mass and merges those within the resolution.
+		 */
+		void merge();
+
+		peaks_container peaks;
+		mass_type resolution;
+		abundance_type threshold;
+};
+
+std::ostream& operator <<(std::ostream& os,
+						  const FineIsotopeDistribution& distribution);
+
+} // namespace ims
+
+#endif // IMS_FINE_ISOTOPE_DISTRIBUTION_H
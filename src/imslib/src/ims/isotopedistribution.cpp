@@ -9,19 +9,36 @@
 #include <numeric>
 #include <iostream>
 #include <cmath>
+#include <complex>
+#include <algorithm>
+#include <limits>
 #include <ims/isotopedistribution.h>
+#include <ims/utils/fft.h>
 
 namespace ims {
 
-IsotopeDistribution::size_type IsotopeDistribution::SIZE;
+IsotopeDistribution::size_type IsotopeDistribution::SIZE = 10;
+
+IsotopeDistribution::abundance_type IsotopeDistribution::ABUNDANCES_SUM_ERROR = 0.0001;
+
+const IsotopeDistribution::size_type IsotopeDistribution::DEFAULT_FFT_THRESHOLD = 512;
+
+const IsotopeDistribution::size_type IsotopeDistribution::INLINE_SIZE;
+
+IsotopeDistribution::size_type IsotopeDistribution::FFT_THRESHOLD = 
+								IsotopeDistribution::DEFAULT_FFT_THRESHOLD;
+
+IsotopeDistribution::Context::Context() : size(SIZE), 
+	abundances_sum_error(ABUNDANCES_SUM_ERROR), fft_threshold(FFT_THRESHOLD) {}
 
-IsotopeDistribution::abundance_type IsotopeDistribution::ABUNDANCES_SUM_ERROR;
 
 /**
  * Constructor with single isotope. It sets isotopes consist of one entry 
  * with given mass and 100% abundance.
  */
-IsotopeDistribution::IsotopeDistribution(mass_type mass): nominalMass(0) {
+IsotopeDistribution::IsotopeDistribution(mass_type mass, 
+										 const context_type& context): 
+									nominalMass(0), context(context) {
 	peaks.push_back(peaks_container::value_type(mass, 1.0));
 }
 
@@ -31,6 +48,7 @@ IsotopeDistribution& IsotopeDistribution::operator =(
 	if (this != &distribution) {
 		peaks = distribution.peaks;
 		nominalMass = distribution.nominalMass;
+		context = distribution.context;
 	}
 	return *this;
 }
@@ -57,64 +75,211 @@ IsotopeDistribution& IsotopeDistribution::operator *=(
 		return *this;
 	}
 	if (this->empty()) {
-		return operator =(distribution);
-	}
-	// creates a temporary destination container to store peaks 
-	// (abundances and masses)
-	peaks_container dest(SIZE);
-	// checks if the size of abundances and masses containers coincides with 
-	// the static variable SIZE (meant to be set by client for distribution)
-	setMinimumSize();
-	// creates a non-const equivalent of a const parameter - it's needed to 
-	// get non-const iterators out of it
-	IsotopeDistribution& non_const_distribution = 
-							const_cast<IsotopeDistribution&>(distribution);
-	non_const_distribution.setMinimumSize();
-
-	// sets up different iterators for an efficient folding:
-	// it2_dest - iterator on a destination container,
-	// it2_begin, it2_end - iterators on begin and end of the second 
-	//							source container (function parameter)
-	// it1 - iterator on the first source container
-	// it2 - iterator on the second source container
-	peaks_iterator it2_begin = non_const_distribution.peaks.begin();
-	peaks_iterator it1, it2,
-			it_dest = dest.begin(),
-			it2_end = it2_begin;
-	abundance_type abundances_sum, masses_mult_abundances_sum;
-
-	for (; it_dest != dest.end(); ++it_dest, ++it2_end) {
-
-		abundances_sum = 0;
-		masses_mult_abundances_sum = 0;
-		it1 = peaks.begin();
-		it2 = it2_end;
-
-		for (; it2 != it2_begin; ++it1, --it2) {			
-			abundances_sum += it1->abundance * it2->abundance;
-			masses_mult_abundances_sum += 
-					it1->abundance * it2->abundance * (it1->mass + it2->mass);
-		}
-		// adds last element
-		abundances_sum += it1->abundance * it2->abundance;
-		masses_mult_abundances_sum += 
-					it1->abundance * it2->abundance * (it1->mass + it2->mass);
-
-		// assigns results to containers through iterators
-		it_dest->abundance = abundances_sum;
-		it_dest->mass = (abundances_sum != 0) ?
-							masses_mult_abundances_sum / abundances_sum : 0;
+		// keeps the context
+		peaks = distribution.peaks;
+		nominalMass = distribution.nominalMass;
+		return *this;
+	}
+	const size_type size = context.getSize();
+	// folds into a temporary destination (abundances and masses), on the
+	// stack if it fits into the peaks stored in place; peaks missing in 
+	// either distribution count as empty, neither is padded
+	if (size <= INLINE_SIZE) {
+		peak_type dest[INLINE_SIZE];
+		fold(peaks.begin(), peaks.size(), distribution.peaks.begin(), 
+			 distribution.peaks.size(), dest, size);
+		peaks.assign(dest, dest + size);
+	} else {
+		peaks_container dest(size);
+		fold(peaks.begin(), peaks.size(), distribution.peaks.begin(), 
+			 distribution.peaks.size(), &dest[0], size);
+		peaks.assign(dest.begin(), dest.end());
 	}
 
 	nominalMass += distribution.nominalMass;
 	
-	peaks.swap(dest);
-	
 	this->normalize();
 
 	return *this;
 }
 
+
+void IsotopeDistribution::fold(const peak_type* first, size_type first_size, 
+							   const peak_type* second, size_type second_size,
+							   peak_type* dest, size_type size) const {
+	if (size >= context.getFFTThreshold()) {
+		foldByFFT(first, first_size, second, second_size, dest, size);
+	} else {
+		for (size_type k = 0; k < size; ++k) {
+			foldPeak(first, first_size, second, second_size, k, dest[k]);
+		}
+	}
+}
+
+
+void IsotopeDistribution::foldPeak(const peak_type* first, size_type first_size, 
+								   const peak_type* second, size_type second_size,
+								   size_type k, peak_type& dest) {
+	// sums up the products of peaks i and k - i of both distributions,
+	// for all i within both
+	size_type i = (k < second_size) ? 0 : k - second_size + 1;
+	const size_type end = std::min(k + 1, first_size);
+	abundance_type abundances_sum = 0, masses_mult_abundances_sum = 0;
+	for (; i < end; ++i) {
+		const peak_type& peak1 = first[i];
+		const peak_type& peak2 = second[k - i];
+		abundances_sum += peak1.abundance * peak2.abundance;
+		masses_mult_abundances_sum += 
+				peak1.abundance * peak2.abundance * (peak1.mass + peak2.mass);
+	}
+	dest.abundance = abundances_sum;
+	dest.mass = (abundances_sum != 0) ?
+					masses_mult_abundances_sum / abundances_sum : 0;
+}
+
+
+/**
+ * Convolves the abundances, and the abundances times masses, of both 
+ * distributions by FFT. Both real convolutions are packed into one complex 
+ * sequence, so it takes two forward transforms and one inverse transform.
+ * 
+ * FFT errors are absolute, about the machine epsilon times the norms of 
+ * the operands, which would swamp the tail of a distribution with 
+ * abundances far below. So abundance i is scaled by t^i, with t chosen to 
+ * make the first and last abundance of the result equal, and scaled back 
+ * afterwards. Peaks whose abundance is still too small for the error bound
+ * to give a relative accuracy of 1e-9 are folded directly, so are peaks of
+ * very steep tails. Peaks out of the range of the operands' peaks are left
+ * empty rather than filled with rounding errors.
+ */
+void IsotopeDistribution::foldByFFT(const peak_type* first_peaks, 
+									size_type first_size, 
+									const peak_type* second_peaks, 
+									size_type second_size,
+									peak_type* dest, size_type size) {
+	typedef std::complex<abundance_type> complex_type;
+	typedef std::vector<complex_type> complexes_container;
+
+	const size_type size1 = std::min(first_size, size);
+	const size_type size2 = std::min(second_size, size);
+
+	// ranges of peaks with an abundance
+	size_type first1 = 0, last1 = 0, first2 = 0, last2 = 0;
+	bool found1 = false, found2 = false;
+	for (size_type i = 0; i < size1; ++i) {
+		if (first_peaks[i].abundance != 0) {
+			last1 = i;
+			if (!found1) {
+				first1 = i;
+				found1 = true;
+			}
+		}
+	}
+	for (size_type i = 0; i < size2; ++i) {
+		if (second_peaks[i].abundance != 0) {
+			last2 = i;
+			if (!found2) {
+				first2 = i;
+				found2 = true;
+			}
+		}
+	}
+	const size_type first = first1 + first2;
+	if (!found1 || !found2 || first >= size) {
+		std::fill(dest, dest + size, peak_type());
+		return;
+	}
+	const size_type last = std::min(last1 + last2, size - 1);
+
+	// tilts the abundances so that the first and last of the result are
+	// equal, limiting the scale to keep far from overflows
+	abundance_type tilt = 1.0;
+	const abundance_type first_abundance = first_peaks[first1].abundance * 
+										   second_peaks[first2].abundance;
+	peak_type last_peak;
+	foldPeak(first_peaks, size1, second_peaks, size2, last, last_peak);
+	const abundance_type last_abundance = last_peak.abundance;
+	if (last > first && last_abundance > 0.0) {
+		tilt = std::pow(first_abundance / last_abundance, 
+						1.0 / static_cast<abundance_type>(last - first));
+		tilt = std::max(1.0, std::min(tilt, 
+			std::pow(10.0, 100.0 / static_cast<abundance_type>(size))));
+	}
+
+	// linear convolution without wrapping around
+	size_type length = 1;
+	while (length < 2 * size - 1) {
+		length <<= 1;
+	}
+	complexes_container u(length), v(length);
+	abundance_type scale = 1.0, norm1 = 0.0, norm2 = 0.0;
+	for (size_type i = 0; i < size1; ++i, scale *= tilt) {
+		const abundance_type abundance = first_peaks[i].abundance * scale;
+		u[i] = complex_type(abundance, abundance * first_peaks[i].mass);
+		norm1 += std::norm(u[i]);
+	}
+	scale = 1.0;
+	for (size_type i = 0; i < size2; ++i, scale *= tilt) {
+		const abundance_type abundance = second_peaks[i].abundance * scale;
+		v[i] = complex_type(abundance, abundance * second_peaks[i].mass);
+		norm2 += std::norm(v[i]);
+	}
+	fft(u);
+	fft(v);
+
+	// separates the transforms of the real and imaginary parts by their 
+	// symmetry, and packs abundances and abundances times masses of the 
+	// result into one sequence again: w = a * b + i (am * b + a * bm)
+	complexes_container w(length);
+	for (size_type k = 0; k < length; ++k) {
+		const size_type mirrored = (length - k) & (length - 1);
+		const complex_type& uk = u[k];
+		const complex_type& um = u[mirrored];
+		const complex_type& vk = v[k];
+		const complex_type& vm = v[mirrored];
+		const abundance_type a_re = 0.5 * (uk.real() + um.real());
+		const abundance_type a_im = 0.5 * (uk.imag() - um.imag());
+		const abundance_type am_re = 0.5 * (uk.imag() + um.imag());
+		const abundance_type am_im = 0.5 * (um.real() - uk.real());
+		const abundance_type b_re = 0.5 * (vk.real() + vm.real());
+		const abundance_type b_im = 0.5 * (vk.imag() - vm.imag());
+		const abundance_type bm_re = 0.5 * (vk.imag() + vm.imag());
+		const abundance_type bm_im = 0.5 * (vm.real() - vk.real());
+		const abundance_type ab_re = a_re * b_re - a_im * b_im;
+		const abundance_type ab_im = a_re * b_im + a_im * b_re;
+		const abundance_type m_re = am_re * b_re - am_im * b_im + 
+									a_re * bm_re - a_im * bm_im;
+		const abundance_type m_im = am_re * b_im + am_im * b_re + 
+									a_re * bm_im + a_im * bm_re;
+		w[k] = complex_type(ab_re - m_im, ab_im + m_re);
+	}
+	fft(w, true);
+
+	// bound of the absolute error of every tilted result
+	abundance_type log_length = 0.0;
+	for (size_type l = length; l > 1; l >>= 1) {
+		log_length += 1.0;
+	}
+	const abundance_type error = 8.0 * std::numeric_limits<abundance_type>::epsilon() * 
+								 (log_length + 1.0) * std::sqrt(norm1 * norm2);
+	const abundance_type accuracy = 1e-9;
+
+	std::fill(dest, dest + first, peak_type());
+	std::fill(dest + last + 1, dest + size, peak_type());
+	scale = std::pow(tilt, static_cast<abundance_type>(first));
+	for (size_type k = first; k <= last; ++k, scale *= tilt) {
+		const abundance_type abundance = w[k].real() / static_cast<abundance_type>(length);
+		if (abundance * accuracy > error) {
+			dest[k].mass = w[k].imag() / static_cast<abundance_type>(length) / abundance;
+			dest[k].abundance = abundance / scale;
+		} else {
+			// too small to be trusted, folds it directly
+			foldPeak(first_peaks, size1, second_peaks, size2, k, dest[k]);
+		}
+	}
+}
+
+
 /**
  * Folds the distribution with itself @c power times. Implements
  * Russian Multiplication Scheme by this reducing the number of 
@@ -129,45 +294,35 @@ IsotopeDistribution& IsotopeDistribution::operator *=(unsigned int power) {
 	}
 	
 	// folding proceeds a following:
-	// - first, binary representation of power is calculated, i.e. 
+	// - one loops through the binary representation of power, i.e. 
 	// power = 138 -----> binary representation = [0, 1, 0, 1, 0, 0, 0, 1]
-	// - then, one loops through array every time folding the copy
-	// of this distribution with itself into lets say this_power_two_index distribution. 
-	// Additionally, if the current index is equal to 1, then result distribution
-	// is folded with the current this_power_two_index distribution.
-	// At the end, the result distribution is outputted.
+	// every time folding the copy of this distribution with itself into 
+	// lets say this_power_two_index distribution. 
+	// - if the current bit is 1, then this distribution, where foldings 
+	// are collected, is folded with the current this_power_two_index 
+	// distribution.
 	
-	// calculates binary representation of power
-	std::vector<unsigned int> binary;
-	while (power > 0) {
-		binary.push_back(power % 2);
-		power >>= 1;
-	}
-	
-	// initializes distribution which will folded iteratively upto each entry
+	// initializes distribution which will folded iteratively upto each bit
 	IsotopeDistribution this_power_two_index(*this);
 	
-	// initializes result distribution where foldings will be collected
-	IsotopeDistribution result;
-	
-	// starts folding based on binary representation
-	if (binary[0]) {
-		result = this_power_two_index;
+	// starts folding based on the lowest bit, an empty distribution 
+	// collects the first folding as it is
+	if (!(power & 1)) {
+		peaks.clear();
+		nominalMass = 0;
 	}
 		
-	std::vector<unsigned int>::size_type index = 0;
-	while (++index < binary.size()) {
+	while ((power >>= 1) > 0) {
 		// folds distribution with itself iteratively
 		this_power_two_index *= this_power_two_index;
 		
-		if (binary[index]) {
+		if (power & 1) {
 			// collects distribution in the result
-			result *= this_power_two_index;
+			this->operator*=(this_power_two_index);
 		}
 	}
 		
-	return operator=(result);
-		
+	return *this;
 }
 
 
@@ -201,25 +356,18 @@ IsotopeDistribution::masses_container IsotopeDistribution::getMasses() const {
 
 void IsotopeDistribution::normalize() {
 	abundance_type sum = 0.0;
-	for (const_peaks_iterator cit = peaks.begin(); cit < peaks.end(); ++cit) {
+	for (peaks_storage::const_iterator cit = peaks.begin(); cit < peaks.end(); ++cit) {
 		sum += cit->abundance;
 	}
-	if (sum > 0 && std::fabs(sum - 1) > ABUNDANCES_SUM_ERROR) {
+	if (sum > 0 && std::fabs(sum - 1) > context.getAbundancesSumError()) {
 		abundance_type scale = 1/sum;
-		for (peaks_iterator it = peaks.begin(); it < peaks.end(); ++it) {
+		for (peaks_storage::iterator it = peaks.begin(); it < peaks.end(); ++it) {
 			it->abundance *= scale;
 		}
 	}
 }
 
 
-void IsotopeDistribution::setMinimumSize() {
-	if (peaks.size() < SIZE) {
-		peaks.resize(SIZE);
-	}
-}
-
-
 std::ostream& operator <<(std::ostream& os, 
 							const IsotopeDistribution& distribution) {
 	for (IsotopeDistribution::size_type i = 0; i < distribution.size(); ++i) {
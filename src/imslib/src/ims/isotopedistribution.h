@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <ostream>
+#include <ims/utils/inlinevector.h>
 
 namespace ims {
 
@@ -30,8 +31,8 @@ namespace ims {
  * 		(20.00831; 0.036 %)
  * 
  * To the sake of faster computations distribution is restricted 
- * to the first K elements, where K can be set by adjusting size 
- * @c SIZE of distribution. @note For the elements most abundant in
+ * to the first K elements, where K can be set by adjusting the size 
+ * of its @c Context. @note For the elements most abundant in
  * living beings (CHNOPS) this restriction is negligible, since abundances
  * decrease dramatically in isotopes order and are usually of no interest
  * starting from +10 isotope.
@@ -130,40 +131,143 @@ class IsotopeDistribution {
 		typedef abundances_container::const_iterator const_abundances_iterator;
 
 		/**
-		 * Error to be allowed for isotope distribution.
+		 * Error to be allowed for isotope distribution, setting of the
+		 * default @c Context. Defaults to 0.0001.
 		 */
 		static abundance_type ABUNDANCES_SUM_ERROR;
 		
 		/**
-		 * Length of isotope distribution.
+		 * Length of isotope distribution, setting of the default 
+		 * @c Context. Defaults to 10.
 		 */
 		static size_type SIZE;
 
+		/**
+		 * Smallest @c SIZE from which distributions are folded by the fast
+		 * Fourier transform in O(SIZE log SIZE) rather than directly in 
+		 * O(SIZE^2), setting of the default @c Context. Set it to 1 to 
+		 * always fold by FFT, to the largest size_type to never do so. 
+		 * Defaults to @c DEFAULT_FFT_THRESHOLD.
+		 */
+		static size_type FFT_THRESHOLD;
+
+		/**
+		 * Number of peaks stored in place, without allocating memory.
+		 * Distributions whose context has at most that size are copied
+		 * and folded without allocations.
+		 */
+		static const size_type INLINE_SIZE = 32;
+
+		/**
+		 * Size from which folding by FFT is faster than folding directly,
+		 * 512 (see tools/convolutionruntimes).
+		 */
+		static const size_type DEFAULT_FFT_THRESHOLD;
+
+		/**
+		 * @brief Settings of a computation with isotope distributions:
+		 * length, error allowed for the sum of abundances and the size
+		 * from which to fold by FFT.
+		 * 
+		 * Every distribution carries the context it was constructed with,
+		 * and folding uses the context of the distribution folded into.
+		 * Computations with different settings, each with its own 
+		 * context, may thus run in parallel threads. Distributions 
+		 * constructed without a context get the default one, which takes
+		 * the values of the static @c SIZE, @c ABUNDANCES_SUM_ERROR and
+		 * @c FFT_THRESHOLD when constructed. Those must not be changed
+		 * while other threads construct distributions.
+		 */
+		class Context {
+			public:
+				/**
+				 * Constructor of the default context.
+				 */
+				Context();
+
+				/**
+				 * Constructor with the settings.
+				 */
+				Context(size_type size, abundance_type abundances_sum_error,
+						size_type fft_threshold = DEFAULT_FFT_THRESHOLD) :
+					size(size), abundances_sum_error(abundances_sum_error),
+					fft_threshold(fft_threshold) {}
+
+				size_type getSize() const { return size; }
+
+				void setSize(size_type size) { this->size = size; }
+
+				abundance_type getAbundancesSumError() const { 
+					return abundances_sum_error; 
+				}
+
+				void setAbundancesSumError(abundance_type abundances_sum_error) {
+					this->abundances_sum_error = abundances_sum_error;
+				}
+
+				size_type getFFTThreshold() const { return fft_threshold; }
+
+				void setFFTThreshold(size_type fft_threshold) { 
+					this->fft_threshold = fft_threshold; 
+				}
+
+				bool operator ==(const Context& context) const {
+					return (size == context.size && 
+							abundances_sum_error == context.abundances_sum_error &&
+							fft_threshold == context.fft_threshold);
+				}
+
+				bool operator !=(const Context& context) const {
+					return !this->operator==(context);
+				}
+
+			private:
+				size_type size;
+				abundance_type abundances_sum_error;
+				size_type fft_threshold;
+		};
+
+		/**
+		 * Type of settings of a computation.
+		 */
+		typedef Context context_type;
+
 		/**
 		 * Constructor with nominal mass.
 		 */
-		IsotopeDistribution(nominal_mass_type nominalMass = 0) :
-					nominalMass(nominalMass) {}
+		IsotopeDistribution(nominal_mass_type nominalMass = 0,
+							const context_type& context = context_type()) :
+					nominalMass(nominalMass), context(context) {}
+
+		/**
+		 * Constructor of an empty distribution with a context.
+		 */
+		explicit IsotopeDistribution(const context_type& context) :
+					nominalMass(0), context(context) {}
 
 		/**
 		 * Constructor with single isotope.
 		 */
-		IsotopeDistribution(mass_type mass);
+		IsotopeDistribution(mass_type mass, 
+							const context_type& context = context_type());
 
 		/**
 		 * Constructor with isotopes and nominal mass.
 		 */
 		IsotopeDistribution(const peaks_container& peaks,
-				    nominal_mass_type nominalMass = 0) :
-					peaks(peaks),
-					nominalMass(nominalMass) {}
+				    nominal_mass_type nominalMass = 0,
+				    const context_type& context = context_type()) :
+					peaks(peaks.begin(), peaks.end()),
+					nominalMass(nominalMass),
+					context(context) {}
 
 		/**
 		 * Copy constructor.
 		 */
 		IsotopeDistribution(const IsotopeDistribution& distribution) :
 					peaks(distribution.peaks),
-					nominalMass(distribution.nominalMass) {}
+					nominalMass(distribution.nominalMass),
+					context(distribution.context) {}
 
 		/**
 		 * Destructor.
@@ -171,12 +275,22 @@ class IsotopeDistribution {
 		~IsotopeDistribution() {}
 
 		/**
-		 * Gets size of isotope distribution. @note Size is not smaller than
-		 * predefined @c SIZE.
+		 * Gets size of isotope distribution. @note Size is not larger than
+		 * the size of the context.
 		 * 
 		 * @return Size of isotope distribution.
 		 */
-		size_type size() const { return std::min(peaks.size(), SIZE); }
+		size_type size() const { return std::min(peaks.size(), context.getSize()); }
+
+		/**
+		 * Gets the settings this distribution is computed with.
+		 */
+		const context_type& getContext() const { return context; }
+
+		/**
+		 * Sets the settings this distribution is computed with from now on.
+		 */
+		void setContext(const context_type& context) { this->context = context; }
 
 		/**
 		 * Assignment operator.
@@ -210,6 +324,8 @@ class IsotopeDistribution {
 		 * @note Operator is unary, so result is stored in this 
 		 * object itself.
 		 * 
+		 * The result has the context of this distribution.
+		 * 
 		 * @param distribution Distribution to be folded with this one.
 		 * @return Reference to this object.
 		 * 
@@ -286,8 +402,8 @@ class IsotopeDistribution {
 
 		/**
 		 * Normalizes distribution, 
-		 * i.e. scaling abundances to be summed up to 1 with an error 
-		 * @c ABUNDANCES_SUM_ERROR allowed.
+		 * i.e. scaling abundances to be summed up to 1 with the error 
+		 * of the context allowed.
 		 */
 		void normalize();
 
@@ -299,10 +415,15 @@ class IsotopeDistribution {
 		bool empty() const { return peaks.empty(); }
 				
 	private:
+		/**
+		 * Type of container to store peaks in.
+		 */
+		typedef InlineVector<peak_type, INLINE_SIZE> peaks_storage;
+
 		/**
 		 * Container for isotopes.
 		 */
-		peaks_container peaks;
+		peaks_storage peaks;
 		
 		/**
 		 * Nominal mass of distribution.
@@ -310,9 +431,33 @@ class IsotopeDistribution {
 		nominal_mass_type nominalMass;
 
 		/**
-		 * Sets peaks/isotopes container minimum size.
+		 * Settings of computations.
+		 */
+		context_type context;
+
+		/**
+		 * Folds the first @c first_size peaks of @c first with the first 
+		 * @c second_size peaks of @c second into the @c size peaks of 
+		 * @c dest, with the context of this distribution. Missing peaks
+		 * count as empty. @c dest must not overlap the others.
+		 */
+		void fold(const peak_type* first, size_type first_size, 
+				  const peak_type* second, size_type second_size,
+				  peak_type* dest, size_type size) const;
+
+		/**
+		 * Folds peak @c k directly, as fold() does.
+		 */
+		static void foldPeak(const peak_type* first, size_type first_size, 
+							 const peak_type* second, size_type second_size,
+							 size_type k, peak_type& dest);
+
+		/**
+		 * Folds as fold() does, but by the fast Fourier transform.
 		 */
-		void setMinimumSize();
+		static void foldByFFT(const peak_type* first, size_type first_size, 
+							  const peak_type* second, size_type second_size,
+							  peak_type* dest, size_type size);
 };
 
 /**
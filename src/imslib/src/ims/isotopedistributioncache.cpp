@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <ims/isotopedistributioncache.h>
+
+namespace ims {
+
+namespace {
+
+/**
+ * Orders alphabet indices by the sequences of their elements, as
+ * ElementSortCriteria orders elements.
+ */
+class SequenceOrder {
+	public:
+		SequenceOrder(const Alphabet& alphabet) : alphabet(alphabet) {}
+		bool operator()(Alphabet::size_type a, Alphabet::size_type b) const {
+			return alphabet.getElement(a).getSequence() <
+				   alphabet.getElement(b).getSequence();
+		}
+	private:
+		const Alphabet& alphabet;
+};
+
+} // namespace
+
+
+IsotopeDistributionCache::IsotopeDistributionCache(const alphabet_type& alphabet,
+							const distribution_type::context_type& context) :
+	alphabet(alphabet), context(context), powers(alphabet.size()), 
+	suffixes(alphabet.size() + 1, distribution_type(context)),
+	folded(alphabet.size()), hits(0), misses(0) {
+	for (size_type i = 0; i < alphabet.size(); ++i) {
+		fold_order.push_back(i);
+	}
+	std::sort(fold_order.begin(), fold_order.end(), SequenceOrder(alphabet));
+}
+
+
+const IsotopeDistributionCache::distribution_type&
+IsotopeDistributionCache::getPower(size_type element, count_type count) {
+	std::vector<distribution_type>& element_powers = powers[element];
+	if (element_powers.size() <= count) {
+		element_powers.resize(count + 1, distribution_type(context));
+	}
+	distribution_type& power = element_powers[count];
+	if (power.empty()) {
+		++misses;
+		power = alphabet.getElement(element).getIsotopeDistribution();
+		power.setContext(context);
+		power *= count;
+	} else {
+		++hits;
+	}
+	return power;
+}
+
+
+void IsotopeDistributionCache::getDistribution(const counts_type& counts,
+											   distribution_type& distribution) {
+	distribution = distribution_type(context);
+	for (std::vector<size_type>::const_iterator it = fold_order.begin();
+			it != fold_order.end(); ++it) {
+		if (*it < counts.size() && counts[*it] != 0) {
+			distribution *= getPower(*it, counts[*it]);
+		}
+	}
+}
+
+
+const IsotopeDistributionCache::distribution_type&
+IsotopeDistributionCache::getNextDistribution(const counts_type& counts, 
+											  size_type changed) {
+	// refolds the elements up to changed, and all not folded yet
+	size_type index = std::max(std::min(changed + 1, alphabet.size()), folded);
+	while (index > 0) {
+		--index;
+		distribution_type& suffix = suffixes[index];
+		suffix = suffixes[index + 1];
+		if (counts[index] != 0) {
+			suffix *= getPower(index, counts[index]);
+		}
+	}
+	folded = 0;
+	return suffixes[0];
+}
+
+
+void IsotopeDistributionCache::clear() {
+	for (size_type i = 0; i < powers.size(); ++i) {
+		powers[i].clear();
+	}
+	folded = alphabet.size();
+}
+
+} // namespace ims
@@ -0,0 +1,124 @@
+#ifndef IMS_ISOTOPEDISTRIBUTIONCACHE_H
+#define IMS_ISOTOPEDISTRIBUTIONCACHE_H
+
+#include <vector>
+#include <ims/alphabet.h>
+#include <ims/isotopedistribution.h>
+
+namespace ims {
+
+/**
+ * @brief Computes isotope distributions of molecules given as element
+ * counts, caching the distributions of every element's powers.
+ *
+ * The distribution of a molecule is folded from the distributions of
+ * its elements, each folded with itself as often as the element occurs
+ * (see IsotopeDistribution::operator*=(unsigned int)). Candidate molecules
+ * of one mass share most of these powers (e.g. C20 to C40, H10 to H60),
+ * so every power is computed once, when it is first needed, and kept
+ * for all later molecules. A molecule with k elements then takes k-1
+ * foldings.
+ *
+ * Elements are folded in the order of ComposedElement (by their
+ * sequences), so distributions are the same as
+ * ComposedElement::updateIsotopeDistribution() gives.
+ *
+ * The cache is filled while it is used, so it must not be shared between
+ * threads. Caches with their own contexts are independent, though.
+ *
+ * @see ComposedElement
+ */
+class IsotopeDistributionCache {
+	public:
+		typedef Alphabet alphabet_type;
+		typedef alphabet_type::size_type size_type;
+		typedef IsotopeDistribution distribution_type;
+		typedef unsigned int count_type;
+		typedef std::vector<count_type> counts_type;
+		typedef unsigned long long statistics_type;
+
+		/**
+		 * Constructor with the alphabet whose elements are counted. The
+		 * alphabet must outlive the cache. All distributions are computed
+		 * with the settings of @c context.
+		 */
+		IsotopeDistributionCache(const alphabet_type& alphabet,
+								 const distribution_type::context_type& context = 
+								 distribution_type::context_type());
+
+		const distribution_type::context_type& getContext() const { return context; }
+
+		/**
+		 * Gets the distribution of @c count atoms of the element with
+		 * index @c element in the alphabet, computing it if it's not
+		 * cached yet. @c count must be at least 1.
+		 */
+		const distribution_type& getPower(size_type element, count_type count);
+
+		/**
+		 * Stores in @c distribution the isotope distribution of the
+		 * molecule with @c counts[i] atoms of the alphabet's element i.
+		 */
+		void getDistribution(const counts_type& counts, distribution_type& distribution);
+
+		/**
+		 * Gets the isotope distribution of the molecule with @c counts[i]
+		 * atoms of the alphabet's element i, @c counts having one entry 
+		 * per element. The counts of the elements above @c changed must 
+		 * be the same as with the previous call. Meant for molecules 
+		 * enumerated by a decomposition cursor, @c changed being its 
+		 * getChangedLevel().
+		 *
+		 * The distribution of the elements from every index on up is kept
+		 * from the previous call, so only the elements up to @c changed 
+		 * are folded in again, mostly one or two instead of all. Elements
+		 * are folded from the highest index down. As every folding 
+		 * normalizes the abundances only if their sum is off by more than
+		 * the error allowed by the context, distributions may 
+		 * differ from those of getDistribution() by about that much.
+		 *
+		 * The distribution returned is valid until the next call.
+		 */
+		const distribution_type& getNextDistribution(const counts_type& counts, 
+													 size_type changed);
+
+		/**
+		 * Gets the number of powers found in the cache.
+		 */
+		statistics_type getHits() const { return hits; }
+
+		/**
+		 * Gets the number of powers computed.
+		 */
+		statistics_type getMisses() const { return misses; }
+
+		/**
+		 * Removes all powers from the cache, keeping the statistics. 
+		 * The next call of getNextDistribution() folds all elements.
+		 */
+		void clear();
+
+	private:
+		const alphabet_type& alphabet;
+
+		distribution_type::context_type context;
+
+		// indices of the alphabet in the order elements are folded
+		std::vector<size_type> fold_order;
+
+		// powers of every element by count, empty where not computed yet
+		std::vector<std::vector<distribution_type> > powers;
+
+		// distributions of the elements from index i on up at i, of no
+		// elements at the end, see getNextDistribution()
+		std::vector<distribution_type> suffixes;
+
+		// lowest index from which suffixes hold the previous molecule
+		size_type folded;
+
+		statistics_type hits, misses;
+};
+
+} // namespace ims
+
+#endif // IMS_ISOTOPEDISTRIBUTIONCACHE_H
@@ -0,0 +1,70 @@
+#ifndef IMS_FFT_H
+#define IMS_FFT_H
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+
+namespace ims {
+
+/**
+ * Transforms @c data in place by the iterative radix-2 fast Fourier
+ * transform, the inverse one (without the factor 1/n) if @c inverse is
+ * true. The size of @c data must be a power of two.
+ *
+ * Twiddle factors are computed directly rather than by recurrence, which
+ * keeps the error at O(log n) ulps.
+ */
+template <typename T>
+void fft(std::vector<std::complex<T> >& data, bool inverse = false) {
+	typedef typename std::vector<std::complex<T> >::size_type size_type;
+	const size_type n = data.size();
+	if (n < 2) {
+		return;
+	}
+
+	// orders data by bit reversed indices
+	for (size_type i = 1, j = 0; i < n; ++i) {
+		size_type bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			std::swap(data[i], data[j]);
+		}
+	}
+
+	// twiddle factors of the last level, the levels below take every 
+	// second, fourth... of them
+	const T pi = static_cast<T>(3.14159265358979323846264338327950288);
+	const T angle = (inverse ? 2 : -2) * pi / static_cast<T>(n);
+	std::vector<T> twiddles_re(n / 2), twiddles_im(n / 2);
+	for (size_type k = 0; k < n / 2; ++k) {
+		twiddles_re[k] = std::cos(angle * static_cast<T>(k));
+		twiddles_im[k] = std::sin(angle * static_cast<T>(k));
+	}
+
+	// complex products are written out, std::complex checks for 
+	// infinities and NaNs on every multiplication
+	for (size_type length = 2; length <= n; length <<= 1) {
+		const size_type half = length / 2;
+		const size_type stride = n / length;
+		for (size_type start = 0; start < n; start += length) {
+			for (size_type k = 0; k < half; ++k) {
+				std::complex<T>& even = data[start + k];
+				std::complex<T>& odd = data[start + k + half];
+				const T w_re = twiddles_re[k * stride], w_im = twiddles_im[k * stride];
+				const T odd_re = odd.real() * w_re - odd.imag() * w_im;
+				const T odd_im = odd.real() * w_im + odd.imag() * w_re;
+				odd = std::complex<T>(even.real() - odd_re, even.imag() - odd_im);
+				even = std::complex<T>(even.real() + odd_re, even.imag() + odd_im);
+			}
+		}
+	}
+}
+
+} // namespace ims
+
+#endif // IMS_FFT_H
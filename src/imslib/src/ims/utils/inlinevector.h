@@ -0,0 +1,142 @@
+#ifndef IMS_INLINEVECTOR_H
+#define IMS_INLINEVECTOR_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace ims {
+
+/**
+ * @brief Sequence of elements that keeps up to @c N of them in place and
+ * only goes to the heap for more.
+ *
+ * Offers the part of the interface of @c std::vector that is needed for
+ * short sequences copied and rebuilt very often, e.g. isotope
+ * distributions of a few peaks: copying, assigning or resizing within
+ * @c N elements never allocates. Iterators are pointers, invalidated by
+ * every change of the size.
+ *
+ * @c T must be default constructible and assignable.
+ */
+template <typename T, std::size_t N>
+class InlineVector {
+	public:
+		typedef T value_type;
+		typedef std::size_t size_type;
+		typedef T* iterator;
+		typedef const T* const_iterator;
+		typedef T& reference;
+		typedef const T& const_reference;
+
+		/**
+		 * Number of elements kept in place.
+		 */
+		static const size_type INLINE_CAPACITY = N;
+
+		InlineVector() : length(0) {}
+
+		InlineVector(const InlineVector& other) : length(0) {
+			assign(other.begin(), other.end());
+		}
+
+		/**
+		 * Constructor with the elements of [first, last), which must be
+		 * random access iterators.
+		 */
+		template <typename RandomAccessIterator>
+		InlineVector(RandomAccessIterator first, RandomAccessIterator last) :
+			length(0) {
+			assign(first, last);
+		}
+
+		InlineVector& operator =(const InlineVector& other) {
+			if (this != &other) {
+				assign(other.begin(), other.end());
+			}
+			return *this;
+		}
+
+		/**
+		 * Replaces the elements by those of [first, last), which must be
+		 * random access iterators not into this sequence.
+		 */
+		template <typename RandomAccessIterator>
+		void assign(RandomAccessIterator first, RandomAccessIterator last) {
+			size_type new_length = static_cast<size_type>(last - first);
+			if (new_length <= N) {
+				std::copy(first, last, elements);
+				overflow.clear();
+			} else {
+				overflow.assign(first, last);
+			}
+			length = new_length;
+		}
+
+		/**
+		 * Changes the number of elements to @c new_length, filling up
+		 * with @c value.
+		 */
+		void resize(size_type new_length, const T& value = T()) {
+			if (new_length <= N) {
+				if (length > N) {
+					std::copy(overflow.begin(), overflow.begin() + new_length, elements);
+					overflow.clear();
+				} else if (new_length > length) {
+					std::fill(elements + length, elements + new_length, value);
+				}
+			} else {
+				if (length <= N) {
+					overflow.assign(elements, elements + length);
+				}
+				overflow.resize(new_length, value);
+			}
+			length = new_length;
+		}
+
+		void push_back(const T& value) {
+			resize(length + 1, value);
+		}
+
+		void clear() {
+			overflow.clear();
+			length = 0;
+		}
+
+		size_type size() const { return length; }
+
+		bool empty() const { return length == 0; }
+
+		iterator begin() { return length <= N ? elements : &overflow[0]; }
+
+		const_iterator begin() const { return length <= N ? elements : &overflow[0]; }
+
+		iterator end() { return begin() + length; }
+
+		const_iterator end() const { return begin() + length; }
+
+		reference operator [](size_type i) { return begin()[i]; }
+
+		const_reference operator [](size_type i) const { return begin()[i]; }
+
+		bool operator ==(const InlineVector& other) const {
+			return length == other.length &&
+				   std::equal(begin(), end(), other.begin());
+		}
+
+		bool operator !=(const InlineVector& other) const {
+			return !this->operator==(other);
+		}
+
+	private:
+		T elements[N];
+		std::vector<T> overflow;
+		size_type length;
+};
+
+template <typename T, std::size_t N>
+const typename InlineVector<T, N>::size_type InlineVector<T, N>::INLINE_CAPACITY;
+
+} // namespace ims
+
+#endif // IMS_INLINEVECTOR_H
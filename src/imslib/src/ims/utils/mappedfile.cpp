@@ -0,0 +1,161 @@
+#include <ims/utils/mappedfile.h>
+#include <ims/base/exception/ioexception.h>
+
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ims {
+
+struct MappedFile::Mapping {
+	Mapping() : references(1), address(0), mapped_length(0) {}
+
+	// number of MappedFile objects sharing this mapping
+	std::size_t references;
+	// start and length of the mmapped region, if mapped
+	void* address;
+	std::size_t mapped_length;
+	// data read into memory, if not mapped
+	std::vector<char> buffer;
+};
+
+
+namespace {
+
+/**
+ * Reads all remaining data of @c is into @c buffer, starting on a cache
+ * line, and returns the start.
+ */
+const char* readAligned(std::istream& is, std::vector<char>& buffer, std::size_t& length) {
+	const std::size_t alignment = 64;
+	std::vector<char> data;
+	char chunk[65536];
+	while (is.read(chunk, sizeof(chunk)) || is.gcount() > 0) {
+		data.insert(data.end(), chunk, chunk + is.gcount());
+	}
+	if (is.bad()) {
+		throw IOException("unable to read mapped file contents");
+	}
+	length = data.size();
+	buffer.resize(length + alignment);
+	std::size_t misalignment = reinterpret_cast<std::size_t>(&buffer[0]) % alignment;
+	char* start = &buffer[0] + (misalignment == 0 ? 0 : alignment - misalignment);
+	std::copy(data.begin(), data.end(), start);
+	return start;
+}
+
+} // namespace
+
+
+MappedFile::MappedFile() : mapping(0), start(0), length(0) {}
+
+
+MappedFile::MappedFile(const std::string& filename) :
+	mapping(new Mapping()), start(0), length(0) {
+#ifndef _WIN32
+	int fd = open(filename.c_str(), O_RDONLY);
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		release();
+		throw IOException("unable to open file: " + filename + "!");
+	}
+	if (status.st_size > 0) {
+		void* address = mmap(0, static_cast<std::size_t>(status.st_size),
+							 PROT_READ, MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED) {
+			close(fd);
+			release();
+			throw IOException("unable to map file: " + filename + "!");
+		}
+		mapping->address = address;
+		mapping->mapped_length = static_cast<std::size_t>(status.st_size);
+		start = static_cast<const char*>(address);
+		length = mapping->mapped_length;
+	}
+	// the mapping stays valid after closing the descriptor
+	close(fd);
+#else
+	std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!ifs) {
+		release();
+		throw IOException("unable to open file: " + filename + "!");
+	}
+	try {
+		start = readAligned(ifs, mapping->buffer, length);
+	} catch (...) {
+		release();
+		throw;
+	}
+#endif
+}
+
+
+MappedFile::MappedFile(std::istream& is) :
+	mapping(new Mapping()), start(0), length(0) {
+	try {
+		start = readAligned(is, mapping->buffer, length);
+	} catch (...) {
+		release();
+		throw;
+	}
+}
+
+
+MappedFile::MappedFile(const MappedFile& file) :
+	mapping(file.mapping), start(file.start), length(file.length) {
+	if (mapping != 0) {
+		++mapping->references;
+	}
+}
+
+
+MappedFile& MappedFile::operator =(const MappedFile& file) {
+	if (mapping != file.mapping) {
+		release();
+		mapping = file.mapping;
+		if (mapping != 0) {
+			++mapping->references;
+		}
+	}
+	start = file.start;
+	length = file.length;
+	return *this;
+}
+
+
+MappedFile::~MappedFile() {
+	release();
+}
+
+
+bool MappedFile::isMapped() const {
+	return mapping != 0 && mapping->address != 0;
+}
+
+
+void MappedFile::release() {
+	if (mapping != 0 && --mapping->references == 0) {
+#ifndef _WIN32
+		if (mapping->address != 0) {
+			munmap(mapping->address, mapping->mapped_length);
+		}
+#endif
+		delete mapping;
+	}
+	mapping = 0;
+	start = 0;
+	length = 0;
+}
+
+} // namespace ims
@@ -0,0 +1,83 @@
+#ifndef IMS_MAPPEDFILE_H
+#define IMS_MAPPEDFILE_H
+
+#include <string>
+#include <istream>
+#include <cstddef>
+
+namespace ims {
+
+/**
+ * @brief Read-only contents of a file, mapped into memory.
+ *
+ * Where @c mmap is available the file is mapped shared and read-only, so
+ * all processes mapping the same file (e.g. forked workers) share its
+ * pages in the page cache instead of each holding a private copy.
+ * Elsewhere, and for contents read from a stream, the data is read into
+ * memory owned by this object.
+ *
+ * Copies share the mapping, which is released with the last copy.
+ * Copying is not thread-safe, reading the data is.
+ *
+ * @ingroup utils
+ */
+class MappedFile {
+	public:
+		/**
+		 * Creates an empty mapping.
+		 */
+		MappedFile();
+
+		/**
+		 * Maps the file @c filename.
+		 *
+		 * @throw IOException if the file can't be opened or mapped.
+		 */
+		explicit MappedFile(const std::string& filename);
+
+		/**
+		 * Reads all remaining data of @c is into memory.
+		 *
+		 * @throw IOException if reading fails.
+		 */
+		explicit MappedFile(std::istream& is);
+
+		MappedFile(const MappedFile& file);
+
+		MappedFile& operator =(const MappedFile& file);
+
+		~MappedFile();
+
+		/**
+		 * Gets the first byte of the data, which starts on a page (or, if
+		 * read from a stream, at least on a cache line).
+		 */
+		const char* data() const { return start; }
+
+		/**
+		 * Gets the number of bytes.
+		 */
+		std::size_t size() const { return length; }
+
+		/**
+		 * Returns true if the data is mapped from a file rather than
+		 * held in memory allocated by this object.
+		 */
+		bool isMapped() const;
+
+	private:
+		/**
+		 * State shared between copies.
+		 */
+		struct Mapping;
+
+		void release();
+
+		Mapping* mapping;
+		const char* start;
+		std::size_t length;
+};
+
+} // namespace ims
+
+#endif // IMS_MAPPEDFILE_H
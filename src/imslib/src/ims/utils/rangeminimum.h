@@ -0,0 +1,145 @@
+#ifndef IMS_RANGEMINIMUM_H
+#define IMS_RANGEMINIMUM_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace ims {
+
+/**
+ * @brief Answers range minimum queries over arrays in about constant time.
+ *
+ * An array is cut into blocks of @c BlockSize values. A sparse table holds
+ * the minima of all runs of 2^k blocks, so the minimum of any run of whole
+ * blocks is the smaller of two table entries. The values of the at most two
+ * partial blocks at the ends of a range are scanned. This takes
+ * about 1 + log(n / BlockSize) / BlockSize values of memory per value
+ * of the array, instead of log(n) for a sparse table over the values.
+ *
+ * Neither the values nor the block minima are stored by the index, it only
+ * knows their layout for arrays of one size and is shared by all of them.
+ * The caller keeps the block minima of every array next to its values,
+ * e.g. in a memory-mapped file, and passes both to every query.
+ *
+ * @param ValueType Type of values, which are compared with <tt>operator<</tt>.
+ * @param BlockSize Number of values per block.
+ *
+ * @ingroup utils
+ */
+template <typename ValueType, std::size_t BlockSize = 32>
+class RangeMinimum {
+	public:
+		typedef ValueType value_type;
+
+		typedef std::size_t size_type;
+
+		/**
+		 * Creates an index for arrays of no values.
+		 */
+		RangeMinimum() : size(0), number_of_blocks(0), levels(0) {}
+
+		/**
+		 * Prepares the index for arrays of @c size values.
+		 */
+		void reset(size_type size);
+
+		/**
+		 * Gets the number of values per block.
+		 */
+		static size_type getBlockSize() { return BlockSize; }
+
+		/**
+		 * Gets the number of block minima of every array.
+		 */
+		size_type getNumberOfMinima() const { return levels * number_of_blocks; }
+
+		/**
+		 * Computes the getNumberOfMinima() block minima of 
+		 * @c values[0, size) into @c minima.
+		 */
+		void build(const value_type* values, value_type* minima) const;
+
+		/**
+		 * Gets the smallest of @c values[@c first, @c last], @c minima
+		 * being the block minima built over @c values.
+		 */
+		value_type getMinimum(const value_type* values, const value_type* minima,
+							  size_type first, size_type last) const;
+
+		/**
+		 * Gets the number of bytes allocated by the index.
+		 */
+		std::size_t getMemoryUsage() const {
+			return logarithms.capacity() * sizeof(unsigned char);
+		}
+
+	private:
+		size_type size;
+		size_type number_of_blocks;
+		size_type levels;
+		// floor(log2(n)) for n blocks at n
+		std::vector<unsigned char> logarithms;
+};
+
+
+template <typename ValueType, std::size_t BlockSize>
+void RangeMinimum<ValueType, BlockSize>::reset(size_type size) {
+	this->size = size;
+	number_of_blocks = (size + BlockSize - 1) / BlockSize;
+	logarithms.assign(number_of_blocks + 1, 0);
+	for (size_type n = 2; n <= number_of_blocks; ++n) {
+		logarithms[n] = static_cast<unsigned char>(logarithms[n / 2] + 1);
+	}
+	levels = number_of_blocks == 0 ? 0 : logarithms[number_of_blocks] + 1;
+}
+
+
+template <typename ValueType, std::size_t BlockSize>
+void RangeMinimum<ValueType, BlockSize>::build(const value_type* values,
+		value_type* minima) const {
+	// the minimum of the blocks [b, b + 2^k) goes to k * number_of_blocks + b,
+	// runs beyond the last block are not used
+	for (size_type b = 0; b < number_of_blocks; ++b) {
+		size_type end = std::min(size, (b + 1) * BlockSize);
+		minima[b] = *std::min_element(values + b * BlockSize, values + end);
+	}
+	for (size_type k = 1; k < levels; ++k) {
+		const value_type* previous = minima + (k - 1) * number_of_blocks;
+		value_type* current = minima + k * number_of_blocks;
+		size_type half = static_cast<size_type>(1) << (k - 1);
+		size_type b = 0;
+		for (; b + 2 * half <= number_of_blocks; ++b) {
+			current[b] = std::min(previous[b], previous[b + half]);
+		}
+		std::fill(current + b, current + number_of_blocks, previous[b]);
+	}
+}
+
+
+template <typename ValueType, std::size_t BlockSize>
+typename RangeMinimum<ValueType, BlockSize>::value_type
+RangeMinimum<ValueType, BlockSize>::getMinimum(const value_type* values,
+		const value_type* minima, size_type first, size_type last) const {
+	size_type first_block = first / BlockSize, last_block = last / BlockSize;
+	if (first_block == last_block) {
+		return *std::min_element(values + first, values + last + 1);
+	}
+	// partial blocks at both ends
+	value_type minimum = std::min(
+		*std::min_element(values + first, values + (first_block + 1) * BlockSize),
+		*std::min_element(values + last_block * BlockSize, values + last + 1));
+	// whole blocks in between, covered by two overlapping runs of 2^k blocks
+	if (last_block > first_block + 1) {
+		size_type blocks = last_block - first_block - 1;
+		size_type k = logarithms[blocks];
+		const value_type* run_minima = minima + k * number_of_blocks;
+		minimum = std::min(minimum, std::min(run_minima[first_block + 1],
+			run_minima[last_block - (static_cast<size_type>(1) << k)]));
+	}
+	return minimum;
+}
+
+} // namespace ims
+
+#endif // IMS_RANGEMINIMUM_H
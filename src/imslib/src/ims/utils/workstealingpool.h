@@ -0,0 +1,170 @@
+#ifndef IMS_WORKSTEALINGPOOL_H
+#define IMS_WORKSTEALINGPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ims {
+
+/**
+ * Runs a number of independent tasks on a fixed number of threads,
+ * balancing them by work stealing.
+ *
+ * Task indices are split into contiguous blocks, one per thread. Every
+ * thread works off its own block from the front and, once it runs dry,
+ * steals indices from the back of the other threads' blocks. Unlike a
+ * static partitioning this keeps all threads busy when the running times
+ * of tasks differ by orders of magnitude (as for mass decomposition, where
+ * the number of decompositions grows steeply with the mass).
+ *
+ * The calling thread takes part as one of the workers, so the pool with
+ * one thread just runs all tasks in order. Tasks must not throw across
+ * threads: the first exception is caught, remaining tasks are skipped and
+ * the exception is rethrown in the calling thread by run().
+ *
+ * Requires C++11 (std::thread).
+ *
+ * @ingroup utils
+ */
+class WorkStealingPool {
+	public:
+		/**
+		 * Type of task indices.
+		 */
+		typedef std::size_t size_type;
+
+		/**
+		 * Creates a pool with @c threads threads (at least one).
+		 */
+		explicit WorkStealingPool(unsigned int threads) :
+			threads(std::max(threads, 1u)) { }
+
+		/**
+		 * Gets the number of threads used by run().
+		 */
+		unsigned int getThreads() const { return threads; }
+
+		/**
+		 * Calls @c task(i) for every i in [0, @c size) and returns when
+		 * all tasks are done. @c task is shared by all threads.
+		 */
+		template <typename Task>
+		void run(size_type size, Task& task);
+
+	private:
+		/**
+		 * Task indices owned by one thread.
+		 */
+		struct Queue {
+			std::mutex mutex;
+			std::deque<size_type> indices;
+		};
+
+		template <typename Task>
+		static void work(std::vector<Queue>& queues, size_type self, Task& task,
+				std::mutex& failure_mutex, std::exception_ptr& failure);
+
+		static bool pop(Queue& queue, size_type& index);
+		static bool steal(Queue& queue, size_type& index);
+
+		unsigned int threads;
+};
+
+
+template <typename Task>
+void WorkStealingPool::run(size_type size, Task& task) {
+	if (size == 0) {
+		return;
+	}
+	size_type workers = std::min<size_type>(threads, size);
+	std::vector<Queue> queues(workers);
+
+	// hands out contiguous blocks of indices
+	for (size_type w = 0; w < workers; ++w) {
+		size_type begin = size * w / workers, end = size * (w + 1) / workers;
+		for (size_type i = begin; i < end; ++i) {
+			queues[w].indices.push_back(i);
+		}
+	}
+
+	std::mutex failure_mutex;
+	std::exception_ptr failure;
+
+	std::vector<std::thread> pool;
+	pool.reserve(workers - 1);
+	for (size_type w = 1; w < workers; ++w) {
+		pool.push_back(std::thread(&WorkStealingPool::work<Task>, std::ref(queues), w,
+				std::ref(task), std::ref(failure_mutex), std::ref(failure)));
+	}
+	work(queues, 0, task, failure_mutex, failure);
+	for (std::vector<std::thread>::iterator it = pool.begin(); it != pool.end(); ++it) {
+		it->join();
+	}
+
+	if (failure) {
+		std::rethrow_exception(failure);
+	}
+}
+
+
+template <typename Task>
+void WorkStealingPool::work(std::vector<Queue>& queues, size_type self, Task& task,
+		std::mutex& failure_mutex, std::exception_ptr& failure) {
+	size_type index;
+	for (;;) {
+		bool found = pop(queues[self], index);
+		// own queue is empty: tries to steal from the others, starting
+		// with the neighbour to spread thieves over victims
+		for (size_type v = 1; !found && v < queues.size(); ++v) {
+			found = steal(queues[(self + v) % queues.size()], index);
+		}
+		// tasks don't create new tasks, so if nothing can be stolen we're done
+		if (!found) {
+			return;
+		}
+		try {
+			task(index);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(failure_mutex);
+			if (!failure) {
+				failure = std::current_exception();
+			}
+			// drops remaining work of all threads
+			for (size_type q = 0; q < queues.size(); ++q) {
+				std::lock_guard<std::mutex> queue_lock(queues[q].mutex);
+				queues[q].indices.clear();
+			}
+		}
+	}
+}
+
+
+inline bool WorkStealingPool::pop(Queue& queue, size_type& index) {
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.indices.empty()) {
+		return false;
+	}
+	index = queue.indices.front();
+	queue.indices.pop_front();
+	return true;
+}
+
+
+inline bool WorkStealingPool::steal(Queue& queue, size_type& index) {
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.indices.empty()) {
+		return false;
+	}
+	index = queue.indices.back();
+	queue.indices.pop_back();
+	return true;
+}
+
+} // namespace ims
+
+#endif // IMS_WORKSTEALINGPOOL_H
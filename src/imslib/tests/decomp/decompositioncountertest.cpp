@@ -0,0 +1,108 @@
+/**
+ * decompositioncountertest.cpp
+ */
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <ims/decomp/decompositioncounter.h>
+#include <ims/decomp/realmassdecomposer.h>
+#include <ims/decomp/decomputils.h>
+#include <ims/base/exception/invalidargumentexception.h>
+#include <ims/weights.h>
+
+#include <cmath>
+
+using namespace ims;
+
+class DecompositionCounterTest : public CppUnit::TestFixture {
+		CPPUNIT_TEST_SUITE(DecompositionCounterTest);
+		CPPUNIT_TEST(testNumberOfDecompositions);
+		CPPUNIT_TEST(testTableSize);
+		CPPUNIT_TEST(testWindowLimits);
+		CPPUNIT_TEST(testInvalid);
+		CPPUNIT_TEST_SUITE_END();
+	private:
+		DecompositionCounter::masses_type createCHNOPSMasses();
+
+	public:
+		void testNumberOfDecompositions();
+		void testTableSize();
+		void testWindowLimits();
+		void testInvalid();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DecompositionCounterTest);
+
+DecompositionCounter::masses_type DecompositionCounterTest::createCHNOPSMasses() {
+	DecompositionCounter::masses_type masses;
+	masses.push_back(1.007825);
+	masses.push_back(12.0);
+	masses.push_back(14.003074);
+	masses.push_back(15.994915);
+	masses.push_back(30.973762);
+	masses.push_back(31.972071);
+	return masses;
+}
+
+void DecompositionCounterTest::testNumberOfDecompositions() {
+	DecompositionCounter::masses_type masses = createCHNOPSMasses();
+	Weights weights(masses, 1.0e-05);
+	RealMassDecomposer decomposer(weights);
+	DecompositionCounter counter(masses, 500.0);
+	CPPUNIT_ASSERT(counter.getNumberOfTabulatedMasses() == 4);
+	for (double mass = 0.5; mass < 499.0; mass += 23.7) {
+		double errors[] = { 0.0, mass * 2.0e-06 + 1.0e-04, 0.01, 0.5 };
+		for (int i = 0; i < 4; ++i) {
+			CPPUNIT_ASSERT_EQUAL(decomposer.getNumberOfDecompositions(mass, errors[i]),
+								 counter.getNumberOfDecompositions(mass, errors[i]));
+		}
+	}
+	// the empty decomposition doesn't count
+	CPPUNIT_ASSERT(counter.getNumberOfDecompositions(0.0, 0.5) == 0);
+}
+
+void DecompositionCounterTest::testTableSize() {
+	DecompositionCounter::masses_type masses = createCHNOPSMasses();
+	Weights weights(masses, 1.0e-05);
+	RealMassDecomposer decomposer(weights);
+	DecompositionCounter counter(masses, 300.0, 10);
+	// only the lightest mass fits the table
+	CPPUNIT_ASSERT(counter.getNumberOfTabulatedMasses() == 1);
+	CPPUNIT_ASSERT(counter.getTableSize() == 298);
+	for (double mass = 10.0; mass < 299.0; mass += 17.3) {
+		CPPUNIT_ASSERT_EQUAL(decomposer.getNumberOfDecompositions(mass, 0.3),
+							 counter.getNumberOfDecompositions(mass, 0.3));
+	}
+}
+
+void DecompositionCounterTest::testWindowLimits() {
+	DecompositionCounter::masses_type masses = createCHNOPSMasses();
+	Weights weights(masses, 1.0e-05);
+	RealMassDecomposer decomposer(weights);
+	DecompositionCounter counter(masses, 500.0);
+	// windows ending exactly at the mass of a decomposition
+	const unsigned int amounts[][6] = {
+		{ 9, 5, 1, 4, 0, 0 }, { 16, 10, 5, 13, 1, 0 }, { 12, 8, 2, 3, 0, 1 }
+	};
+	for (int i = 0; i < 3; ++i) {
+		std::vector<unsigned int> decomposition(amounts[i], amounts[i] + 6);
+		double mass = DecompUtils::getParentMass(weights, decomposition);
+		double errors[] = { 0.0, 1.0e-03, 0.1 };
+		for (int j = 0; j < 3; ++j) {
+			CPPUNIT_ASSERT_EQUAL(decomposer.getNumberOfDecompositions(mass + errors[j], errors[j]),
+								 counter.getNumberOfDecompositions(mass + errors[j], errors[j]));
+			CPPUNIT_ASSERT_EQUAL(decomposer.getNumberOfDecompositions(mass - errors[j], errors[j]),
+								 counter.getNumberOfDecompositions(mass - errors[j], errors[j]));
+		}
+	}
+}
+
+void DecompositionCounterTest::testInvalid() {
+	DecompositionCounter::masses_type masses = createCHNOPSMasses();
+	DecompositionCounter counter(masses, 100.0);
+	CPPUNIT_ASSERT_THROW(counter.getNumberOfDecompositions(99.9, 0.2), InvalidArgumentException);
+	CPPUNIT_ASSERT(counter.getNumberOfDecompositions(std::sqrt(-1.0), 0.2) == 0);
+	CPPUNIT_ASSERT(counter.getNumberOfDecompositions(50.0, HUGE_VAL) == 0);
+	CPPUNIT_ASSERT_THROW(DecompositionCounter(masses, 0.0), InvalidArgumentException);
+	CPPUNIT_ASSERT_THROW(DecompositionCounter(DecompositionCounter::masses_type(), 100.0), InvalidArgumentException);
+}
@@ -8,8 +8,14 @@
 
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <sstream>
 #include <ims/decomp/integermassdecomposer.h>
+#include <ims/decomp/fastintegermassdecomposer.h>
+#include <ims/decomp/linearconstraint.h>
+#include <ims/decomp/compactresiduetable.h>
+#include <ims/decomp/residuetable.h>
 #include <ims/weights.h>
 
 using namespace ims;
@@ -22,6 +28,17 @@ class IntegerMassDecomposerTest : public CppUnit::TestFixture {
 		CPPUNIT_TEST(testGetDecomposition);
 		CPPUNIT_TEST(testGetNumberOfDecompositions);
 		CPPUNIT_TEST(testGetAllDecompositions);
+		CPPUNIT_TEST(testVisitAllDecompositions);
+		CPPUNIT_TEST(testDecompositionCursor);
+		CPPUNIT_TEST(testVisitAllDecompositionsWithinBounds);
+		CPPUNIT_TEST(testDecompositionCursorWithConstraints);
+		CPPUNIT_TEST(testVisitDecompositionsInRange);
+		CPPUNIT_TEST(testDecompositionCursorWithMassWindow);
+		CPPUNIT_TEST(testChangedLevel);
+		CPPUNIT_TEST(testVisitDecompositionSeries);
+		CPPUNIT_TEST(testGetMemoryUsage);
+		CPPUNIT_TEST(testCompactResidueTable);
+		CPPUNIT_TEST(testResidueTableLayouts);
 		CPPUNIT_TEST_SUITE_END();
 	private:
 		typedef DecomposerType decomposer_type;
@@ -51,13 +68,26 @@ class IntegerMassDecomposerTest : public CppUnit::TestFixture {
 		void testGetDecomposition();
 		void testGetNumberOfDecompositions();
 		void testGetAllDecompositions();		
+		void testVisitAllDecompositions();
+		void testDecompositionCursor();
+		void testVisitAllDecompositionsWithinBounds();
+		void testDecompositionCursorWithConstraints();
+		void testVisitDecompositionsInRange();
+		void testDecompositionCursorWithMassWindow();
+		void testChangedLevel();
+		void testVisitDecompositionSeries();
+		void testGetMemoryUsage();
+		void testCompactResidueTable();
+		void testResidueTableLayouts();
 };
 
 typedef IntegerMassDecomposerTest<IntegerMassDecomposer<> > 	DecomposerType;
 typedef IntegerMassDecomposerTest<IntegerMassDecomposer<long unsigned int, 
 				long unsigned int> > DecomposerLongDecompositionValueType;
+typedef IntegerMassDecomposerTest<FastIntegerMassDecomposer<> > FastDecomposerType;
 CPPUNIT_TEST_SUITE_REGISTRATION(DecomposerType);
 CPPUNIT_TEST_SUITE_REGISTRATION(DecomposerLongDecompositionValueType);
+CPPUNIT_TEST_SUITE_REGISTRATION(FastDecomposerType);
 
 template <typename DecomposerType>
 void IntegerMassDecomposerTest<DecomposerType>::setUp() {
@@ -164,6 +194,368 @@ void IntegerMassDecomposerTest<DecomposerType>::testGetAllDecompositions() {
 	checkDecomposition(elements6, decompositions);
 }
 
+template <typename DecompositionsType>
+class CollectingVisitor {
+	public:
+		CollectingVisitor(DecompositionsType& decompositions) : 
+			decompositions(decompositions) {}
+		void operator()(const typename DecompositionsType::value_type& decomposition) {
+			decompositions.push_back(decomposition);
+		}
+	private:
+		DecompositionsType& decompositions;
+};
+
+/**
+ * Expands series of decompositions into their members.
+ */
+template <typename DecompositionsType>
+class ExpandingSeriesVisitor {
+	public:
+		typedef typename DecompositionsType::value_type decomposition_type;
+		typedef typename decomposition_type::value_type amount_type;
+		ExpandingSeriesVisitor(DecompositionsType& decompositions) : 
+			decompositions(decompositions) {}
+		template <typename NumberType>
+		void operator()(const decomposition_type& first, amount_type step1,
+						amount_type step0, NumberType number) {
+			decomposition_type decomposition(first);
+			for (NumberType i = 0; i < number; ++i) {
+				decompositions.push_back(decomposition);
+				if (decomposition.size() > 1) {
+					decomposition[1] += step1;
+					decomposition[0] -= step0;
+				}
+			}
+		}
+	private:
+		DecompositionsType& decompositions;
+};
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testVisitAllDecompositions() {
+	decomposer_type decomposer(*weights);
+	// the recursive enumeration serves as reference for the iterative ones
+	IntegerMassDecomposer<value_type, decomposition_value_type> reference(*weights);
+	for (value_type mass = 0; mass < 200; ++mass) {
+		decompositions_type decompositions;
+		CollectingVisitor<decompositions_type> visitor(decompositions);
+		decomposer.visitAllDecompositions(mass, visitor);
+		CPPUNIT_ASSERT(decompositions == decomposer.getAllDecompositions(mass));
+
+		decompositions_type expected;
+		CollectingVisitor<decompositions_type> expected_visitor(expected);
+		reference.visitAllDecompositionsRecursively(mass, expected_visitor);
+		std::sort(decompositions.begin(), decompositions.end());
+		std::sort(expected.begin(), expected.end());
+		CPPUNIT_ASSERT(decompositions == expected);
+	}
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testDecompositionCursor() {
+	decomposer_type decomposer(*weights);
+	typename decomposer_type::DecompositionCursor cursor(decomposer);
+
+	// one cursor is reused for all masses
+	for (value_type mass = 0; mass < 200; ++mass) {
+		decompositions_type decompositions;
+		for (cursor.reset(mass); cursor.next(); ) {
+			decompositions.push_back(cursor.current());
+		}
+		CPPUNIT_ASSERT(decompositions == decomposer.getAllDecompositions(mass));
+		CPPUNIT_ASSERT(!cursor.next());
+	}
+	decompositions_type decompositions;
+	for (cursor.reset(44); cursor.next(); ) {
+		decompositions.push_back(cursor.current());
+	}
+	CPPUNIT_ASSERT(decompositions.size() == 6);
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testVisitAllDecompositionsWithinBounds() {
+	decomposer_type decomposer(*weights);
+	const decomposition_value_type unbounded = decomposer_type::getUnboundedAmount();
+
+	// lower bounds, upper bounds: free, upper only, lower only, 
+	// both, zero upper bound, unsatisfiable
+	const decomposition_value_type bounds[][8] = {
+		{0, 0, 0, 0,	unbounded, unbounded, unbounded, unbounded},
+		{0, 0, 0, 0,	3, unbounded, 1, 2},
+		{1, 0, 2, 0,	unbounded, unbounded, unbounded, unbounded},
+		{1, 1, 0, 1,	4, 2, unbounded, 1},
+		{0, 0, 0, 0,	unbounded, 0, unbounded, 0},
+		{2, 0, 0, 0,	1, unbounded, unbounded, unbounded}
+	};
+
+	for (size_t b = 0; b < sizeof(bounds) / sizeof(bounds[0]); ++b) {
+		decomposition_type lower_bounds(bounds[b], bounds[b] + 4);
+		decomposition_type upper_bounds(bounds[b] + 4, bounds[b] + 8);
+		for (value_type mass = 0; mass < 200; ++mass) {
+			decompositions_type decompositions;
+			CollectingVisitor<decompositions_type> visitor(decompositions);
+			decomposer.visitAllDecompositions(mass, lower_bounds, upper_bounds, visitor);
+
+			// filters all decompositions by the bounds
+			decompositions_type expected;
+			decompositions_type all_decompositions = decomposer.getAllDecompositions(mass);
+			for (typename decompositions_type::const_iterator it = all_decompositions.begin();
+					it != all_decompositions.end(); ++it) {
+				bool within_bounds = true;
+				for (size_t i = 0; i < it->size(); ++i) {
+					if ((*it)[i] < lower_bounds[i] || (*it)[i] > upper_bounds[i]) {
+						within_bounds = false;
+					}
+				}
+				if (within_bounds) {
+					expected.push_back(*it);
+				}
+			}
+			std::sort(decompositions.begin(), decompositions.end());
+			std::sort(expected.begin(), expected.end());
+			CPPUNIT_ASSERT(decompositions == expected);
+		}
+	}
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testDecompositionCursorWithConstraints() {
+	decomposer_type decomposer(*weights);
+	typename decomposer_type::DecompositionCursor cursor(decomposer);
+
+	// a DBE-like constraint and a ratio window: amount 1 <= 2 * amount 0
+	const double coefficients[][4] = {{-0.5, 1.0, 0.5, 0.0}, {-2.0, 1.0, 0.0, 0.0}};
+	std::vector<LinearConstraint> constraints;
+	constraints.push_back(LinearConstraint(
+		LinearConstraint::coefficients_type(coefficients[0], coefficients[0] + 4), -1.0, 2.5));
+	constraints.push_back(LinearConstraint(
+		LinearConstraint::coefficients_type(coefficients[1], coefficients[1] + 4), -1000.0, 0.0));
+	for (size_t c = 0; c < constraints.size(); ++c) {
+		cursor.addConstraint(constraints[c]);
+	}
+
+	// with and without bounds
+	decomposition_type lower_bounds(4, 0), upper_bounds(4, decomposer_type::getUnboundedAmount());
+	lower_bounds[3] = 1;
+	upper_bounds[0] = 6;
+
+	for (int bounded = 0; bounded < 2; ++bounded) {
+		if (bounded) {
+			cursor.setBounds(lower_bounds, upper_bounds);
+		}
+		size_t number_of_decompositions = 0;
+		for (value_type mass = 0; mass < 300; ++mass) {
+			decompositions_type decompositions;
+			for (cursor.reset(mass); cursor.next(); ) {
+				decompositions.push_back(cursor.current());
+			}
+
+			decompositions_type expected;
+			decompositions_type all_decompositions = decomposer.getAllDecompositions(mass);
+			for (typename decompositions_type::const_iterator it = all_decompositions.begin();
+					it != all_decompositions.end(); ++it) {
+				bool admissible = true;
+				for (size_t c = 0; c < constraints.size(); ++c) {
+					admissible = admissible && constraints[c].isSatisfied(*it);
+				}
+				for (size_t i = 0; bounded && i < it->size(); ++i) {
+					admissible = admissible && (*it)[i] >= lower_bounds[i] && 
+											   (*it)[i] <= upper_bounds[i];
+				}
+				if (admissible) {
+					expected.push_back(*it);
+				}
+			}
+			std::sort(decompositions.begin(), decompositions.end());
+			std::sort(expected.begin(), expected.end());
+			CPPUNIT_ASSERT(decompositions == expected);
+			number_of_decompositions += decompositions.size();
+		}
+		CPPUNIT_ASSERT(number_of_decompositions > 0);
+	}
+
+	cursor.clearConstraints();
+	cursor.clearBounds();
+	decompositions_type decompositions;
+	for (cursor.reset(44); cursor.next(); ) {
+		decompositions.push_back(cursor.current());
+	}
+	CPPUNIT_ASSERT(decompositions.size() == 6);
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testVisitDecompositionsInRange() {
+	decomposer_type decomposer(*weights);
+	typename decomposer_type::DecompositionCursor cursor(decomposer);
+
+	const double coefficients[] = {-0.5, 1.0, 0.5, 0.0};
+	LinearConstraint constraint(
+		LinearConstraint::coefficients_type(coefficients, coefficients + 4), -1.0, 2.5);
+	decomposition_type lower_bounds(4, 0), upper_bounds(4, decomposer_type::getUnboundedAmount());
+	lower_bounds[2] = 1;
+	upper_bounds[0] = 4;
+
+	// free, bounded, bounded and constrained
+	for (int restricted = 0; restricted < 3; ++restricted) {
+		if (restricted == 1) {
+			cursor.setBounds(lower_bounds, upper_bounds);
+		} else if (restricted == 2) {
+			cursor.addConstraint(constraint);
+		}
+		for (value_type low = 0; low < 150; low += 7) {
+			for (value_type width = 0; width < 40; width += 13) {
+				// the masses of the range one after another
+				decompositions_type expected;
+				for (value_type mass = low; mass <= low + width; ++mass) {
+					for (cursor.reset(mass); cursor.next(); ) {
+						expected.push_back(cursor.current());
+					}
+				}
+				decompositions_type decompositions;
+				for (cursor.reset(low, low + width); cursor.next(); ) {
+					decompositions.push_back(cursor.current());
+				}
+				CPPUNIT_ASSERT(!cursor.next());
+				std::sort(decompositions.begin(), decompositions.end());
+				std::sort(expected.begin(), expected.end());
+				CPPUNIT_ASSERT(decompositions == expected);
+
+				cursor.reset(low, low + width);
+				CPPUNIT_ASSERT(cursor.count() == expected.size());
+				CPPUNIT_ASSERT(!cursor.next());
+
+				if (restricted == 0) {
+					decompositions_type visited;
+					CollectingVisitor<decompositions_type> visitor(visited);
+					decomposer.visitDecompositionsInRange(low, low + width, visitor);
+					std::sort(visited.begin(), visited.end());
+					CPPUNIT_ASSERT(visited == expected);
+				}
+			}
+		}
+	}
+
+	// an empty range
+	cursor.reset(10, 9);
+	CPPUNIT_ASSERT(!cursor.next());
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testChangedLevel() {
+	decomposer_type decomposer(*weights);
+	typename decomposer_type::DecompositionCursor cursor(decomposer);
+
+	const double coefficients[] = {-0.5, 1.0, 0.5, 0.0};
+	LinearConstraint constraint(
+		LinearConstraint::coefficients_type(coefficients, coefficients + 4), -1.0, 2.5);
+	decomposition_type lower_bounds(4, 0), upper_bounds(4, decomposer_type::getUnboundedAmount());
+	lower_bounds[2] = 1;
+	upper_bounds[0] = 4;
+
+	// free, bounded and constrained; single masses and ranges
+	for (int restricted = 0; restricted < 2; ++restricted) {
+		if (restricted == 1) {
+			cursor.setBounds(lower_bounds, upper_bounds);
+			cursor.addConstraint(constraint);
+		}
+		for (value_type mass = 0; mass < 200; mass += 3) {
+			for (int ranged = 0; ranged < 2; ++ranged) {
+				if (ranged == 0) {
+					cursor.reset(mass);
+				} else {
+					cursor.reset(mass, mass + 20);
+				}
+				decomposition_type previous;
+				while (cursor.next()) {
+					const decomposition_type& current = cursor.current();
+					if (previous.empty()) {
+						CPPUNIT_ASSERT(cursor.getChangedLevel() == current.size() - 1);
+					}
+					// the amounts above the changed level are the same
+					for (size_t i = cursor.getChangedLevel() + 1; i < previous.size(); ++i) {
+						CPPUNIT_ASSERT(current[i] == previous[i]);
+					}
+					previous = current;
+				}
+			}
+		}
+	}
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testDecompositionCursorWithMassWindow() {
+	// CHNO with rounding errors, unlike the weights of setUp()
+	alphabet_masses_type masses;
+	masses.push_back(1.007825);
+	masses.push_back(12.0);
+	masses.push_back(14.003074);
+	masses.push_back(15.994915);
+	Weights chno(masses, 0.01);
+	decomposer_type decomposer(chno);
+	typename decomposer_type::DecompositionCursor cursor(decomposer);
+
+	const double coefficients[] = {-0.5, 1.0, 0.5, 0.0};
+	LinearConstraint constraint(
+		LinearConstraint::coefficients_type(coefficients, coefficients + 4), -1.0, 20.5);
+	decomposition_type lower_bounds(4, 0), upper_bounds(4, decomposer_type::getUnboundedAmount());
+	lower_bounds[3] = 1;
+	upper_bounds[2] = 3;
+
+	// free, bounded, bounded and constrained
+	for (int restricted = 0; restricted < 3; ++restricted) {
+		if (restricted == 1) {
+			cursor.setBounds(lower_bounds, upper_bounds);
+		} else if (restricted == 2) {
+			cursor.addConstraint(constraint);
+		}
+		size_t number_of_decompositions = 0;
+		for (double mass = 50.0; mass < 400.0; mass += 23.71) {
+			const double error = 0.02;
+			value_type low = static_cast<value_type>((mass - error) / 0.0101);
+			value_type high = static_cast<value_type>((mass + error) / 0.0099);
+
+			// all decompositions of the range filtered by their real mass
+			cursor.clearMassWindow();
+			decompositions_type expected;
+			for (cursor.reset(low, high); cursor.next(); ) {
+				double real_mass = 0.0;
+				for (size_t i = 0; i < masses.size(); ++i) {
+					real_mass += cursor.current()[i] * masses[i];
+				}
+				if (std::fabs(real_mass - mass) <= error) {
+					expected.push_back(cursor.current());
+				}
+			}
+			std::sort(expected.begin(), expected.end());
+
+			cursor.setMassWindow(mass, error);
+			decompositions_type decompositions;
+			for (cursor.reset(low, high); cursor.next(); ) {
+				decompositions.push_back(cursor.current());
+				CPPUNIT_ASSERT(std::fabs(cursor.getMass() - mass) <= error);
+			}
+			std::sort(decompositions.begin(), decompositions.end());
+			CPPUNIT_ASSERT(decompositions == expected);
+
+			cursor.reset(low, high);
+			CPPUNIT_ASSERT(cursor.count() == expected.size());
+
+			// the masses of the range one after another
+			decompositions.clear();
+			for (value_type integer_mass = low; integer_mass <= high; ++integer_mass) {
+				for (cursor.reset(integer_mass); cursor.next(); ) {
+					decompositions.push_back(cursor.current());
+				}
+			}
+			std::sort(decompositions.begin(), decompositions.end());
+			CPPUNIT_ASSERT(decompositions == expected);
+			number_of_decompositions += expected.size();
+		}
+		CPPUNIT_ASSERT(number_of_decompositions > 0);
+	}
+}
+
 template <typename DecomposerType>
 void IntegerMassDecomposerTest<DecomposerType>::
 checkDecomposition(const decomposition_value_type* elements, 
@@ -188,3 +580,130 @@ checkDecomposition(const decomposition_value_type* elements,
 	CPPUNIT_ASSERT(decompositionPos2 == decompositions.end());		
 }
 
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testVisitDecompositionSeries() {
+	decomposer_type decomposer(*weights);
+	for (value_type mass = 0; mass < 200; ++mass) {
+		decompositions_type decompositions = decomposer.getAllDecompositions(mass);
+		CPPUNIT_ASSERT(decomposer.getNumberOfDecompositions(mass) == 
+						decompositions.size());
+
+		decompositions_type expanded;
+		ExpandingSeriesVisitor<decompositions_type> visitor(expanded);
+		decomposer.visitDecompositionSeries(mass, visitor);
+		std::sort(decompositions.begin(), decompositions.end());
+		std::sort(expanded.begin(), expanded.end());
+		CPPUNIT_ASSERT(expanded == decompositions);
+	}
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testGetMemoryUsage() {
+	decomposer_type decomposer(*weights);
+	// at least one column of the residue table
+	CPPUNIT_ASSERT(decomposer.getMemoryUsage() > 
+					weights->getWeight(0) * sizeof(unsigned int));
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testCompactResidueTable() {
+	typedef CompactResidueTable<value_type> table_type;
+	const value_type smallest_mass = 6, infty = 1000;
+
+	table_type table;
+	table.reset(smallest_mass, infty, 3);
+	typename table_type::column_type column(smallest_mass, infty);
+	column[0] = 0;
+	column[1] = 7;
+	column[4] = 994;
+	table.appendColumn(column);
+	column[3] = 9;
+	table.appendColumn(column);
+	table.repeatColumn();
+
+	CPPUNIT_ASSERT(table.getNumberOfColumns() == 3);
+	CPPUNIT_ASSERT(table.getNumberOfStoredColumns() == 2);
+	CPPUNIT_ASSERT(table.getColumn(2) == table.getColumn(1));
+	for (typename table_type::size_type c = 0; c < table.getNumberOfColumns(); ++c) {
+		// columns start on cache lines
+		CPPUNIT_ASSERT(reinterpret_cast<std::size_t>(table.getColumn(c)) % 64 == 0);
+		CPPUNIT_ASSERT(table.get(c, 0) == 0);
+		CPPUNIT_ASSERT(table.get(c, 1) == 7);
+		CPPUNIT_ASSERT(table.get(c, 2) == infty);
+		CPPUNIT_ASSERT(table.get(c, 4) == 994);
+	}
+	CPPUNIT_ASSERT(table.get(0, 3) == infty);
+	CPPUNIT_ASSERT(table.get(1, 3) == 9);
+
+	// minima of the stored quotients
+	CPPUNIT_ASSERT(table.getMinimum(0, 0, 5) == 0);
+	CPPUNIT_ASSERT(table.getMinimum(0, 2, 3) == table_type::getEmptyEntry());
+	CPPUNIT_ASSERT(table.getMinimum(0, 2, 4) == 165);
+	CPPUNIT_ASSERT(table.getMinimum(2, 2, 4) == 1);
+
+	table_type copy(table);
+	CPPUNIT_ASSERT(reinterpret_cast<std::size_t>(copy.getColumn(0)) % 64 == 0);
+	CPPUNIT_ASSERT(copy.get(2, 3) == 9);
+	CPPUNIT_ASSERT(copy.getMinimum(2, 2, 4) == 1);
+
+	// the index is read with the entries
+	std::stringstream stream;
+	ResidueTableFormat::Writer writer(stream);
+	table.write(writer);
+	MappedFile contents(stream);
+	ResidueTableFormat::Reader reader(contents);
+	table_type loaded;
+	loaded.read(reader);
+	for (typename table_type::size_type c = 0; c < table.getNumberOfColumns(); ++c) {
+		for (value_type first = 0; first < smallest_mass; ++first) {
+			for (value_type last = first; last < smallest_mass; ++last) {
+				CPPUNIT_ASSERT(loaded.getMinimum(c, first, last) == 
+								table.getMinimum(c, first, last));
+			}
+		}
+	}
+
+	// quotients too large for the entries
+	CPPUNIT_ASSERT_THROW(table.reset(1, static_cast<value_type>(
+		table_type::getEmptyEntry()) + 1, 1), InvalidArgumentException);
+}
+
+template <typename DecomposerType>
+void IntegerMassDecomposerTest<DecomposerType>::testResidueTableLayouts() {
+	typedef ResidueTable<value_type, decomposition_value_type> residue_table_type;
+	typedef typename residue_table_type::row_type row_type;
+
+	// 15 = 6 + 9 is composable, so the last column repeats the one before
+	alphabet_masses_type masses;
+	masses.push_back(0.6);
+	masses.push_back(0.9);
+	masses.push_back(1.1);
+	masses.push_back(1.5);
+	Weights repeating(masses, 0.1);
+	value_type infty = repeating.getWeight(0) * repeating.getWeight(repeating.size() - 1);
+
+	row_type lcms(repeating.size()), mass_in_lcms(repeating.size());
+	row_type compact_lcms(repeating.size()), compact_mass_in_lcms(repeating.size());
+	typename residue_table_type::witness_vector_type witnesses, compact_witnesses;
+
+	typename residue_table_type::table_type table;
+	ResidueColumns<value_type> columns(table);
+	residue_table_type::fill(repeating, infty, lcms, mass_in_lcms, witnesses, columns);
+	CompactResidueTable<value_type> compact;
+	residue_table_type::fill(repeating, infty, compact_lcms, compact_mass_in_lcms,
+		compact_witnesses, compact);
+
+	CPPUNIT_ASSERT(table.size() == repeating.size());
+	CPPUNIT_ASSERT(compact.getNumberOfColumns() == repeating.size());
+	CPPUNIT_ASSERT(compact.getNumberOfStoredColumns() == repeating.size() - 1);
+	CPPUNIT_ASSERT(lcms == compact_lcms);
+	CPPUNIT_ASSERT(mass_in_lcms == compact_mass_in_lcms);
+	CPPUNIT_ASSERT(witnesses == compact_witnesses);
+	for (std::size_t c = 0; c < table.size(); ++c) {
+		for (value_type r = 0; r < repeating.getWeight(0); ++r) {
+			CPPUNIT_ASSERT(table[c][r] == compact.get(c, r));
+		}
+	}
+	CPPUNIT_ASSERT(table[1][3] == 9);
+	CPPUNIT_ASSERT(table[0][3] == infty);
+}
@@ -0,0 +1,96 @@
+/**
+ * precisionselectortest.cpp
+ */
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <vector>
+#include <algorithm>
+#include <ims/decomp/precisionselector.h>
+#include <ims/decomp/realmassdecomposer.h>
+#include <ims/base/exception/invalidargumentexception.h>
+#include <ims/weights.h>
+
+using namespace ims;
+
+class PrecisionSelectorTest : public CppUnit::TestFixture {
+		CPPUNIT_TEST_SUITE(PrecisionSelectorTest);
+		CPPUNIT_TEST(testSelect);
+		CPPUNIT_TEST(testNumberOfQueries);
+		CPPUNIT_TEST(testSameDecompositions);
+		CPPUNIT_TEST(testInfeasible);
+		CPPUNIT_TEST_SUITE_END();
+	private:
+		typedef RealMassDecomposer::decompositions_type decompositions_type;
+
+		PrecisionSelector::masses_type createCHNOPSMasses();
+
+	public:
+		void testSelect();
+		void testNumberOfQueries();
+		void testSameDecompositions();
+		void testInfeasible();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PrecisionSelectorTest);
+
+PrecisionSelector::masses_type PrecisionSelectorTest::createCHNOPSMasses() {
+	PrecisionSelector::masses_type masses;
+	masses.push_back(1.007825);
+	masses.push_back(12.0);
+	masses.push_back(14.003074);
+	masses.push_back(15.994915);
+	masses.push_back(30.973762);
+	masses.push_back(31.972071);
+	return masses;
+}
+
+void PrecisionSelectorTest::testSelect() {
+	PrecisionSelector selector(createCHNOPSMasses());
+	selector.setNumberOfQueries(1.0e06);
+	double precision = selector.select();
+
+	std::vector<double> candidates = PrecisionSelector::getCandidates();
+	CPPUNIT_ASSERT(std::find(candidates.begin(), candidates.end(), precision) != candidates.end());
+	for (std::vector<double>::size_type i = 0; i < candidates.size(); ++i) {
+		double cost = selector.getCost(candidates[i]);
+		CPPUNIT_ASSERT(cost < 0.0 || cost >= selector.getCost(precision));
+	}
+	// the residue table alone doesn't decide
+	CPPUNIT_ASSERT(precision < 1.0e-04);
+}
+
+void PrecisionSelectorTest::testNumberOfQueries() {
+	PrecisionSelector selector(createCHNOPSMasses());
+	selector.setNumberOfQueries(1.0e06);
+	double many_queries = selector.select();
+	selector.setNumberOfQueries(1.0);
+	double one_query = selector.select();
+	// building the table pays off only for many queries
+	CPPUNIT_ASSERT(one_query >= many_queries);
+}
+
+void PrecisionSelectorTest::testSameDecompositions() {
+	PrecisionSelector::masses_type masses = createCHNOPSMasses();
+	PrecisionSelector selector(masses);
+	selector.setMassRange(100.0, 400.0, 5.0);
+	RealMassDecomposer selected(Weights(masses, selector.select()));
+	RealMassDecomposer fixed(Weights(masses, 1.0e-05));
+	for (double mass = 100.0; mass < 400.0; mass += 37.01) {
+		double error = mass * 5.0e-06;
+		decompositions_type expected = fixed.getDecompositions(mass, error);
+		decompositions_type decompositions = selected.getDecompositions(mass, error);
+		std::sort(expected.begin(), expected.end());
+		std::sort(decompositions.begin(), decompositions.end());
+		CPPUNIT_ASSERT(decompositions == expected);
+	}
+}
+
+void PrecisionSelectorTest::testInfeasible() {
+	PrecisionSelector selector(createCHNOPSMasses());
+	CPPUNIT_ASSERT(selector.getCost(1.0e-06) >= 0.0);
+	selector.setMaxTableSize(10.0);
+	CPPUNIT_ASSERT(selector.getCost(1.0e-06) < 0.0);
+	CPPUNIT_ASSERT_THROW(selector.select(), InvalidArgumentException);
+	CPPUNIT_ASSERT_THROW(PrecisionSelector(PrecisionSelector::masses_type()), InvalidArgumentException);
+}
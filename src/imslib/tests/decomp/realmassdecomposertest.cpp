@@ -10,6 +10,10 @@
 #include <ims/decomp/realmassdecomposer.h>
 #include <ims/decomp/decomputils.h>
 
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
 
 using namespace std;
 using namespace ims;
@@ -17,18 +21,45 @@ using namespace ims;
 class RealMassDecomposerTest : public CppUnit::TestFixture {
 		CPPUNIT_TEST_SUITE(RealMassDecomposerTest);
 		CPPUNIT_TEST(testGetDecompositions);
+		CPPUNIT_TEST(testVisitDecompositions);
+		CPPUNIT_TEST(testFastIntegerDecomposer);
+		CPPUNIT_TEST(testVisitDecompositionsWithinBounds);
+		CPPUNIT_TEST(testGetClosestDecompositions);
+		CPPUNIT_TEST(testInvalidMasses);
 		CPPUNIT_TEST_SUITE_END();
 	private:
 		typedef RealMassDecomposer decomposer_type;
 		typedef decomposer_type::decompositions_type decompositions_type;
+		typedef decomposer_type::decomposition_type decomposition_type;
+
+		/**
+		 * Collects visited decompositions.
+		 */
+		class CollectingVisitor {
+			public:
+				CollectingVisitor(decompositions_type& decompositions) : 
+					decompositions(decompositions) {}
+				void operator()(const decomposition_type& decomposition) {
+					decompositions.push_back(decomposition);
+				}
+			private:
+				decompositions_type& decompositions;
+		};
+
+		Weights createCHNOPSWeights();
 
 	public:
 		void testGetDecompositions();
+		void testVisitDecompositions();
+		void testFastIntegerDecomposer();
+		void testVisitDecompositionsWithinBounds();
+		void testGetClosestDecompositions();
+		void testInvalidMasses();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(RealMassDecomposerTest);
 
-void RealMassDecomposerTest::testGetDecompositions() {
+Weights RealMassDecomposerTest::createCHNOPSWeights() {
 	typedef Weights::alphabet_mass_type alphabet_mass_type;
 	typedef Weights::alphabet_masses_type alphabet_masses_type;
 
@@ -44,7 +75,11 @@ void RealMassDecomposerTest::testGetDecompositions() {
 	mono_masses.push_back(mono_mass_P);
 	mono_masses.push_back(mono_mass_S);
 
-	Weights alphabet_weights(mono_masses, 0.00001);
+	return Weights(mono_masses, 0.00001);
+}
+
+void RealMassDecomposerTest::testGetDecompositions() {
+	Weights alphabet_weights = createCHNOPSWeights();
 
 	decomposer_type decomposer(alphabet_weights);
 
@@ -60,3 +95,133 @@ void RealMassDecomposerTest::testGetDecompositions() {
 		}
 	}
 }
+
+void RealMassDecomposerTest::testVisitDecompositions() {
+	Weights alphabet_weights = createCHNOPSWeights();
+
+	decomposer_type decomposer(alphabet_weights);
+	decomposer_type::DecompositionCursor cursor(decomposer);
+
+	double step = 100.0, firstMass = 100.0, lastMass = 800.0, error = 0.001;
+	for (double mass = firstMass; mass < lastMass; mass += step) {
+		decompositions_type decompositions = 
+				decomposer.getDecompositions(mass, error);
+		CPPUNIT_ASSERT(!decompositions.empty());
+
+		decompositions_type visited;
+		CollectingVisitor visitor(visited);
+		decomposer.visitDecompositions(mass, error, visitor);
+		CPPUNIT_ASSERT(visited == decompositions);
+
+		decompositions_type iterated;
+		for (cursor.reset(mass, error); cursor.next(); ) {
+			iterated.push_back(cursor.current());
+		}
+		CPPUNIT_ASSERT(iterated == decompositions);
+
+		CPPUNIT_ASSERT(decomposer.getNumberOfDecompositions(mass, error) == 
+						decompositions.size());
+	}
+}
+
+void RealMassDecomposerTest::testFastIntegerDecomposer() {
+	Weights alphabet_weights = createCHNOPSWeights();
+
+	decomposer_type decomposer(alphabet_weights);
+	BasicRealMassDecomposer<FastIntegerMassDecomposer<> > 
+		fast_decomposer(alphabet_weights);
+
+	double step = 100.0, firstMass = 100.0, lastMass = 800.0, error = 0.001;
+	for (double mass = firstMass; mass < lastMass; mass += step) {
+		decompositions_type decompositions = 
+				decomposer.getDecompositions(mass, error);
+		decompositions_type fast_decompositions = 
+				fast_decomposer.getDecompositions(mass, error);
+		// back ends may enumerate in different orders
+		sort(decompositions.begin(), decompositions.end());
+		sort(fast_decompositions.begin(), fast_decompositions.end());
+		CPPUNIT_ASSERT(fast_decompositions == decompositions);
+	}
+}
+
+void RealMassDecomposerTest::testVisitDecompositionsWithinBounds() {
+	Weights alphabet_weights = createCHNOPSWeights();
+
+	decomposer_type decomposer(alphabet_weights);
+	const decomposer_type::decomposition_value_type unbounded = 
+		decomposer_type::getUnboundedAmount();
+
+	// order of weights: H, C, N, O, P, S; at least one N, at most 
+	// two P and no S
+	decomposition_type lower_bounds(6, 0), upper_bounds(6, unbounded);
+	lower_bounds[2] = 1;
+	upper_bounds[4] = 2;
+	upper_bounds[5] = 0;
+
+	double step = 100.0, firstMass = 100.0, lastMass = 800.0, error = 0.001;
+	for (double mass = firstMass; mass < lastMass; mass += step) {
+		decompositions_type decompositions = 
+				decomposer.getDecompositions(mass, error);
+		decompositions_type expected;
+		for (decompositions_type::iterator pos = decompositions.begin();
+			 						pos != decompositions.end(); ++pos) {
+			if ((*pos)[2] >= 1 && (*pos)[4] <= 2 && (*pos)[5] == 0) {
+				expected.push_back(*pos);
+			}
+		}
+		CPPUNIT_ASSERT(expected.size() < decompositions.size());
+
+		decompositions_type visited;
+		CollectingVisitor visitor(visited);
+		decomposer.visitDecompositions(mass, error, lower_bounds, upper_bounds, visitor);
+		sort(visited.begin(), visited.end());
+		sort(expected.begin(), expected.end());
+		CPPUNIT_ASSERT(visited == expected);
+	}
+}
+
+void RealMassDecomposerTest::testGetClosestDecompositions() {
+	Weights alphabet_weights = createCHNOPSWeights();
+
+	decomposer_type decomposer(alphabet_weights);
+
+	double step = 100.0, firstMass = 100.0, lastMass = 1000.0, error = 0.001;
+	for (double mass = firstMass; mass < lastMass; mass += step) {
+		// all decompositions ordered by distance, then by amounts
+		decompositions_type decompositions = 
+				decomposer.getDecompositions(mass, error);
+		vector<pair<double, decomposition_type> > ordered;
+		for (decompositions_type::iterator pos = decompositions.begin();
+			 						pos != decompositions.end(); ++pos) {
+			double distance = fabs(DecompUtils::getParentMass(alphabet_weights, *pos) - mass);
+			ordered.push_back(make_pair(distance, *pos));
+		}
+		sort(ordered.begin(), ordered.end());
+
+		const decomposer_type::size_type numbers[] = { 0, 1, 5, 20, 100000 };
+		for (int i = 0; i < 5; ++i) {
+			decompositions_type closest = 
+				decomposer.getClosestDecompositions(mass, error, numbers[i]);
+			CPPUNIT_ASSERT(closest.size() == min(numbers[i], decompositions.size()));
+			for (decompositions_type::size_type j = 0; j < closest.size(); ++j) {
+				CPPUNIT_ASSERT(closest[j] == ordered[j].second);
+			}
+		}
+	}
+}
+
+void RealMassDecomposerTest::testInvalidMasses() {
+	Weights alphabet_weights = createCHNOPSWeights();
+
+	decomposer_type decomposer(alphabet_weights);
+
+	// masses and errors without decompositions return at once
+	double nan = sqrt(-1.0), inf = HUGE_VAL;
+	const double masses[] = { nan, 147.0529, inf, 147.0529, -147.0529, 0.0 };
+	const double errors[] = { 0.0004, nan, 0.0004, inf, 0.0004, 0.0 };
+	for (int i = 0; i < 6; ++i) {
+		CPPUNIT_ASSERT(decomposer.getDecompositions(masses[i], errors[i]).empty());
+		CPPUNIT_ASSERT(decomposer.getNumberOfDecompositions(masses[i], errors[i]) == 0);
+		CPPUNIT_ASSERT(decomposer.getClosestDecompositions(masses[i], errors[i], 5).empty());
+	}
+}
@@ -0,0 +1,155 @@
+/**
+ * residuecolumnfillertest.cpp
+ */
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <vector>
+#include <ims/decomp/residuecolumnfiller.h>
+#include <ims/decomp/integermassdecomposer.h>
+#include <ims/decomp/fastintegermassdecomposer.h>
+#include <ims/weights.h>
+
+using namespace ims;
+
+class ResidueColumnFillerTest : public CppUnit::TestFixture {
+		CPPUNIT_TEST_SUITE(ResidueColumnFillerTest);
+		CPPUNIT_TEST(testFillSequentially);
+		CPPUNIT_TEST(testFillMultiples);
+		CPPUNIT_TEST(testSameAsSequential);
+		CPPUNIT_TEST(testDecomposers);
+		CPPUNIT_TEST_SUITE_END();
+	private:
+		typedef ResidueColumnFiller<unsigned long, unsigned int> filler_type;
+		typedef filler_type::column_type column_type;
+		typedef filler_type::witness_vector_type witness_vector_type;
+
+		column_type createColumn(unsigned long size, unsigned long mass);
+
+		void checkDecompositions(const Weights& weights, unsigned long max_mass,
+								 unsigned long mass_step);
+	public:
+		void testFillSequentially();
+		void testFillMultiples();
+		void testSameAsSequential();
+		void testDecomposers();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ResidueColumnFillerTest);
+
+/**
+ * Creates a previous column with few different pseudo random masses, so
+ * that recurrences often tie.
+ */
+ResidueColumnFillerTest::column_type
+ResidueColumnFillerTest::createColumn(unsigned long size, unsigned long mass) {
+	column_type column(size);
+	unsigned long value = 12345;
+	for (unsigned long r = 1; r < size; ++r) {
+		value = (value * 1103515245UL + 12345UL) % 2147483648UL;
+		column[r] = (value % 7 + 1) * mass + value % 2;
+	}
+	column[0] = 0;
+	return column;
+}
+
+void ResidueColumnFillerTest::testFillSequentially() {
+	const unsigned long size = 60;
+	for (unsigned long mass = 1; mass < 150; ++mass) {
+		column_type prev_column = createColumn(size, mass), column(size);
+		witness_vector_type witnesses(size, std::make_pair(0, 0));
+		filler_type::fillSequentially(prev_column, column, witnesses, 2, mass);
+		for (unsigned long p = 0; p < size; ++p) {
+			// smallest mass in the residue class using mass
+			unsigned long expected = prev_column[p];
+			for (unsigned long j = 1; j < size; ++j) {
+				expected = std::min(expected, prev_column[(p + size - mass * j % size) % size] + j * mass);
+			}
+			CPPUNIT_ASSERT_EQUAL(expected, column[p]);
+			if (witnesses[p].first == 2) {
+				unsigned long j = witnesses[p].second;
+				CPPUNIT_ASSERT(j > 0);
+				CPPUNIT_ASSERT_EQUAL(column[p], prev_column[(p + size - mass * j % size) % size] + j * mass);
+			} else {
+				CPPUNIT_ASSERT_EQUAL(prev_column[p], column[p]);
+			}
+		}
+	}
+}
+
+void ResidueColumnFillerTest::testFillMultiples() {
+	const unsigned long size = 60, infty = 100000;
+	for (unsigned long mass = 1; mass < 150; ++mass) {
+		column_type prev_column(size, infty), column(size, infty), sequential_column(size);
+		prev_column[0] = column[0] = 0;
+		witness_vector_type witnesses(size), sequential_witnesses(size);
+		filler_type::fillMultiples(column, witnesses, 1, mass);
+		filler_type::fillSequentially(prev_column, sequential_column, sequential_witnesses, 1, mass);
+		CPPUNIT_ASSERT(column == sequential_column);
+		CPPUNIT_ASSERT(witnesses == sequential_witnesses);
+	}
+}
+
+void ResidueColumnFillerTest::testSameAsSequential() {
+	const unsigned long sizes[] = { 640, 1009, 4096, 10007 };
+	const filler_type::size_type lanes[] = { 2, 3, 7, 64, filler_type::DEFAULT_LANES };
+	for (int s = 0; s < 4; ++s) {
+		unsigned long size = sizes[s];
+		for (unsigned long mass = size / 7; mass < 3 * size; mass += size / 5 + 1) {
+			column_type prev_column = createColumn(size, mass);
+			column_type expected_column(size);
+			witness_vector_type expected_witnesses(size);
+			filler_type::fillSequentially(prev_column, expected_column, expected_witnesses, 2, mass);
+			for (int l = 0; l < 5; ++l) {
+				filler_type filler;
+				filler.setNumberOfLanes(lanes[l]);
+				filler.setMinColumnSize(0);
+				column_type column(size);
+				witness_vector_type witnesses(size);
+				filler.fill(prev_column, column, witnesses, 2, mass);
+				CPPUNIT_ASSERT(column == expected_column);
+				CPPUNIT_ASSERT(witnesses == expected_witnesses);
+			}
+		}
+	}
+}
+
+/**
+ * Checks that the witnesses lead to a decomposition of every decomposable
+ * mass, and that the decomposers agree.
+ */
+void ResidueColumnFillerTest::checkDecompositions(const Weights& weights,
+		unsigned long max_mass, unsigned long mass_step) {
+	IntegerMassDecomposer<> decomposer(weights);
+	FastIntegerMassDecomposer<> fast_decomposer(weights);
+	for (unsigned long mass = 0; mass < max_mass; mass += mass_step) {
+		IntegerMassDecomposer<>::decomposition_type decomposition =
+			decomposer.getDecomposition(mass);
+		CPPUNIT_ASSERT(decomposition.empty() != decomposer.exist(mass));
+		CPPUNIT_ASSERT(fast_decomposer.getDecomposition(mass) == decomposition);
+		if (decomposition.empty()) {
+			continue;
+		}
+		unsigned long sum = 0;
+		for (Weights::size_type i = 0; i < weights.size(); ++i) {
+			sum += decomposition[i] * weights.getWeight(i);
+		}
+		CPPUNIT_ASSERT_EQUAL(mass, sum);
+	}
+}
+
+void ResidueColumnFillerTest::testDecomposers() {
+	Weights::alphabet_masses_type masses;
+	masses.push_back(1.007825);
+	masses.push_back(12.0);
+	masses.push_back(14.003074);
+	masses.push_back(15.994915);
+	masses.push_back(30.973762);
+	masses.push_back(31.972071);
+
+	// columns with a gcd of 2 and 1, residue 3 (118947) once had a witness
+	// with an amount of 0
+	checkDecompositions(Weights(masses, 0.001), 150000, 1);
+	// columns of 1007825 residues are filled in lanes, with a gcd of 25, 5 and 1
+	checkDecompositions(Weights(masses, 0.000001), 30000000, 99991);
+}
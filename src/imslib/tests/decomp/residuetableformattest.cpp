@@ -0,0 +1,154 @@
+/**
+ * residuetableformattest.cpp
+ */
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+#include <ims/decomp/integermassdecomposer.h>
+#include <ims/decomp/realmassdecomposer.h>
+#include <ims/decomp/residuetableformat.h>
+#include <ims/utils/mappedfile.h>
+#include <ims/base/exception/ioexception.h>
+#include <ims/weights.h>
+
+using namespace ims;
+
+class ResidueTableFormatTest : public CppUnit::TestFixture {
+		CPPUNIT_TEST_SUITE(ResidueTableFormatTest);
+		CPPUNIT_TEST(testSaveAndLoad);
+		CPPUNIT_TEST(testMappedFile);
+		CPPUNIT_TEST(testOtherWeights);
+		CPPUNIT_TEST(testCreateDecomposer);
+		CPPUNIT_TEST_SUITE_END();
+	private:
+		typedef IntegerMassDecomposer<> decomposer_type;
+		typedef decomposer_type::value_type value_type;
+		typedef decomposer_type::decompositions_type decompositions_type;
+
+		Weights createCHNOPSWeights(double precision);
+
+		void checkSameDecompositions(decomposer_type& expected,
+									 decomposer_type& decomposer);
+	public:
+		void testSaveAndLoad();
+		void testMappedFile();
+		void testOtherWeights();
+		void testCreateDecomposer();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ResidueTableFormatTest);
+
+Weights ResidueTableFormatTest::createCHNOPSWeights(double precision) {
+	Weights::alphabet_masses_type masses;
+	masses.push_back(1.007825);
+	masses.push_back(12.0);
+	masses.push_back(14.003074);
+	masses.push_back(15.994915);
+	masses.push_back(30.973762);
+	masses.push_back(31.972071);
+	return Weights(masses, precision);
+}
+
+void ResidueTableFormatTest::checkSameDecompositions(decomposer_type& expected,
+		decomposer_type& decomposer) {
+	for (value_type mass = 0; mass < 30000; mass += 997) {
+		CPPUNIT_ASSERT(decomposer.exist(mass) == expected.exist(mass));
+		decompositions_type decompositions = expected.getAllDecompositions(mass);
+		CPPUNIT_ASSERT(decomposer.getAllDecompositions(mass) == decompositions);
+		CPPUNIT_ASSERT(decomposer.getNumberOfDecompositions(mass) ==
+						decompositions.size());
+		if (!decompositions.empty()) {
+			CPPUNIT_ASSERT(decomposer.getDecomposition(mass) ==
+							expected.getDecomposition(mass));
+		}
+	}
+}
+
+void ResidueTableFormatTest::testSaveAndLoad() {
+	Weights weights = createCHNOPSWeights(0.01);
+	decomposer_type decomposer(weights);
+
+	std::stringstream stream;
+	decomposer.save(stream);
+	MappedFile contents(stream);
+	CPPUNIT_ASSERT(!contents.isMapped());
+	CPPUNIT_ASSERT(contents.size() > 0);
+
+	decomposer_type loaded(weights, contents);
+	checkSameDecompositions(decomposer, loaded);
+
+	// copies share the contents
+	decomposer_type copy(loaded);
+	checkSameDecompositions(decomposer, copy);
+}
+
+void ResidueTableFormatTest::testMappedFile() {
+	Weights weights = createCHNOPSWeights(0.001);
+	decomposer_type decomposer(weights);
+
+	std::string filename = ResidueTableFormat::getFileName(weights);
+	{
+		std::ofstream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+		decomposer.save(ofs);
+	}
+	{
+		MappedFile file(filename);
+		decomposer_type loaded(weights, file);
+		checkSameDecompositions(decomposer, loaded);
+		// the residue table lies in the mapped pages
+		CPPUNIT_ASSERT(loaded.getMemoryUsage() < decomposer.getMemoryUsage());
+
+		RealMassDecomposer real_decomposer(weights, new decomposer_type(weights, file));
+		RealMassDecomposer built_decomposer(weights);
+		CPPUNIT_ASSERT(real_decomposer.getDecompositions(147.0528, 0.001) ==
+						built_decomposer.getDecompositions(147.0528, 0.001));
+	}
+	std::remove(filename.c_str());
+
+	CPPUNIT_ASSERT_THROW(MappedFile file(filename), IOException);
+}
+
+void ResidueTableFormatTest::testOtherWeights() {
+	Weights weights = createCHNOPSWeights(0.01);
+	decomposer_type decomposer(weights);
+	std::stringstream stream;
+	decomposer.save(stream);
+	MappedFile contents(stream);
+
+	Weights other_weights = createCHNOPSWeights(0.001);
+	CPPUNIT_ASSERT(ResidueTableFormat::getKey(weights) !=
+					ResidueTableFormat::getKey(other_weights));
+	CPPUNIT_ASSERT_THROW(decomposer_type(other_weights, contents), IOException);
+
+	// truncated file
+	std::string data = stream.str();
+	std::istringstream truncated(data.substr(0, data.size() / 2));
+	MappedFile truncated_contents(truncated);
+	CPPUNIT_ASSERT_THROW(decomposer_type(weights, truncated_contents), IOException);
+}
+
+void ResidueTableFormatTest::testCreateDecomposer() {
+	Weights weights = createCHNOPSWeights(0.001);
+	decomposer_type decomposer(weights);
+	std::string filename = ResidueTableFormat::getFileName(weights);
+	std::remove(filename.c_str());
+
+	// builds the decomposer and writes the file
+	std::auto_ptr<decomposer_type> built(
+		ResidueTableFormat::createDecomposer<decomposer_type>(weights, ""));
+	checkSameDecompositions(decomposer, *built);
+	CPPUNIT_ASSERT(std::ifstream(filename.c_str()).good());
+
+	// maps the file
+	std::auto_ptr<decomposer_type> mapped(
+		ResidueTableFormat::createDecomposer<decomposer_type>(weights, "."));
+	checkSameDecompositions(decomposer, *mapped);
+	CPPUNIT_ASSERT(mapped->getMemoryUsage() < built->getMemoryUsage());
+
+	std::remove(filename.c_str());
+}
@@ -0,0 +1,230 @@
+/**
+ * fineisotopedistributiontest.cpp
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <cmath>
+#include <vector>
+#include <ims/isotopedistribution.h>
+#include <ims/fineisotopedistribution.h>
+
+using namespace ims;
+
+class FineIsotopeDistributionTest : public CppUnit::TestFixture {
+		CPPUNIT_TEST_SUITE( FineIsotopeDistributionTest );
+		CPPUNIT_TEST( testConstructor );
+		CPPUNIT_TEST( testFineStructure );
+		CPPUNIT_TEST( testNominalMasses );
+		CPPUNIT_TEST( testPower );
+		CPPUNIT_TEST( testPruning );
+		CPPUNIT_TEST_SUITE_END();
+	private:
+		typedef IsotopeDistribution::peaks_container peaks_container;
+
+		IsotopeDistribution distributionC, distributionH, distributionN,
+							distributionO, distributionS;
+
+		FineIsotopeDistribution getMolecule(unsigned int c, unsigned int h,
+			unsigned int n, unsigned int o, unsigned int s, double resolution,
+			double threshold);
+		IsotopeDistribution getNominalMolecule(unsigned int c, unsigned int h,
+			unsigned int n, unsigned int o, unsigned int s);
+	public:
+		void setUp();
+		void testConstructor();
+		void testFineStructure();
+		void testNominalMasses();
+		void testPower();
+		void testPruning();
+		void tearDown();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FineIsotopeDistributionTest);
+
+void FineIsotopeDistributionTest::setUp() {
+	IsotopeDistribution::SIZE = 10;
+	IsotopeDistribution::ABUNDANCES_SUM_ERROR = 0.0001;
+
+	peaks_container peaksC;
+	peaksC.push_back(peaks_container::value_type(0.0, 0.9893));
+	peaksC.push_back(peaks_container::value_type(0.003355, 0.0107));
+	distributionC = IsotopeDistribution(peaksC, 12);
+
+	peaks_container peaksH;
+	peaksH.push_back(peaks_container::value_type(0.007825, 0.999885));
+	peaksH.push_back(peaks_container::value_type(0.014102, 0.000115));
+	distributionH = IsotopeDistribution(peaksH, 1);
+
+	peaks_container peaksN;
+	peaksN.push_back(peaks_container::value_type(0.003074, 0.99632));
+	peaksN.push_back(peaks_container::value_type(0.000109, 0.00368));
+	distributionN = IsotopeDistribution(peaksN, 14);
+
+	peaks_container peaksO;
+	peaksO.push_back(peaks_container::value_type(-0.005085, 0.99757));
+	peaksO.push_back(peaks_container::value_type(-0.000868, 0.00038));
+	peaksO.push_back(peaks_container::value_type(-0.000839, 0.00205));
+	distributionO = IsotopeDistribution(peaksO, 16);
+
+	// no isotope of nominal mass 35
+	peaks_container peaksS;
+	peaksS.push_back(peaks_container::value_type(-0.027929, 0.9493));
+	peaksS.push_back(peaks_container::value_type(-0.028541, 0.0076));
+	peaksS.push_back(peaks_container::value_type(-0.032133, 0.0429));
+	peaksS.push_back(peaks_container::value_type(0.0, 0.0));
+	peaksS.push_back(peaks_container::value_type(-0.032919, 0.0002));
+	distributionS = IsotopeDistribution(peaksS, 32);
+}
+
+void FineIsotopeDistributionTest::tearDown() {
+}
+
+FineIsotopeDistribution FineIsotopeDistributionTest::getMolecule(
+		unsigned int c, unsigned int h, unsigned int n, unsigned int o,
+		unsigned int s, double resolution, double threshold) {
+	const IsotopeDistribution* elements[] = { &distributionC, &distributionH,
+		&distributionN, &distributionO, &distributionS };
+	const unsigned int counts[] = { c, h, n, o, s };
+	FineIsotopeDistribution molecule(resolution, threshold);
+	for (int i = 0; i < 5; ++i) {
+		if (counts[i] > 0) {
+			FineIsotopeDistribution power(*elements[i], resolution, threshold);
+			power *= counts[i];
+			molecule *= power;
+		}
+	}
+	return molecule;
+}
+
+IsotopeDistribution FineIsotopeDistributionTest::getNominalMolecule(
+		unsigned int c, unsigned int h, unsigned int n, unsigned int o,
+		unsigned int s) {
+	const IsotopeDistribution* elements[] = { &distributionC, &distributionH,
+		&distributionN, &distributionO, &distributionS };
+	const unsigned int counts[] = { c, h, n, o, s };
+	IsotopeDistribution molecule;
+	for (int i = 0; i < 5; ++i) {
+		if (counts[i] > 0) {
+			IsotopeDistribution power(*elements[i]);
+			power *= counts[i];
+			molecule *= power;
+		}
+	}
+	return molecule;
+}
+
+void FineIsotopeDistributionTest::testConstructor() {
+	FineIsotopeDistribution empty;
+	CPPUNIT_ASSERT(empty.empty());
+	CPPUNIT_ASSERT(empty.getResolution() == FineIsotopeDistribution::DEFAULT_RESOLUTION);
+	CPPUNIT_ASSERT(empty.getThreshold() == FineIsotopeDistribution::DEFAULT_THRESHOLD);
+
+	// the peak without abundance is left out
+	FineIsotopeDistribution sulfur(distributionS);
+	CPPUNIT_ASSERT(sulfur.size() == 4);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(31.972071, sulfur.getMass(0), 1e-9);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(35.967081, sulfur.getMass(3), 1e-9);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0002, sulfur.getAbundance(3), 1e-12);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, sulfur.getAbundancesSum(), 1e-12);
+
+	// folding with the empty distribution changes nothing
+	FineIsotopeDistribution folded(sulfur);
+	folded *= empty;
+	CPPUNIT_ASSERT(folded.getMasses() == sulfur.getMasses());
+	CPPUNIT_ASSERT(folded.getAbundances() == sulfur.getAbundances());
+}
+
+void FineIsotopeDistributionTest::testFineStructure() {
+	// C2H6NS: M+1 holds 13C, 2H, 15N and 33S, M+2 34S and 13C2 among others
+	FineIsotopeDistribution fine = getMolecule(2, 6, 1, 0, 1, 0.0001, 0.0);
+	std::vector<FineIsotopeDistribution::size_type> nominal_peaks(4, 0);
+	for (FineIsotopeDistribution::size_type i = 0; i < fine.size(); ++i) {
+		double shift = fine.getMass(i) - fine.getMass(0);
+		if (shift < 3.5) {
+			++nominal_peaks[static_cast<int>(shift + 0.5)];
+		}
+		if (i > 0) {
+			CPPUNIT_ASSERT(fine.getMass(i) - fine.getMass(i - 1) > 0.0001);
+		}
+	}
+	CPPUNIT_ASSERT(nominal_peaks[0] == 1);
+	CPPUNIT_ASSERT(nominal_peaks[1] == 4);
+	CPPUNIT_ASSERT(nominal_peaks[2] > 4);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, fine.getAbundancesSum(), 1e-12);
+
+	// a resolution coarser than the splitting leaves one peak per nominal mass
+	FineIsotopeDistribution coarse = getMolecule(2, 6, 1, 0, 1, 0.1, 0.0);
+	IsotopeDistribution nominal = getNominalMolecule(2, 6, 1, 0, 1);
+	CPPUNIT_ASSERT(coarse.size() > 6);
+	for (FineIsotopeDistribution::size_type i = 0; i < 6; ++i) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(nominal.getMass(i), coarse.getMass(i), 1e-9);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(nominal.getAbundance(i), coarse.getAbundance(i), 1e-12);
+	}
+}
+
+void FineIsotopeDistributionTest::testNominalMasses() {
+	// summing the fine structure up by nominal masses gives the
+	// nominal distribution of IsotopeDistribution
+	FineIsotopeDistribution fine = getMolecule(20, 30, 5, 8, 2,
+		FineIsotopeDistribution::DEFAULT_RESOLUTION, 0.0);
+	IsotopeDistribution nominal = getNominalMolecule(20, 30, 5, 8, 2);
+
+	std::vector<double> abundances(nominal.size(), 0.0), masses(nominal.size(), 0.0);
+	for (FineIsotopeDistribution::size_type i = 0; i < fine.size(); ++i) {
+		double shift = fine.getMass(i) - fine.getMass(0);
+		IsotopeDistribution::size_type bin = static_cast<int>(shift + 0.5);
+		if (bin < nominal.size()) {
+			abundances[bin] += fine.getAbundance(i);
+			masses[bin] += fine.getAbundance(i) * fine.getMass(i);
+		}
+	}
+	for (IsotopeDistribution::size_type i = 0; i < 6; ++i) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(nominal.getAbundance(i), abundances[i], 1e-9);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(nominal.getMass(i), masses[i] / abundances[i], 1e-7);
+	}
+}
+
+void FineIsotopeDistributionTest::testPower() {
+	// the Russian Multiplication Scheme gives the same as folding one by one
+	FineIsotopeDistribution oxygen(distributionO, 1e-6, 0.0);
+	for (unsigned int power = 0; power < 12; ++power) {
+		FineIsotopeDistribution powered(oxygen), folded(oxygen);
+		powered *= power;
+		for (unsigned int i = 1; i < power; ++i) {
+			folded *= oxygen;
+		}
+		CPPUNIT_ASSERT(powered.size() == folded.size());
+		for (FineIsotopeDistribution::size_type i = 0; i < folded.size(); ++i) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(folded.getMass(i), powered.getMass(i), 1e-9);
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(folded.getAbundance(i), powered.getAbundance(i), 1e-12);
+		}
+	}
+	// isotopologues of O12: with 3 isotopes, (12+1)(12+2)/2 of them
+	oxygen *= 12;
+	CPPUNIT_ASSERT(oxygen.size() == 91);
+}
+
+void FineIsotopeDistributionTest::testPruning() {
+	FineIsotopeDistribution all = getMolecule(40, 60, 10, 12, 2, 0.0001, 0.0);
+	FineIsotopeDistribution pruned = getMolecule(40, 60, 10, 12, 2, 0.0001, 1e-6);
+	CPPUNIT_ASSERT(pruned.size() < all.size());
+	CPPUNIT_ASSERT(pruned.getAbundancesSum() <= 1.0);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, pruned.getAbundancesSum(), 1e-4);
+
+	// the most abundant peaks are the same
+	for (FineIsotopeDistribution::size_type i = 0; i < pruned.size(); ++i) {
+		if (pruned.getAbundance(i) > 0.001) {
+			bool found = false;
+			for (FineIsotopeDistribution::size_type j = 0; j < all.size(); ++j) {
+				if (std::fabs(all.getMass(j) - pruned.getMass(i)) < 1e-7) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL(all.getAbundance(j),
+						pruned.getAbundance(i), 1e-5);
+					found = true;
+				}
+			}
+			CPPUNIT_ASSERT(found);
+		}
+	}
+}
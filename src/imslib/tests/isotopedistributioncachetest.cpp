@@ -0,0 +1,139 @@
+/**
+ * isotopedistributioncachetest.cpp
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <vector>
+#include <ims/alphabet.h>
+#include <ims/weights.h>
+#include <ims/decomp/realmassdecomposer.h>
+#include <ims/composedelement.h>
+#include <ims/isotopedistribution.h>
+#include <ims/isotopedistributioncache.h>
+
+using namespace ims;
+
+class IsotopeDistributionCacheTest : public CppUnit::TestFixture {
+		CPPUNIT_TEST_SUITE( IsotopeDistributionCacheTest );
+		CPPUNIT_TEST( testGetDistribution );
+		CPPUNIT_TEST( testStatistics );
+		CPPUNIT_TEST( testGetNextDistribution );
+		CPPUNIT_TEST_SUITE_END();
+	private:
+		typedef IsotopeDistributionCache::counts_type counts_type;
+
+		Alphabet alphabet;
+	public:
+		void setUp();
+		void testGetDistribution();
+		void testStatistics();
+		void testGetNextDistribution();
+		void tearDown();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(IsotopeDistributionCacheTest);
+
+void IsotopeDistributionCacheTest::setUp() {
+	typedef IsotopeDistribution::peaks_container peaks_container;
+
+	IsotopeDistribution::SIZE = 10;
+	IsotopeDistribution::ABUNDANCES_SUM_ERROR = 0.0001;
+
+	// not ordered by sequence, which gives the folding order
+	peaks_container peaksO;
+	peaksO.push_back(peaks_container::value_type(-0.005085, 0.99762));
+	peaksO.push_back(peaks_container::value_type(-0.000868, 0.00038));
+	peaksO.push_back(peaks_container::value_type(-0.000839, 0.002));
+	peaks_container peaksH;
+	peaksH.push_back(peaks_container::value_type(0.007825, 0.99985));
+	peaksH.push_back(peaks_container::value_type(0.014102, 0.00015));
+	peaks_container peaksC;
+	peaksC.push_back(peaks_container::value_type(0.0, 0.9889));
+	peaksC.push_back(peaks_container::value_type(0.003355, 0.0111));
+
+	alphabet = Alphabet();
+	alphabet.push_back(Element("O", IsotopeDistribution(peaksO, 16)));
+	alphabet.push_back(Element("H", IsotopeDistribution(peaksH, 1)));
+	alphabet.push_back(Element("C", IsotopeDistribution(peaksC, 12)));
+}
+
+void IsotopeDistributionCacheTest::tearDown() {
+}
+
+void IsotopeDistributionCacheTest::testGetDistribution() {
+	IsotopeDistributionCache cache(alphabet);
+
+	// single atoms, single elements and molecules, some repeated
+	const unsigned int counts[][3] = {
+		{ 0, 0, 1 }, { 1, 0, 0 }, { 0, 7, 0 }, { 6, 12, 6 }, { 1, 0, 0 },
+		{ 0, 0, 1 }, { 1, 4, 1 }, { 6, 12, 6 }, { 2, 1, 0 }, { 0, 0, 40 }
+	};
+	for (int i = 0; i < 10; ++i) {
+		counts_type molecule(counts[i], counts[i] + 3);
+		IsotopeDistribution distribution;
+		cache.getDistribution(molecule, distribution);
+
+		ComposedElement expected(molecule, alphabet);
+		expected.updateIsotopeDistribution();
+		CPPUNIT_ASSERT(distribution.getMasses() ==
+			expected.getIsotopeDistribution().getMasses());
+		CPPUNIT_ASSERT(distribution.getAbundances() ==
+			expected.getIsotopeDistribution().getAbundances());
+	}
+}
+
+void IsotopeDistributionCacheTest::testStatistics() {
+	IsotopeDistributionCache cache(alphabet);
+	IsotopeDistribution distribution;
+
+	counts_type molecule(3);
+	molecule[0] = 6;
+	molecule[1] = 12;
+	molecule[2] = 6;
+	cache.getDistribution(molecule, distribution);
+	CPPUNIT_ASSERT(cache.getMisses() == 3);
+	CPPUNIT_ASSERT(cache.getHits() == 0);
+
+	molecule[1] = 10;
+	cache.getDistribution(molecule, distribution);
+	CPPUNIT_ASSERT(cache.getMisses() == 4);
+	CPPUNIT_ASSERT(cache.getHits() == 2);
+
+	cache.clear();
+	cache.getDistribution(molecule, distribution);
+	CPPUNIT_ASSERT(cache.getMisses() == 7);
+	CPPUNIT_ASSERT(cache.getHits() == 2);
+}
+
+void IsotopeDistributionCacheTest::testGetNextDistribution() {
+	// the decomposer needs the elements ordered by mass
+	Alphabet sorted(alphabet);
+	sorted.sortByValues();
+	Weights weights(sorted.getMasses(), 0.0001);
+	RealMassDecomposer decomposer(weights);
+
+	IsotopeDistributionCache cache(sorted), expected_cache(sorted);
+	RealMassDecomposer::DecompositionCursor cursor(decomposer);
+	for (double mass = 150.0; mass < 300.0; mass += 50.0) {
+		for (cursor.reset(mass, 0.5); cursor.next(); ) {
+			counts_type molecule(cursor.current().begin(), cursor.current().end());
+			const IsotopeDistribution& distribution = 
+				cache.getNextDistribution(molecule, cursor.getChangedLevel());
+
+			IsotopeDistribution expected;
+			expected_cache.getDistribution(molecule, expected);
+			CPPUNIT_ASSERT(distribution.size() == expected.size());
+			CPPUNIT_ASSERT(distribution.getNominalMass() == expected.getNominalMass());
+			for (IsotopeDistribution::size_type i = 0; i < expected.size(); ++i) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.getMass(i), distribution.getMass(i), 1e-10);
+				CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.getAbundance(i), 
+											 distribution.getAbundance(i), 1e-12);
+			}
+		}
+	}
+	// only few elements were folded again for every molecule
+	CPPUNIT_ASSERT(cache.getHits() + cache.getMisses() < 
+				   expected_cache.getHits() + expected_cache.getMisses());
+}
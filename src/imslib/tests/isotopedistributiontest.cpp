@@ -9,6 +9,8 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
 
+#include <cmath>
+#include <limits>
 #include <ims/isotopedistribution.h>
 
 using namespace ims;
@@ -16,10 +18,20 @@ using namespace ims;
 class IsotopeDistributionTest : public CppUnit::TestFixture {
 		CPPUNIT_TEST_SUITE( IsotopeDistributionTest );
 		CPPUNIT_TEST( testConstructor );
+		CPPUNIT_TEST( testFoldByFFT );
+		CPPUNIT_TEST( testContext );
+		CPPUNIT_TEST( testFoldLeavesArgument );
 		CPPUNIT_TEST_SUITE_END();
+	private:
+		typedef IsotopeDistribution::peaks_container peaks_container;
+
+		peaks_container peaksC, peaksO, peaksS;
 	public:
 		void setUp();
 		void testConstructor();
+		void testFoldByFFT();
+		void testContext();
+		void testFoldLeavesArgument();
 		void tearDown();
 };
 
@@ -28,6 +40,20 @@ CPPUNIT_TEST_SUITE_REGISTRATION(IsotopeDistributionTest);
 void IsotopeDistributionTest::setUp() {
 	IsotopeDistribution::SIZE = 10;
 	IsotopeDistribution::ABUNDANCES_SUM_ERROR = 0.0001;
+
+	peaksC.push_back(peaks_container::value_type(0.0, 0.9893));
+	peaksC.push_back(peaks_container::value_type(0.003355, 0.0107));
+
+	peaksO.push_back(peaks_container::value_type(-0.005085, 0.99757));
+	peaksO.push_back(peaks_container::value_type(-0.000868, 0.00038));
+	peaksO.push_back(peaks_container::value_type(-0.000839, 0.00205));
+
+	// no isotope of nominal mass 35
+	peaksS.push_back(peaks_container::value_type(-0.027929, 0.9493));
+	peaksS.push_back(peaks_container::value_type(-0.028541, 0.0076));
+	peaksS.push_back(peaks_container::value_type(-0.032133, 0.0429));
+	peaksS.push_back(peaks_container::value_type(0.0, 0.0));
+	peaksS.push_back(peaks_container::value_type(-0.032919, 0.0002));
 }
 
 void IsotopeDistributionTest::tearDown() {
@@ -62,3 +88,105 @@ void IsotopeDistributionTest::testConstructor() {
 	CPPUNIT_ASSERT_DOUBLES_EQUAL(distributionO.getMass(2), massO + massShift2 + 2, 1.0e-6);
 }
 
+
+void IsotopeDistributionTest::testFoldByFFT() {
+	typedef IsotopeDistribution::size_type size_type;
+
+	IsotopeDistribution distributionC(peaksC, 12);
+	IsotopeDistribution distributionO(peaksO, 16);
+
+	// both ways of folding agree on all peaks, down to the far tail
+	const size_type sizes[] = { 10, 64, 200 };
+	for (int s = 0; s < 3; ++s) {
+		IsotopeDistribution::context_type direct_context(sizes[s], 0.0001, 
+			std::numeric_limits<size_type>::max());
+		IsotopeDistribution::context_type fft_context(sizes[s], 0.0001, 1);
+		IsotopeDistribution direct(distributionC), transformed(distributionC);
+		IsotopeDistribution oxygens(distributionO);
+		oxygens.setContext(direct_context);
+		oxygens *= 80;
+
+		direct.setContext(direct_context);
+		direct *= 100;
+		direct *= oxygens;
+		transformed.setContext(fft_context);
+		transformed *= 100;
+		transformed *= oxygens;
+
+		CPPUNIT_ASSERT_EQUAL(sizes[s], direct.size());
+		CPPUNIT_ASSERT_EQUAL(direct.size(), transformed.size());
+		for (size_type i = 0; i < direct.size(); ++i) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(direct.getMass(i), transformed.getMass(i), 1e-9);
+			CPPUNIT_ASSERT(std::fabs(transformed.getAbundance(i) - direct.getAbundance(i))
+							<= 1e-8 * direct.getAbundance(i));
+		}
+	}
+}
+
+void IsotopeDistributionTest::testContext() {
+	typedef IsotopeDistribution::context_type context_type;
+
+	// the default context takes the static settings when constructed
+	IsotopeDistribution defaults(peaksS, 32);
+	CPPUNIT_ASSERT(defaults.getContext() == context_type(10, 0.0001));
+	IsotopeDistribution::SIZE = 3;
+	CPPUNIT_ASSERT(defaults.getContext() == context_type(10, 0.0001));
+	CPPUNIT_ASSERT(IsotopeDistribution(peaksS, 32).getContext() == context_type(3, 0.0001));
+	IsotopeDistribution::SIZE = 10;
+
+	// folding gives the size of the distribution folded into
+	context_type short_context(4, 0.0001), long_context(12, 0.0001);
+	IsotopeDistribution short_sulfurs(peaksS, 32, short_context), 
+						long_sulfurs(peaksS, 32, long_context);
+	short_sulfurs *= 3;
+	long_sulfurs *= 3;
+	CPPUNIT_ASSERT(short_sulfurs.getContext() == short_context);
+	CPPUNIT_ASSERT_EQUAL(IsotopeDistribution::size_type(4), short_sulfurs.size());
+	CPPUNIT_ASSERT_EQUAL(IsotopeDistribution::size_type(12), long_sulfurs.size());
+	for (IsotopeDistribution::size_type i = 0; i < 4; ++i) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(long_sulfurs.getMass(i), short_sulfurs.getMass(i), 1e-9);
+	}
+
+	IsotopeDistribution folded(long_context);
+	folded *= short_sulfurs;
+	CPPUNIT_ASSERT(folded.getContext() == long_context);
+	folded *= long_sulfurs;
+	CPPUNIT_ASSERT_EQUAL(IsotopeDistribution::size_type(12), folded.size());
+	short_sulfurs *= long_sulfurs;
+	CPPUNIT_ASSERT_EQUAL(IsotopeDistribution::size_type(4), short_sulfurs.size());
+}
+
+void IsotopeDistributionTest::testFoldLeavesArgument() {
+	typedef IsotopeDistribution::size_type size_type;
+	typedef IsotopeDistribution::context_type context_type;
+
+	// distributions folded with are not padded, whether their peaks are
+	// stored in place or not
+	const size_type sizes[] = { 10, IsotopeDistribution::INLINE_SIZE + 8 };
+	for (int s = 0; s < 2; ++s) {
+		context_type context(sizes[s], 0.0001);
+		IsotopeDistribution carbon(peaksC, 12, context);
+		IsotopeDistribution carbons(carbon);
+		carbons *= carbon;
+		CPPUNIT_ASSERT_EQUAL(size_type(2), carbon.size());
+		CPPUNIT_ASSERT_EQUAL(sizes[s], carbons.size());
+
+		// folding one by one gives the same as powers
+		IsotopeDistribution powered(carbon);
+		powered *= 50;
+		for (unsigned int i = 2; i < 50; ++i) {
+			carbons *= carbon;
+		}
+		CPPUNIT_ASSERT_EQUAL(size_type(2), carbon.size());
+		CPPUNIT_ASSERT_EQUAL(sizes[s], powered.size());
+		CPPUNIT_ASSERT_EQUAL(IsotopeDistribution::nominal_mass_type(600), 
+							 powered.getNominalMass());
+		for (size_type i = 0; i < sizes[s]; ++i) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(carbons.getAbundance(i), 
+										 powered.getAbundance(i), 1e-12);
+			if (carbons.getAbundance(i) > 0) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL(carbons.getMass(i), powered.getMass(i), 1e-9);
+			}
+		}
+	}
+}
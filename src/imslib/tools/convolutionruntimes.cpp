@@ -0,0 +1,153 @@
+/**
+ * convolutionruntimes.cpp
+ *
+ * Compares running times of computing isotope distributions of molecules
+ * by folding directly and by FFT, see IsotopeDistribution::Context,
+ * for several distribution sizes. Also gives the largest relative
+ * difference of abundances (over all peaks, however small) and the largest
+ * difference of masses between both.
+ *
+ * Molecules are a metabolite, a peptide, a lipid, a polymer and a
+ * halogenated compound.
+ *
+ * Usage: convolutionruntimes [size...]
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <ims/isotopedistribution.h>
+#include <ims/utils/stopwatch.h>
+
+using namespace std;
+using namespace ims;
+
+typedef IsotopeDistribution::peaks_container peaks_container;
+
+/**
+ * Creates the distribution of an element from isotope masses and abundances,
+ * one isotope per nominal mass starting with @c nominal_mass.
+ */
+IsotopeDistribution createElement(unsigned int nominal_mass, const double* masses,
+								  const double* abundances, int isotopes) {
+	peaks_container peaks;
+	for (int i = 0; i < isotopes; ++i) {
+		peaks.push_back(peaks_container::value_type(
+			masses[i] - nominal_mass - i, abundances[i]));
+	}
+	return IsotopeDistribution(peaks, nominal_mass);
+}
+
+/**
+ * Folds the powers of @c elements by @c counts with the settings of 
+ * @c context, repeated @c repeats times, and returns the time taken.
+ */
+double timeMolecule(const vector<IsotopeDistribution>& elements,
+					const vector<unsigned int>& counts, 
+					const IsotopeDistribution::context_type& context, 
+					int repeats, IsotopeDistribution& molecule) {
+	Stopwatch stopwatch;
+	for (int r = 0; r < repeats; ++r) {
+		molecule = IsotopeDistribution(context);
+		for (vector<unsigned int>::size_type i = 0; i < counts.size(); ++i) {
+			if (counts[i] > 0) {
+				IsotopeDistribution power(elements[i]);
+				power.setContext(context);
+				power *= counts[i];
+				molecule *= power;
+			}
+		}
+	}
+	return stopwatch.elapsed();
+}
+
+int main(int argc, char** argv) {
+	vector<IsotopeDistribution::size_type> sizes;
+	for (int i = 1; i < argc; ++i) {
+		IsotopeDistribution::size_type size;
+		istringstream size_string(argv[i]);
+		size_string >> size;
+		sizes.push_back(size);
+	}
+	if (sizes.empty()) {
+		const IsotopeDistribution::size_type default_sizes[] =
+			{ 10, 20, 30, 50, 80, 120, 200, 300 };
+		sizes.assign(default_sizes, default_sizes + 8);
+	}
+
+	// C H N O P S Cl Br
+	vector<IsotopeDistribution> elements;
+	const double massesC[] = { 12.0, 13.003355 }, abundancesC[] = { 0.9893, 0.0107 };
+	elements.push_back(createElement(12, massesC, abundancesC, 2));
+	const double massesH[] = { 1.007825, 2.014102 }, abundancesH[] = { 0.999885, 0.000115 };
+	elements.push_back(createElement(1, massesH, abundancesH, 2));
+	const double massesN[] = { 14.003074, 15.000109 }, abundancesN[] = { 0.99632, 0.00368 };
+	elements.push_back(createElement(14, massesN, abundancesN, 2));
+	const double massesO[] = { 15.994915, 16.999132, 17.999161 },
+				 abundancesO[] = { 0.99757, 0.00038, 0.00205 };
+	elements.push_back(createElement(16, massesO, abundancesO, 3));
+	const double massesP[] = { 30.973762 }, abundancesP[] = { 1.0 };
+	elements.push_back(createElement(31, massesP, abundancesP, 1));
+	const double massesS[] = { 31.972071, 32.971459, 33.967867, 34.0, 35.967081 },
+				 abundancesS[] = { 0.9493, 0.0076, 0.0429, 0.0, 0.0002 };
+	elements.push_back(createElement(32, massesS, abundancesS, 5));
+	const double massesCl[] = { 34.968853, 36.0, 36.965903 },
+				 abundancesCl[] = { 0.7576, 0.0, 0.2424 };
+	elements.push_back(createElement(35, massesCl, abundancesCl, 3));
+	const double massesBr[] = { 78.918338, 80.0, 80.916291 },
+				 abundancesBr[] = { 0.5069, 0.0, 0.4931 };
+	elements.push_back(createElement(79, massesBr, abundancesBr, 3));
+
+	vector<string> names;
+	vector<vector<unsigned int> > molecules;
+	const unsigned int counts[][8] = {
+		{ 6, 12, 0, 6, 0, 0, 0, 0 },				// glucose
+		{ 254, 377, 65, 75, 0, 6, 0, 0 },			// insulin
+		{ 41, 80, 1, 8, 1, 0, 0, 0 },				// phosphatidylcholine
+		{ 600, 1202, 0, 301, 0, 0, 0, 0 },			// polyethylene glycol
+		{ 12, 2, 0, 2, 0, 0, 4, 4 }				// halogenated dibenzodioxin
+	};
+	const string molecule_names[] = { "C6H12O6", "C254H377N65O75S6",
+		"C41H80NO8P", "C600H1202O301", "C12H2Cl4Br4O2" };
+	for (int m = 0; m < 5; ++m) {
+		names.push_back(molecule_names[m]);
+		molecules.push_back(vector<unsigned int>(counts[m], counts[m] + 8));
+	}
+
+	cout << "# molecule\tsize\tdirect\tfft\tspeedup\tabundance error\tmass error" << endl;
+	for (vector<string>::size_type m = 0; m < names.size(); ++m) {
+		for (vector<IsotopeDistribution::size_type>::size_type s = 0; s < sizes.size(); ++s) {
+			int repeats = static_cast<int>(std::max<IsotopeDistribution::size_type>(
+				1, 200000 / (sizes[s] * sizes[s])));
+
+			IsotopeDistribution direct, transformed;
+			IsotopeDistribution::context_type direct_context(sizes[s], 0.0001, 
+				numeric_limits<IsotopeDistribution::size_type>::max());
+			IsotopeDistribution::context_type fft_context(sizes[s], 0.0001, 1);
+			double direct_time = timeMolecule(elements, molecules[m], direct_context, 
+											  repeats, direct);
+			double fft_time = timeMolecule(elements, molecules[m], fft_context, 
+										   repeats, transformed);
+
+			double abundance_error = 0.0, mass_error = 0.0;
+			for (IsotopeDistribution::size_type i = 0; i < direct.size(); ++i) {
+				if (direct.getAbundance(i) > 0.0) {
+					abundance_error = std::max(abundance_error,
+						std::fabs(transformed.getAbundance(i) / direct.getAbundance(i) - 1.0));
+					mass_error = std::max(mass_error,
+						std::fabs(transformed.getMass(i) - direct.getMass(i)));
+				}
+			}
+			cout << names[m] << '\t' << sizes[s] << '\t'
+				<< direct_time / repeats << '\t' << fft_time / repeats << '\t'
+				<< direct_time / fft_time << '\t'
+				<< abundance_error << '\t' << mass_error << endl;
+		}
+	}
+	return 0;
+}
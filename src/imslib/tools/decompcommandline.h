@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <limits>
+#include <sstream>
 
 #include <ims/tclap/CmdLine.h>
 #include <ims/base/exception/exception.h>
@@ -42,7 +43,7 @@ class DecompCommandLine {
 		/**
 		 * Pointer to the argument that represents the precision of decomposition calculation.
 		 */
-		TCLAP::ValueArg<double> *precision;
+		TCLAP::ValueArg<std::string> *precision;
 
 		/**
 		 * Pointer to the argument that represents the error that masses allow to have.
@@ -80,6 +81,11 @@ class DecompCommandLine {
 
 		TCLAP::ValueArg<std::string> *massMode;
 
+		/**
+		 * Pointer to the argument that represents the directory with residue table files.
+		 */
+		TCLAP::ValueArg<std::string> *tableDirectory;
+
 		/**
 		 * Initializes arguments.
 		 */
@@ -120,9 +126,16 @@ class DecompCommandLine {
 		/**
 		 * Gets the precision of the alphabet.
 		 *
-		 * @return The precision of the alphabet.
+		 * @return The precision of the alphabet, or 0.0 if no precision 
+		 * or "auto" is given.
+		 */
+		double getPrecision();
+
+		/**
+		 * Returns true if the precision is to be chosen by the expected
+		 * running time for the masses (-p auto).
 		 */
-		double getPrecision() { return precision->getValue(); }
+		bool isAutomaticPrecisionSet() { return precision->getValue() == "auto"; }
 
 		/**
 		 * Gets the mass error tolerance.
@@ -152,6 +165,13 @@ class DecompCommandLine {
 
 		std::string getMassMode() { return massMode->getValue(); }
 
+		/**
+		 * Gets the directory with residue table files, empty if none is given.
+		 *
+		 * @see ims::ResidueTableFormat::createDecomposer()
+		 */
+		std::string getTableDirectory() { return tableDirectory->getValue(); }
+
 		/**
 		 *
 		 */
@@ -202,7 +222,7 @@ void DecompCommandLine::initializeArguments() {
 
 	// alphabet flags
 	alphabet = new TCLAP::ValueArg<std::string>("a", "alphabet", "File with alphabet masses", true, "dna.masses", "filename");
-	precision = new TCLAP::ValueArg<double>("p", "precision", "Precision of decomposition", false, static_cast<double>(0.0), "number");
+	precision = new TCLAP::ValueArg<std::string>("p", "precision", "Precision of decomposition, 'auto' chooses the fastest one for the masses", false, "", "number|auto");
 
 	// masses flags
 	massNumbers = new TCLAP::MultiArg<double>("m", "masses", "List of masses to be decomposed", true, "list");
@@ -227,6 +247,9 @@ void DecompCommandLine::initializeArguments() {
 	allowedMassModes.push_back("mono");
 	allowedMassModes.push_back("average");
 	massMode = new TCLAP::ValueArg<std::string>("o", "massmode", "Mass Mode", false, "mono", allowedMassModes);
+
+	tableDirectory = new TCLAP::ValueArg<std::string>("t", "tables",
+		"Directory to store and memory-map residue tables", false, "", "directory");
 }
 
 
@@ -241,6 +264,7 @@ void DecompCommandLine::addArguments(TCLAP::CmdLine& commandLine) {
 	commandLine.xorAdd(*massNumbers, *massFile);
 	commandLine.add(modifications);
 	commandLine.add(massMode);
+	commandLine.add(tableDirectory);
 }
 
 
@@ -264,6 +288,19 @@ void DecompCommandLine::parse(int argc, char** argv) {
 }
 
 
+double DecompCommandLine::getPrecision() {
+	if (!precision->isSet() || isAutomaticPrecisionSet()) {
+		return 0.0;
+	}
+	std::istringstream value(precision->getValue());
+	double result;
+	if (!(value >> result) || result <= 0.0) {
+		throw ims::Exception("Invalid precision: " + precision->getValue());
+	}
+	return result;
+}
+
+
 std::vector<double> DecompCommandLine::getMasses() {
 	std::vector<double> masses;
 	if (massNumbers->isSet()) {
@@ -287,6 +324,7 @@ DecompCommandLine::~DecompCommandLine() {
 	delete massFile;
 	delete modifications;
 	delete massMode;
+	delete tableDirectory;
 }
 
 #endif // IMS_DECOMPCOMMANDLINE_H
@@ -24,6 +24,8 @@ TODO (nach Prioritaet sortiert)
 #include <ims/base/exception/ioexception.h>
 #include <ims/base/parser/massestextparser.h>
 #include <ims/decomp/realmassdecomposer.h>
+#include <ims/decomp/residuetableformat.h>
+#include <ims/decomp/precisionselector.h>
 #include <ims/decomp/decomputils.h>
 #include <ims/utils/print.h>
 #include <ims/utils/math.h>
@@ -136,28 +138,6 @@ int main(int argc, char **argv) {
 		Alphabet alphabet;
 		alphabet.load(cmd.getAlphabetFileName());
 
-		bool automaticPrecision = false;
-
-		// gets decomposition precision
-		double precision = cmd.getPrecision();
-
-		if (precision == 0.0) {
-			// 0.0 is the default, which means that no '-p' option was
-			// given on the command line. We instead compute the precision
-			// automatically.
-
-			// smallest alphabet mass times 4e-5.
-			// Note: it has to be 'floored' to avoid the issue with decimal points
-			precision = floor(alphabet.getMass(0)) * 4.0e-05;
-			automaticPrecision = true;
-		}
-
-		// initializes weights
-		Weights weights(alphabet.getMasses(), precision);
-
-		// optimize alphabet by dividing by gcd
-		weights.divideByGCD();
-
 		// gets masses
 		vector<double> masses;
 		if (cmd.isMassesNumbersSet()) {
@@ -217,10 +197,47 @@ int main(int argc, char **argv) {
 		// gets maximal number of decompositions to be shown
 		unsigned int maxNumber = cmd.getMaxNumberDecompositions();
 
+		bool automaticPrecision = false;
+
+		// gets decomposition precision
+		double precision = cmd.getPrecision();
+
+		if (cmd.isAutomaticPrecisionSet()) {
+			// chooses the precision of smallest expected running time 
+			// for decomposing the given masses
+			vector<double> errors;
+			for (vector<double>::const_iterator it = masses.begin(); it != masses.end(); ++it) {
+				errors.push_back(errorUnits == "ppm" ? *it * error * 1.0e-06 : error);
+			}
+			PrecisionSelector selector(alphabet.getMasses());
+			selector.setMasses(masses, errors);
+			precision = selector.select();
+			automaticPrecision = true;
+		} else if (precision == 0.0) {
+			// 0.0 is the default, which means that no '-p' option was
+			// given on the command line. We instead compute the precision
+			// automatically.
+
+			// smallest alphabet mass times 4e-5.
+			// Note: it has to be 'floored' to avoid the issue with decimal points
+			precision = floor(alphabet.getMass(0)) * 4.0e-05;
+			automaticPrecision = true;
+		}
+
+		// initializes weights
+		Weights weights(alphabet.getMasses(), precision);
+
+		// optimize alphabet by dividing by gcd
+		weights.divideByGCD();
+
 		printHeader(alphabet, weights, precision, error, errorUnits, modifications_headers, cmd.isShowParentMassSet(), cmd.isShowErrorDeltaSet(), mass_mode, automaticPrecision);
 
-		// decomposes real values
-		RealMassDecomposer decomposer(weights);
+		// decomposes real values, sharing the residue table with other 
+		// processes if a table directory is given
+		RealMassDecomposer decomposer(weights, cmd.getTableDirectory().empty() ?
+			new RealMassDecomposer::integer_decomposer_type(weights) :
+			ResidueTableFormat::createDecomposer<RealMassDecomposer::integer_decomposer_type>(
+				weights, cmd.getTableDirectory()));
 
 		double absolute_error = error;
 		// loops through the given masses
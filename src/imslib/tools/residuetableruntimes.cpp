@@ -0,0 +1,180 @@
+/**
+ * residuetableruntimes.cpp
+ *
+ * Compares running times of filling the columns of the extended residue
+ * table: the round robin residue by residue and in lanes, see
+ * ResidueColumnFiller. Both have to give the same columns and witnesses.
+ * Also measures building the whole table by ResidueTable::fill() into
+ * both layouts, ResidueColumns (as used by FastIntegerMassDecomposer and
+ * the two mass decomposers) and CompactResidueTable (as used by
+ * IntegerMassDecomposer), and building IntegerMassDecomposer as a whole.
+ *
+ * Alphabets are CHNOPS, CHNOPS with sodium and potassium, and the amino acid
+ * residues (monoisotopic and average masses) from the files used
+ * with imsintdecomp.
+ *
+ * Usage: residuetableruntimes <directory with amino acid files> [precision...]
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <sstream>
+
+#include <ims/alphabet.h>
+#include <ims/weights.h>
+#include <ims/decomp/residuecolumnfiller.h>
+#include <ims/decomp/residuetable.h>
+#include <ims/decomp/compactresiduetable.h>
+#include <ims/decomp/integermassdecomposer.h>
+#include <ims/utils/stopwatch.h>
+#include <ims/base/exception/ioexception.h>
+
+using namespace std;
+using namespace ims;
+
+typedef IntegerMassDecomposer<> decomposer_type;
+typedef ResidueColumnFiller<decomposer_type::value_type,
+		decomposer_type::decomposition_value_type> filler_type;
+typedef ResidueTable<decomposer_type::value_type,
+		decomposer_type::decomposition_value_type> table_type;
+
+/**
+ * Fills the extended residue table of @c weights into @c layout and
+ * returns the time taken.
+ */
+template <typename LayoutType>
+double timeFilling(const Weights& weights, LayoutType& layout) {
+	table_type::row_type lcms(weights.size()), mass_in_lcms(weights.size());
+	table_type::witness_vector_type witness_vector;
+	table_type::value_type infty = weights.getWeight(0) * weights.getWeight(weights.size() - 1);
+	Stopwatch stopwatch;
+	table_type::fill(weights, infty, lcms, mass_in_lcms, witness_vector, layout);
+	return stopwatch.elapsed();
+}
+
+/**
+ * Fills the columns of @c weights one after another both ways, except those
+ * skipped by Nijenhuis' improvement. Adds the times to @c sequential_time
+ * and @c lanes_time and returns the number of columns, or -1 if the
+ * fillings differ.
+ */
+int compareFillings(const Weights& weights, double& sequential_time, double& lanes_time) {
+	filler_type::value_type smallest_mass = weights.getWeight(0);
+	filler_type::value_type infty = smallest_mass * weights.getWeight(weights.size() - 1);
+
+	// the column of the second mass, the others build on it
+	filler_type::column_type prev_column(smallest_mass, infty);
+	prev_column[0] = 0;
+	filler_type::witness_vector_type sequential_witnesses(smallest_mass);
+	filler_type::fillMultiples(prev_column, sequential_witnesses, 1, weights.getWeight(1));
+	filler_type::witness_vector_type lanes_witnesses(sequential_witnesses);
+	filler_type::column_type sequential_column(smallest_mass), lanes_column(smallest_mass);
+
+	filler_type filler;
+	Stopwatch stopwatch;
+	int columns = 0;
+	for (Weights::size_type i = 2; i < weights.size(); ++i) {
+		filler_type::value_type mass = weights.getWeight(i);
+		if (mass >= prev_column[mass % smallest_mass]) {
+			continue;
+		}
+		stopwatch.start();
+		filler_type::fillSequentially(prev_column, sequential_column, sequential_witnesses, i, mass);
+		sequential_time += stopwatch.elapsed();
+
+		stopwatch.start();
+		filler.fill(prev_column, lanes_column, lanes_witnesses, i, mass);
+		lanes_time += stopwatch.elapsed();
+
+		if (sequential_column != lanes_column || sequential_witnesses != lanes_witnesses) {
+			return -1;
+		}
+		prev_column.swap(lanes_column);
+		++columns;
+	}
+	return columns;
+}
+
+int main(int argc, char** argv) {
+	try {
+		if (argc == 1) {
+			throw IOException("command line lacks the directory with amino acid files!");
+		}
+		string directory = argv[1];
+
+		vector<double> precisions;
+		for (int i = 2; i < argc; ++i) {
+			double precision;
+			istringstream precision_string(argv[i]);
+			precision_string >> precision;
+			precisions.push_back(precision);
+		}
+		if (precisions.empty()) {
+			precisions.push_back(0.0001);
+			precisions.push_back(0.00001);
+		}
+
+		vector<string> names;
+		vector<Weights::alphabet_masses_type> alphabets;
+
+		const double chnops[] = { 1.007825, 12.0, 14.003074, 15.994915, 30.973762, 31.972071 };
+		names.push_back("CHNOPS");
+		alphabets.push_back(Weights::alphabet_masses_type(chnops, chnops + 6));
+
+		names.push_back("CHNOPSNaK");
+		alphabets.push_back(alphabets.back());
+		alphabets.back().push_back(22.989770);
+		alphabets.back().push_back(38.963707);
+
+		const string amino_acids[] = { "amino-acid-mono", "amino-acid-average" };
+		for (int i = 0; i < 2; ++i) {
+			Alphabet alphabet;
+			alphabet.load(directory + "/" + amino_acids[i] + ".masses-frequencies");
+			names.push_back(amino_acids[i]);
+			alphabets.push_back(alphabet.getMasses());
+		}
+
+		cout << "# alphabet\tprecision\tresidues\t#columns\tsequential\tlanes\tspeedup\tcolumns\tcompact\tdecomposer" << endl;
+		for (vector<string>::size_type a = 0; a < names.size(); ++a) {
+			for (vector<double>::size_type p = 0; p < precisions.size(); ++p) {
+				Weights weights(alphabets[a], precisions[p]);
+				weights.divideByGCD();
+
+				double sequential_time = 0.0, lanes_time = 0.0;
+				int columns = compareFillings(weights, sequential_time, lanes_time);
+				if (columns < 0) {
+					cerr << "fillings differ for " << names[a] << " at " << precisions[p] << endl;
+					return 1;
+				}
+
+				double columns_time, compact_time;
+				{
+					table_type::table_type table;
+					ResidueColumns<table_type::value_type> layout(table);
+					columns_time = timeFilling(weights, layout);
+				}
+				{
+					CompactResidueTable<table_type::value_type> layout;
+					compact_time = timeFilling(weights, layout);
+				}
+
+				Stopwatch stopwatch;
+				decomposer_type decomposer(weights);
+				double decomposer_time = stopwatch.elapsed();
+
+				cout << names[a] << '\t' << precisions[p] << '\t' << weights.getWeight(0) << '\t'
+					<< columns << '\t' << sequential_time << '\t' << lanes_time << '\t'
+					<< (lanes_time > 0.0 ? sequential_time / lanes_time : 0.0) << '\t'
+					<< columns_time << '\t' << compact_time << '\t'
+					<< decomposer_time << endl;
+			}
+		}
+
+	} catch (Exception& e) {
+			cout << "Exception: " << e.message() << endl;
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,299 @@
+/**
+ * vectorizationruntimes.cpp
+ *
+ * Compares running times of folding isotope distributions peak by peak,
+ * as IsotopeDistribution does below the FFT threshold, and on vectors of
+ * four doubles, for CHNOPS molecules of 147 to 1956 Da and several
+ * distribution sizes. Also gives the largest relative difference of
+ * abundances and the largest difference of masses between both, leaving
+ * out peaks of subnormal abundance, whose masses have no significant
+ * digits either way.
+ *
+ * Folding on vectors did not pay off at the default size of 10 peaks and
+ * was not taken into IsotopeDistribution, so both folds are copies kept
+ * here, foldPeaks() of IsotopeDistribution::fold() and foldVectorized()
+ * of the vector kernel, to measure it again on other compilers and
+ * processors. On x86_64 with gcc -O2 and the AVX2 clone, folding on
+ * vectors was 0.65-0.7x as fast as peak by peak at size 10 (medians of
+ * the five molecules in three runs), 0.95x at 20, 1.1x at 30, 1.4x at 48
+ * and 1.5-1.8x at 100. Abundances were the same, masses differed by less
+ * than 1e-12.
+ *
+ * Usage: vectorizationruntimes [size...]
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include <ims/isotopedistribution.h>
+#include <ims/utils/stopwatch.h>
+
+// compilers with vector extensions (gcc, clang) get four doubles per
+// operation, mapped to whatever the target has (SSE2, AVX, NEON...);
+// where the loader can pick one of several clones of a function (ifunc),
+// an AVX2 clone is chosen at runtime on processors that have it
+#if defined(__GNUC__)
+#define IMS_VECTOR_EXTENSIONS
+#if defined(__has_attribute) && defined(__x86_64__) && defined(__linux__)
+#if __has_attribute(target_clones)
+#define IMS_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#endif
+#ifndef IMS_TARGET_CLONES
+#define IMS_TARGET_CLONES
+#endif
+
+using namespace std;
+using namespace ims;
+
+typedef IsotopeDistribution::peaks_container peaks_container;
+typedef IsotopeDistribution::size_type size_type;
+typedef IsotopeDistribution::context_type context_type;
+
+/**
+ * A peak of a distribution, as IsotopeDistribution keeps them.
+ */
+struct Peak {
+	double mass;
+	double abundance;
+};
+
+typedef vector<Peak> peaks_type;
+
+/**
+ * Folds @c first and @c second into the first @c size peaks of @c dest
+ * peak by peak, as IsotopeDistribution::foldPeak() does.
+ */
+void foldPeaks(const peaks_type& first, const peaks_type& second,
+			   peaks_type& dest, size_type size) {
+	dest.resize(size);
+	for (size_type k = 0; k < size; ++k) {
+		size_type i = (k < second.size()) ? 0 : k - second.size() + 1;
+		const size_type end = std::min(k + 1, first.size());
+		double abundances_sum = 0, masses_mult_abundances_sum = 0;
+		for (; i < end; ++i) {
+			const Peak& peak1 = first[i];
+			const Peak& peak2 = second[k - i];
+			abundances_sum += peak1.abundance * peak2.abundance;
+			masses_mult_abundances_sum +=
+					peak1.abundance * peak2.abundance * (peak1.mass + peak2.mass);
+		}
+		dest[k].abundance = abundances_sum;
+		dest[k].mass = (abundances_sum != 0) ?
+						masses_mult_abundances_sum / abundances_sum : 0;
+	}
+}
+
+/**
+ * Convolves abundances @c a and @c b, and abundances times masses
+ * @c am and @c bm, of lengths @c a_size and @c b_size into the first
+ * @c size sums @c s and @c m, which must be zero: s[k] sums up
+ * a[i] b[k - i], and m[k] am[i] b[k - i] + a[i] bm[k - i]. Every s[k]
+ * sums up in the order of i, as foldPeaks() does.
+ *
+ * Sums of each i are added to consecutive k at once, which needs no
+ * reassociation of sums to run on vectors.
+ */
+IMS_TARGET_CLONES
+void convolve(const double* a, const double* am, size_t a_size,
+			  const double* b, const double* bm, size_t b_size,
+			  double* s, double* m, size_t size) {
+#ifdef IMS_VECTOR_EXTENSIONS
+	typedef double vector_type __attribute__((vector_size(32)));
+	const size_t width = sizeof(vector_type) / sizeof(double);
+#endif
+	for (size_t i = 0; i < a_size && i < size; ++i) {
+		const double x = a[i], xm = am[i];
+		const size_t length = std::min(b_size, size - i);
+		double* s_i = s + i;
+		double* m_i = m + i;
+		size_t j = 0;
+#ifdef IMS_VECTOR_EXTENSIONS
+		// loads and stores by memcpy, which compiles to unaligned moves
+		const vector_type vx = { x, x, x, x }, vxm = { xm, xm, xm, xm };
+		for (; j + width <= length; j += width) {
+			vector_type y, ym, vs, vm;
+			std::memcpy(&y, b + j, sizeof(y));
+			std::memcpy(&ym, bm + j, sizeof(ym));
+			std::memcpy(&vs, s_i + j, sizeof(vs));
+			std::memcpy(&vm, m_i + j, sizeof(vm));
+			vs += vx * y;
+			vm += vxm * y + vx * ym;
+			std::memcpy(s_i + j, &vs, sizeof(vs));
+			std::memcpy(m_i + j, &vm, sizeof(vm));
+		}
+#endif
+		for (; j < length; ++j) {
+			s_i[j] += x * b[j];
+			m_i[j] += xm * b[j] + x * bm[j];
+		}
+	}
+}
+
+/**
+ * Folds as foldPeaks() does, but splits the peaks into abundances and
+ * abundances times masses, each in an array of its own, to convolve them
+ * on vectors. Abundances are the same, masses may differ in the last bits.
+ */
+void foldVectorized(const peaks_type& first, const peaks_type& second,
+					peaks_type& dest, size_type size) {
+	size_type first_size = std::min(first.size(), size);
+	size_type second_size = std::min(second.size(), size);
+	vector<double> arrays(2 * (first_size + second_size + size), 0.0);
+	double* a = &arrays[0];
+	double* am = a + first_size;
+	double* b = am + first_size;
+	double* bm = b + second_size;
+	double* abundances = bm + second_size;
+	double* masses_mult_abundances = abundances + size;
+	for (size_type i = 0; i < first_size; ++i) {
+		a[i] = first[i].abundance;
+		am[i] = first[i].abundance * first[i].mass;
+	}
+	for (size_type i = 0; i < second_size; ++i) {
+		b[i] = second[i].abundance;
+		bm[i] = second[i].abundance * second[i].mass;
+	}
+	convolve(a, am, first_size, b, bm, second_size,
+			 abundances, masses_mult_abundances, size);
+	dest.resize(size);
+	for (size_type k = 0; k < size; ++k) {
+		dest[k].abundance = abundances[k];
+		dest[k].mass = (abundances[k] != 0) ?
+						masses_mult_abundances[k] / abundances[k] : 0;
+	}
+}
+
+/**
+ * Creates the distribution of an element from isotope masses and abundances,
+ * one isotope per nominal mass starting with @c nominal_mass.
+ */
+IsotopeDistribution createElement(unsigned int nominal_mass, const double* masses,
+								  const double* abundances, int isotopes) {
+	peaks_container peaks;
+	for (int i = 0; i < isotopes; ++i) {
+		peaks.push_back(peaks_container::value_type(
+			masses[i] - nominal_mass - i, abundances[i]));
+	}
+	return IsotopeDistribution(peaks, nominal_mass);
+}
+
+/**
+ * Gets the peaks of @c distribution.
+ */
+peaks_type getPeaks(const IsotopeDistribution& distribution) {
+	peaks_type peaks(distribution.size());
+	for (size_type i = 0; i < distribution.size(); ++i) {
+		peaks[i].mass = distribution.getMass(i);
+		peaks[i].abundance = distribution.getAbundance(i);
+	}
+	return peaks;
+}
+
+/**
+ * Folds @c powers one after another with @c fold, repeated @c repeats
+ * times, and returns the time taken.
+ */
+template <typename FoldType>
+double timeMolecule(const vector<peaks_type>& powers, size_type size,
+					FoldType fold, int repeats, peaks_type& molecule) {
+	Stopwatch stopwatch;
+	peaks_type dest;
+	for (int r = 0; r < repeats; ++r) {
+		molecule = powers[0];
+		for (vector<peaks_type>::size_type i = 1; i < powers.size(); ++i) {
+			fold(molecule, powers[i], dest, size);
+			molecule.swap(dest);
+		}
+	}
+	return stopwatch.elapsed();
+}
+
+int main(int argc, char** argv) {
+	vector<size_type> sizes;
+	for (int i = 1; i < argc; ++i) {
+		size_type size;
+		istringstream size_string(argv[i]);
+		size_string >> size;
+		sizes.push_back(size);
+	}
+	if (sizes.empty()) {
+		const size_type default_sizes[] = { 10, 20, 30, 48, 64, 100, 200 };
+		sizes.assign(default_sizes, default_sizes + 7);
+	}
+
+	// C H N O P S
+	vector<IsotopeDistribution> elements;
+	const double massesC[] = { 12.0, 13.003355 }, abundancesC[] = { 0.9893, 0.0107 };
+	elements.push_back(createElement(12, massesC, abundancesC, 2));
+	const double massesH[] = { 1.007825, 2.014102 }, abundancesH[] = { 0.999885, 0.000115 };
+	elements.push_back(createElement(1, massesH, abundancesH, 2));
+	const double massesN[] = { 14.003074, 15.000109 }, abundancesN[] = { 0.99632, 0.00368 };
+	elements.push_back(createElement(14, massesN, abundancesN, 2));
+	const double massesO[] = { 15.994915, 16.999132, 17.999161 },
+				 abundancesO[] = { 0.99757, 0.00038, 0.00205 };
+	elements.push_back(createElement(16, massesO, abundancesO, 3));
+	const double massesP[] = { 30.973762 }, abundancesP[] = { 1.0 };
+	elements.push_back(createElement(31, massesP, abundancesP, 1));
+	const double massesS[] = { 31.972071, 32.971459, 33.967867, 34.0, 35.967081 },
+				 abundancesS[] = { 0.9493, 0.0076, 0.0429, 0.0, 0.0002 };
+	elements.push_back(createElement(32, massesS, abundancesS, 5));
+
+	const unsigned int counts[][6] = {
+		{ 5, 9, 1, 4, 0, 0 },				// glutamic acid, 147 Da
+		{ 10, 16, 5, 13, 3, 0 },			// ATP, 507 Da
+		{ 41, 80, 1, 8, 1, 0 },				// phosphatidylcholine, 745 Da
+		{ 63, 98, 18, 13, 0, 1 },			// substance P, 1347 Da
+		{ 84, 128, 22, 28, 0, 2 }			// peptide, 1956 Da
+	};
+	const string names[] = { "C5H9NO4", "C10H16N5O13P3", "C41H80NO8P",
+		"C63H98N18O13S", "C84H128N22O28S2" };
+
+	const size_type never = numeric_limits<size_type>::max();
+
+	cout << "# molecule\tsize\tscalar\tvectorized\tspeedup\tabundance error\tmass error" << endl;
+	for (int m = 0; m < 5; ++m) {
+		for (vector<size_type>::size_type s = 0; s < sizes.size(); ++s) {
+			// powers of the elements of the molecule, folded without FFT
+			vector<peaks_type> powers;
+			for (int e = 0; e < 6; ++e) {
+				if (counts[m][e] > 0) {
+					IsotopeDistribution power(elements[e]);
+					power.setContext(context_type(sizes[s], 0.0001, never));
+					power *= counts[m][e];
+					powers.push_back(getPeaks(power));
+				}
+			}
+			int repeats = static_cast<int>(std::max<size_type>(
+				1, 200000 / (sizes[s] * sizes[s])));
+
+			peaks_type scalar, vectorized;
+			double scalar_time = timeMolecule(powers, sizes[s], foldPeaks, repeats, scalar);
+			double vectorized_time = timeMolecule(powers, sizes[s], foldVectorized,
+												  repeats, vectorized);
+
+			double abundance_error = 0.0, mass_error = 0.0;
+			for (size_type i = 0; i < scalar.size(); ++i) {
+				if (scalar[i].abundance >= numeric_limits<double>::min()) {
+					abundance_error = std::max(abundance_error,
+						std::fabs(vectorized[i].abundance / scalar[i].abundance - 1.0));
+					mass_error = std::max(mass_error,
+						std::fabs(vectorized[i].mass - scalar[i].mass));
+				}
+			}
+			cout << names[m] << '\t' << sizes[s] << '\t'
+				<< scalar_time / repeats << '\t' << vectorized_time / repeats << '\t'
+				<< scalar_time / vectorized_time << '\t'
+				<< abundance_error << '\t' << mass_error << endl;
+		}
+	}
+
+	return 0;
+}